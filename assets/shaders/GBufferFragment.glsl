@@ -1,7 +1,10 @@
 #version 450 core
 
+// Variants:
+//  IS_LIGHT: Marks the surface as a light source, which the lighting pass draws at full brightness
+
 layout(location = 0) out vec3 out_position;
-layout(location = 1) out vec3 out_normal;
+layout(location = 1) out vec4 out_normal;
 layout(location = 2) out vec4 out_albedo_spec;
 
 in vec2 pass_texture_coord;
@@ -19,7 +22,13 @@ uniform Material material;
 
 void main() {
 	out_position = pass_fragment_coord;
-	out_normal = normalize(pass_normal);
+
+	// The w component tells the lighting pass how to shade the fragment: 1 = lit, 2 = light
+#ifdef IS_LIGHT
+	out_normal = vec4(normalize(pass_normal), 2.0);
+#else
+	out_normal = vec4(normalize(pass_normal), 1.0);
+#endif
 	out_albedo_spec.rgb = texture(material.diffuse0, pass_texture_coord).rgb;
-	out_albedo_spec.a = texture(material.specular0, pass_texture_coord).a;
+	out_albedo_spec.a = texture(material.specular0, pass_texture_coord).r;
 }
\ No newline at end of file
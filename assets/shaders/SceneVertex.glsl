@@ -15,11 +15,47 @@ layout(std140) uniform matrix_data {
 
 uniform mat4 model_matrix;
 
+#ifdef WATER_PASS
+// Geometry on the other side of the water to the pass is clipped away
+uniform vec4 water_clip_plane;
+#endif
+
+#ifdef GPU_TERRAIN
+// Heights from the terrain compute shader, which displace the flat grid of terrain vertices
+uniform sampler2D height_map;
+
+// Points off the edge of the height map are 0, the same as for the normals of CPU terrain
+float get_height(ivec2 point)
+{
+    ivec2 size = textureSize(height_map, 0);
+    if (any(lessThan(point, ivec2(0))) || any(greaterThanEqual(point, size)))
+    {
+        return 0.0;
+    }
+    return texelFetch(height_map, point, 0).r;
+}
+#endif
+
 void main() {
-    vec4 world_position = model_matrix * vec4(in_position, 1.0);
+#ifdef GPU_TERRAIN
+    ivec2 point = ivec2(in_position.xz);
+    vec3 position = vec3(in_position.x, get_height(point), in_position.z);
+    vec3 normal = normalize(vec3(get_height(point - ivec2(1, 0)) - get_height(point + ivec2(1, 0)),
+                                 2.0,
+                                 get_height(point - ivec2(0, 1)) - get_height(point + ivec2(0, 1))));
+#else
+    vec3 position = in_position;
+    vec3 normal = in_normal;
+#endif
+
+    vec4 world_position = model_matrix * vec4(position, 1.0);
     gl_Position = projection_matrix * view_matrix * world_position;
 
     pass_texture_coord = in_texture_coord;
-    pass_normal = mat3(transpose(inverse(model_matrix))) * in_normal;
+    pass_normal = mat3(transpose(inverse(model_matrix))) * normal;
     pass_fragment_coord = vec3(world_position);
+
+#ifdef WATER_PASS
+    gl_ClipDistance[0] = dot(world_position, water_clip_plane);
+#endif
 }
\ No newline at end of file
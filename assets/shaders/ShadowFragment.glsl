@@ -0,0 +1,7 @@
+#version 450 core
+
+// Depth only, for the shadow map passes
+
+void main()
+{
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#version 450 core
+
+layout(location = 0) out vec3 out_position;
+layout(location = 1) out vec4 out_normal;
+layout(location = 2) out vec4 out_albedo_spec;
+
+in vec2 pass_texture_coord;
+in vec3 pass_normal;
+in vec3 pass_fragment_coord;
+
+#include "include/TerrainLayers.glsl"
+
+void main()
+{
+    vec4 diffuse;
+    vec3 specular;
+    blend_terrain_layers(pass_texture_coord, diffuse, specular);
+
+    vec3 normal = normalize(pass_normal);
+
+    out_position = pass_fragment_coord;
+    out_normal = vec4(normal, 1.0);
+    out_albedo_spec.rgb = diffuse.rgb;
+    out_albedo_spec.a = specular.r;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#version 450 core
+
+// Generates the terrain heights in the same way as HeightMap::generate_terrain, one point per
+// invocation
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(r32f, binding = 0) uniform writeonly image2D out_heights;
+
+uniform int size;
+uniform int offset_x;
+uniform int offset_z;
+
+uniform int seed;
+uniform float frequency;
+uniform int octaves;
+uniform float lacunarity;
+uniform float amplitude;
+uniform float amplitude_dampen;
+uniform float water_level;
+uniform bool water_level_damper;
+uniform bool generate_island;
+uniform int bump_power;
+
+#include "include/Noise.glsl"
+
+// Falls off to 0 at the edges, where t is -1 or 1. The power is a whole number so t^(power * 2)
+// is multiplied out, as pow() is undefined for negative t.
+float island(float t, int power)
+{
+    float t_power = 1.0;
+    for (int i = 0; i < power; i++)
+    {
+        t_power *= t * t;
+    }
+    return max(0.0, 1.0 - t_power);
+}
+
+void main()
+{
+    ivec2 point = ivec2(gl_GlobalInvocationID.xy);
+    if (point.x >= size || point.y >= size)
+    {
+        return;
+    }
+
+    float world_x = float(point.x + offset_x);
+    float world_z = float(point.y + offset_z);
+
+    float noise =
+        fractal_noise(seed, world_x * 0.01, world_z * 0.01, frequency, octaves, lacunarity);
+    noise = (noise + 1.0) / 2.0;
+    float height = noise * amplitude - (amplitude / amplitude_dampen);
+
+    float noise2 =
+        fractal_noise(seed, world_x * 0.06, world_z * 0.06, frequency, octaves, lacunarity);
+    noise2 = (noise2 + 1.0) / 2.0;
+    height += noise2 * amplitude / amplitude_dampen;
+
+    if (water_level_damper)
+    {
+        if (height < water_level)
+        {
+            height += (water_level - height) / 1.25;
+        }
+        else
+        {
+            float above_water = height - water_level;
+            float factor = 1.0 - above_water / (amplitude - water_level);
+            height += (water_level - height) * factor;
+        }
+    }
+
+    if (generate_island)
+    {
+        float bump_x = (float(point.x) / float(size)) * 2.0 - 1.0;
+        float bump_z = (float(point.y) / float(size)) * 2.0 - 1.0;
+        height *= island(bump_x, bump_power) * island(bump_z, bump_power);
+    }
+
+    imageStore(out_heights, point, vec4(height));
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#version 450 core
+
+layout (location = 0) out vec4 out_colour;
+
+in vec3 pass_fragment_coord;
+
+// The scene above and below the water, rendered at a lower resolution by the water passes
+uniform sampler2D reflection_tex;
+uniform sampler2D refraction_tex;
+uniform sampler2D refraction_depth_tex;
+
+uniform vec2 screen_size;
+
+// How far the waves move the reflection and refraction, in texture coordinates
+uniform float distortion;
+
+// The water fades in over the shore depth, and takes on the deep colour over the deep depth
+uniform float shore_depth;
+uniform float deep_depth;
+uniform vec3 deep_colour;
+
+#include "include/Lighting.glsl"
+#include "include/Waves.glsl"
+
+// Distance from the camera along the view direction for a value in the depth buffer
+float linearise_depth(float depth)
+{
+    return projection_matrix[3][2] / (depth * 2.0 - 1.0 + projection_matrix[2][2]);
+}
+
+void main()
+{
+    vec3 eye_offset = eye_position - pass_fragment_coord;
+    vec3 eye_direction = normalize(eye_offset);
+    vec3 waves = calculate_waves(pass_fragment_coord.xz, length(eye_offset));
+    vec3 normal = normalize(vec3(-waves.y, 1.0, -waves.z));
+
+    // The depth of the water is how much further away the scene under it is than the surface
+    vec2 screen_coord = gl_FragCoord.xy / screen_size;
+    float scene_depth = linearise_depth(texture(refraction_depth_tex, screen_coord).r);
+    float water_depth = max(scene_depth - linearise_depth(gl_FragCoord.z), 0.0);
+    float shore = clamp(water_depth / shore_depth, 0.0, 1.0);
+
+    // Distortion is faded out at the shore, where it would pull in the land in front of the water
+    vec2 distorted_coord = clamp(screen_coord + normal.xz * distortion * shore, 0.001, 0.999);
+    vec3 reflection = texture(reflection_tex, distorted_coord).rgb;
+    vec3 refraction = texture(refraction_tex, distorted_coord).rgb;
+    refraction = mix(refraction, deep_colour, clamp(water_depth / deep_depth, 0.0, 1.0));
+
+    // Schlick's approximation of the Fresnel term, so the water reflects more at glancing angles
+    float fresnel = 0.02 + 0.98 * pow(1.0 - max(dot(normal, eye_direction), 0.0), 5.0);
+    vec3 colour = mix(refraction, reflection, fresnel);
+
+    // Highlights from the sun on the waves
+    vec3 reflect_direction = reflect(dir_light.direction.xyz, normal);
+    float specular = pow(max(dot(eye_direction, reflect_direction), 0.0), 128.0);
+    colour += dir_light.base.colour.rgb * dir_light.base.diffuse_intensity * specular;
+
+    // Blending by the depth softens the edge where the water meets the land
+    out_colour = vec4(clamp(colour, 0.0, 1.0), shore);
+}
\ No newline at end of file
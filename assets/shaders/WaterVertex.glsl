@@ -0,0 +1,40 @@
+#version 450 core
+
+// Projected grid: the vertices are spread evenly over the screen, and each is moved to where the
+// camera's ray through it hits the water, so the grid's detail follows the camera
+
+layout(location = 0) in vec3 in_position;
+
+out vec3 pass_fragment_coord;
+
+layout(std140) uniform matrix_data {
+    mat4 projection_matrix;
+    mat4 view_matrix;
+};
+
+uniform mat4 inverse_view_projection;
+uniform vec3 eye_position;
+uniform float water_height;
+
+#include "include/Waves.glsl"
+
+vec3 unproject(vec2 point, float depth)
+{
+    vec4 position = inverse_view_projection * vec4(point, depth, 1.0);
+    return position.xyz / position.w;
+}
+
+void main() {
+    vec3 near = unproject(in_position.xy, -1.0);
+    vec3 far = unproject(in_position.xy, 1.0);
+
+    // Rays that miss the water before the far plane are pinned to the horizon
+    float t = (water_height - near.y) / (far.y - near.y);
+    t = t >= 0.0 && t <= 1.0 ? t : 1.0;
+
+    vec3 position = mix(near, far, t);
+    position.y = water_height + calculate_waves(position.xz, distance(position, eye_position)).x;
+
+    gl_Position = projection_matrix * view_matrix * vec4(position, 1.0);
+    pass_fragment_coord = position;
+}
\ No newline at end of file
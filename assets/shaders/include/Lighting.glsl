@@ -0,0 +1,280 @@
+// Lighting shared by the forward, terrain and deferred shaders
+
+struct LightBase
+{
+    vec4 colour;
+    float ambient_intensity;
+    float diffuse_intensity;
+    float specular_intensity;
+};
+
+struct Attenuation
+{
+    float constant;
+    float linear;
+    float exponant;
+};
+
+struct DirectionalLight
+{
+    LightBase base;
+    vec4 direction;
+};
+
+struct PointLight
+{
+    LightBase base;
+    vec4 position;
+    Attenuation att;
+};
+
+struct SpotLight
+{
+    LightBase base;
+    vec4 direction;
+    vec4 position;
+    Attenuation att;
+
+    float cutoff;
+};
+
+layout(std140) uniform Light
+{
+    DirectionalLight dir_light;
+    SpotLight spot_light;
+};
+
+layout(std140) uniform matrix_data
+{
+    mat4 projection_matrix;
+    mat4 view_matrix;
+};
+
+// Point lights are binned into view space clusters on the CPU, see LightClusters.h
+layout(std430) readonly buffer PointLights
+{
+    PointLight point_lights[];
+};
+
+// Offset and count into light_indices for each cluster
+layout(std430) readonly buffer LightClusters
+{
+    uvec2 light_clusters[];
+};
+
+layout(std430) readonly buffer LightIndices
+{
+    uint light_indices[];
+};
+
+layout(std140) uniform LightClusterInfo
+{
+    uvec4 cluster_counts;
+
+    // xy: Size of a tile in pixels, z: Slice scale, w: Slice bias
+    vec4 cluster_params;
+};
+
+// Cascaded shadow maps of the directional light, see CascadedShadowMap.h
+layout(std140) uniform ShadowData
+{
+    // World space to each cascade's texture coordinates and depth
+    mat4 cascade_matrices[4];
+
+    // Size of a texel of each cascade in world units
+    vec4 cascade_texel_sizes;
+
+    // x: Cascade count, 0 when shadows are disabled, y: Normal offset in texels,
+    // z: 1 to tint the cascades
+    vec4 shadow_params;
+};
+
+uniform sampler2DArrayShadow shadow_map;
+
+const vec3 CASCADE_COLOURS[4] = vec3[](
+    vec3(1.0, 0.4, 0.4), vec3(0.4, 1.0, 0.4), vec3(0.4, 0.4, 1.0), vec3(1.0, 1.0, 0.4)
+);
+
+uniform vec3 eye_position;
+
+/**
+    Calculates the base lighting
+
+    @param light The base light object
+    @param normal The surface normal
+    @param light_direction The direction from the surface to the light
+    @param eye_direction The direction from the surface to the camera's "eye"
+    @param specular The specular strength of the surface
+
+    @return Combined light effect (Ambient + Diffuse + Specular)
+*/
+vec3 calculate_base_lighting(LightBase light, vec3 normal, vec3 light_direction, vec3 eye_direction, vec3 specular)
+{
+    vec3 ambient_light = light.colour.rgb * light.ambient_intensity;
+
+    // Diffuse lighting
+    float diff = max(dot(normal, light_direction), 0.0);
+    vec3 diffuse = light.colour.rgb * light.diffuse_intensity * diff;
+
+    // Specular lighting
+    vec3 reflect_direction  = reflect(-light_direction, normal);
+    float spec              = pow(max(dot(eye_direction, reflect_direction), 0.0), 16.0);
+
+    return ambient_light + diffuse + light.specular_intensity * spec * specular;
+}
+
+/**
+    Calculates attenuation for the light from the fragment position
+
+    @param attenuation Attenuation values to calculate from
+    @param light_position The position of the light source
+    @param fragment_coord The world position of the fragment
+
+    @return Attenuation intensity (between 0 and 1), multiply the light by this
+*/
+float calculate_attenuation(Attenuation attenuation, vec3 light_position, vec3 fragment_coord)
+{
+    float distance = length(light_position - fragment_coord);
+    return 1.0 /  (
+        attenuation.constant +
+        attenuation.linear * distance +
+        attenuation.exponant * (distance * distance)
+    );
+}
+
+vec3 calculate_directional_light(DirectionalLight light, vec3 normal, vec3 eye_direction, vec3 specular, float shadow)
+{
+    vec3 light_result = calculate_base_lighting(
+        light.base, normal, normalize(-light.direction.xyz), eye_direction, specular
+    );
+
+    // Shadows only block the direct light
+    vec3 ambient_light = light.base.colour.rgb * light.base.ambient_intensity;
+    return ambient_light + (light_result - ambient_light) * shadow;
+}
+
+vec3 calculate_point_light(PointLight light, vec3 fragment_coord, vec3 normal, vec3 eye_direction, vec3 specular)
+{
+    vec3 light_direction = normalize(light.position.xyz - fragment_coord);
+    vec3 light_result = calculate_base_lighting(light.base, normal, light_direction, eye_direction, specular);
+    float attenuation = calculate_attenuation(light.att, light.position.xyz, fragment_coord);
+
+    return light_result * attenuation;
+}
+
+vec3 calculate_spot_light(SpotLight light, vec3 fragment_coord, vec3 normal, vec3 eye_direction, vec3 specular)
+{
+    vec3 light_direction = normalize(light.position.xyz - fragment_coord);
+    vec3 light_result = calculate_base_lighting(light.base, normal, light_direction, eye_direction, specular);
+
+    float attenuation = calculate_attenuation(light.att, light.position.xyz, fragment_coord);
+
+    // Smooth edges, creates the flashlight effect such that only centre pixels are lit
+    float oco = cos(acos(light.cutoff) + radians(6));
+    float theta = dot(light_direction, -light.direction.xyz);
+    float epsilon = light.cutoff - oco;
+    float intensity = clamp((theta - oco) / epsilon, 0.0, 1.0);
+
+    // Apply the attenuation and the flashlight effect. Note the flashlight also effects
+    // this light source's ambient light, so this will only allow light inside the "light cone"
+    // - this may need to be changed
+    return light_result * intensity * attenuation;
+}
+
+/**
+    Finds the first cascade of the shadow map that the fragment is inside of
+
+    @param shadow_coord Set to the fragment's texture coordinates and depth in the cascade
+
+    @return Index of the cascade, or -1 if the fragment is outside of them all
+*/
+int find_shadow_cascade(vec3 fragment_coord, vec3 normal, out vec3 shadow_coord)
+{
+    // The texels on the edge are left out, so the filtering never reads past the cascade
+    vec2 margin = 2.0 / vec2(textureSize(shadow_map, 0).xy);
+    for (int i = 0; i < int(shadow_params.x); i++)
+    {
+        // Moving along the normal stops surfaces from shadowing themselves
+        vec3 position = fragment_coord + normal * cascade_texel_sizes[i] * shadow_params.y;
+        shadow_coord = (cascade_matrices[i] * vec4(position, 1.0)).xyz;
+        if (all(greaterThan(shadow_coord.xy, margin)) &&
+            all(lessThan(shadow_coord.xy, 1.0 - margin)) && shadow_coord.z < 1.0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+    Filters the shadow over the 3x3 texels around the coordinate, each of which is also filtered
+    by the hardware comparison
+
+    @return 0 when fully in shadow, up to 1 when fully lit
+*/
+float sample_shadow(int cascade, vec3 shadow_coord)
+{
+    vec2 texel = 1.0 / vec2(textureSize(shadow_map, 0).xy);
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++)
+    {
+        for (int y = -1; y <= 1; y++)
+        {
+            vec2 coord = shadow_coord.xy + vec2(x, y) * texel;
+            lit += texture(shadow_map, vec4(coord, cascade, shadow_coord.z));
+        }
+    }
+    return lit / 9.0;
+}
+
+/**
+    Finds the light cluster that the fragment is inside of
+
+    @return Offset and count into light_indices for the cluster
+*/
+uvec2 get_light_cluster(vec3 fragment_coord)
+{
+    float view_depth = -(view_matrix * vec4(fragment_coord, 1.0)).z;
+    uint slice = uint(max(log(view_depth) * cluster_params.z - cluster_params.w, 0.0));
+    uvec3 cluster = min(
+        uvec3(uvec2(gl_FragCoord.xy / cluster_params.xy), slice),
+        cluster_counts.xyz - 1u
+    );
+    return light_clusters[cluster.x + cluster_counts.x * (cluster.y + cluster_counts.y * cluster.z)];
+}
+
+/**
+    Calculates the light from the directional light, the point lights in the fragment's cluster
+    and the spot light
+
+    @return The total light, multiply the surface colour by this
+*/
+vec3 calculate_lighting(vec3 fragment_coord, vec3 normal, vec3 eye_direction, vec3 specular)
+{
+    vec3 shadow_coord;
+    int cascade = find_shadow_cascade(fragment_coord, normal, shadow_coord);
+    float shadow = cascade < 0 ? 1.0 : sample_shadow(cascade, shadow_coord);
+
+    vec3 total_light = vec3(0, 0, 0);
+    total_light += calculate_directional_light(dir_light, normal, eye_direction, specular, shadow);
+
+    // The clusters are built for the main camera's view and screen, so they do not match the
+    // reflected view or lower resolution of the water passes, which go without point lights
+#ifndef WATER_PASS
+    uvec2 cluster = get_light_cluster(fragment_coord);
+    for (uint i = cluster.x; i < cluster.x + cluster.y; i++)
+    {
+        total_light += calculate_point_light(
+            point_lights[light_indices[i]], fragment_coord, normal, eye_direction, specular
+        );
+    }
+#endif
+    total_light += calculate_spot_light(spot_light, fragment_coord, normal, eye_direction, specular);
+
+    if (shadow_params.z > 0.0 && cascade >= 0)
+    {
+        total_light *= CASCADE_COLOURS[cascade];
+    }
+
+    return total_light;
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+// 2D OpenSimplex2 noise with FBm, ported from FastNoiseLite so terrain generated on the GPU
+// matches terrain generated by HeightMap::generate_terrain. Every step is done in the same order
+// as FastNoiseLite, and integer overflow wraps in GLSL just as FastNoiseLite's hashing expects.
+
+const float SQRT3 = 1.7320508075688772935274463415059;
+const float F2 = 0.5 * (SQRT3 - 1.0);
+const float G2 = (3.0 - SQRT3) / 6.0;
+
+const int PRIME_X = 501125321;
+const int PRIME_Y = 1136930381;
+
+// FastNoiseLite's 128 gradients are these 24 repeated five times, followed by the last 8
+const vec2 GRADIENTS_2D[32] = vec2[](
+    vec2(0.130526192220052, 0.99144486137381), vec2(0.38268343236509, 0.923879532511287),
+    vec2(0.608761429008721, 0.793353340291235), vec2(0.793353340291235, 0.608761429008721),
+    vec2(0.923879532511287, 0.38268343236509), vec2(0.99144486137381, 0.130526192220051),
+    vec2(0.99144486137381, -0.130526192220051), vec2(0.923879532511287, -0.38268343236509),
+    vec2(0.793353340291235, -0.60876142900872), vec2(0.608761429008721, -0.793353340291235),
+    vec2(0.38268343236509, -0.923879532511287), vec2(0.130526192220052, -0.99144486137381),
+    vec2(-0.130526192220052, -0.99144486137381), vec2(-0.38268343236509, -0.923879532511287),
+    vec2(-0.608761429008721, -0.793353340291235), vec2(-0.793353340291235, -0.608761429008721),
+    vec2(-0.923879532511287, -0.38268343236509), vec2(-0.99144486137381, -0.130526192220052),
+    vec2(-0.99144486137381, 0.130526192220051), vec2(-0.923879532511287, 0.38268343236509),
+    vec2(-0.793353340291235, 0.608761429008721), vec2(-0.608761429008721, 0.793353340291235),
+    vec2(-0.38268343236509, 0.923879532511287), vec2(-0.130526192220052, 0.99144486137381),
+    vec2(0.38268343236509, 0.923879532511287), vec2(0.923879532511287, 0.38268343236509),
+    vec2(0.923879532511287, -0.38268343236509), vec2(0.38268343236509, -0.923879532511287),
+    vec2(-0.38268343236509, -0.923879532511287), vec2(-0.923879532511287, -0.38268343236509),
+    vec2(-0.923879532511287, 0.38268343236509), vec2(-0.38268343236509, 0.923879532511287));
+
+// Rounds towards negative infinity, except whole negative numbers which go one lower
+int fast_floor(float f)
+{
+    return f >= 0.0 ? int(f) : int(f) - 1;
+}
+
+float grad_coord(int seed, int x_primed, int y_primed, float xd, float yd)
+{
+    int hash = (seed ^ x_primed ^ y_primed) * 0x27d4eb2d;
+    hash ^= hash >> 15;
+
+    int index = (hash & (127 << 1)) >> 1;
+    vec2 gradient = GRADIENTS_2D[index < 120 ? index % 24 : index - 96];
+    return xd * gradient.x + yd * gradient.y;
+}
+
+/**
+    Single octave of OpenSimplex2 noise, at a position that has already been skewed
+
+    @return Noise between -1 and 1
+*/
+float single_simplex(int seed, float x, float y)
+{
+    int i = fast_floor(x);
+    int j = fast_floor(y);
+    float xi = x - float(i);
+    float yi = y - float(j);
+
+    float t = (xi + yi) * G2;
+    float x0 = xi - t;
+    float y0 = yi - t;
+
+    i *= PRIME_X;
+    j *= PRIME_Y;
+
+    float n0 = 0.0;
+    float n1 = 0.0;
+    float n2 = 0.0;
+
+    float a = 0.5 - x0 * x0 - y0 * y0;
+    if (a > 0.0)
+    {
+        n0 = (a * a) * (a * a) * grad_coord(seed, i, j, x0, y0);
+    }
+
+    float c = (2.0 * (1.0 - 2.0 * G2) * (1.0 / G2 - 2.0)) * t +
+              ((-2.0 * (1.0 - 2.0 * G2) * (1.0 - 2.0 * G2)) + a);
+    if (c > 0.0)
+    {
+        float x2 = x0 + (2.0 * G2 - 1.0);
+        float y2 = y0 + (2.0 * G2 - 1.0);
+        n2 = (c * c) * (c * c) * grad_coord(seed, i + PRIME_X, j + PRIME_Y, x2, y2);
+    }
+
+    if (y0 > x0)
+    {
+        float x1 = x0 + G2;
+        float y1 = y0 + (G2 - 1.0);
+        float b = 0.5 - x1 * x1 - y1 * y1;
+        if (b > 0.0)
+        {
+            n1 = (b * b) * (b * b) * grad_coord(seed, i, j + PRIME_Y, x1, y1);
+        }
+    }
+    else
+    {
+        float x1 = x0 + (G2 - 1.0);
+        float y1 = y0 + G2;
+        float b = 0.5 - x1 * x1 - y1 * y1;
+        if (b > 0.0)
+        {
+            n1 = (b * b) * (b * b) * grad_coord(seed, i + PRIME_X, j, x1, y1);
+        }
+    }
+
+    return (n0 + n1 + n2) * 99.83685446303647;
+}
+
+/**
+    FBm of OpenSimplex2 noise, the same as FastNoiseLite::GetNoise with the default gain of 0.5
+    and no weighting
+
+    @return Noise between -1 and 1
+*/
+float fractal_noise(int seed, float x, float y, float frequency, int octaves, float lacunarity)
+{
+    const float gain = 0.5;
+
+    x *= frequency;
+    y *= frequency;
+    float t = (x + y) * F2;
+    x += t;
+    y += t;
+
+    // Scales the sum of the octaves back to -1 to 1
+    float amp = gain;
+    float amp_fractal = 1.0;
+    for (int i = 1; i < octaves; i++)
+    {
+        amp_fractal += amp;
+        amp *= gain;
+    }
+
+    float sum = 0.0;
+    amp = 1.0 / amp_fractal;
+    for (int i = 0; i < octaves; i++)
+    {
+        sum += single_simplex(seed + i, x, y) * amp;
+        x *= lacunarity;
+        y *= lacunarity;
+        amp *= gain;
+    }
+    return sum;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+// Terrain material blending shared by the forward and deferred terrain shaders
+
+// One layer for each terrain material, see TerrainLayer in Mesh.h
+uniform sampler2DArray terrain_diffuse;
+uniform sampler2DArray terrain_specular;
+
+// Weights of four terrain layers per splat map layer, covering the whole terrain
+uniform sampler2DArray splat_map;
+uniform int terrain_layer_count;
+uniform float terrain_size;
+
+/**
+    Blends the terrain layers using the weights from the splat map
+
+    @param texture_coord The terrain texture coordinate, which is the position on the height map
+    @param out_diffuse The blended diffuse colour
+    @param out_specular The blended specular strength
+*/
+void blend_terrain_layers(vec2 texture_coord, out vec4 out_diffuse, out vec3 out_specular)
+{
+    // The splat map has a texel for each height map point, which are one unit apart
+    vec2 splat_coord = (texture_coord + 0.5) / terrain_size;
+
+    out_diffuse = vec4(0.0);
+    out_specular = vec3(0.0);
+    float total_weight = 0.0;
+    for (int layer = 0; layer < terrain_layer_count; layer++)
+    {
+        float weight = texture(splat_map, vec3(splat_coord, layer / 4))[layer % 4];
+        vec3 coord = vec3(texture_coord, layer);
+
+        out_diffuse += texture(terrain_diffuse, coord) * weight;
+        out_specular += texture(terrain_specular, coord).rgb * weight;
+        total_weight += weight;
+    }
+
+    total_weight = max(total_weight, 0.0001);
+    out_diffuse /= total_weight;
+    out_specular /= total_weight;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+// Waves on the water, shared by the water vertex and fragment shaders so the normals match the
+// displaced surface
+
+const float PI = 3.14159265358979;
+
+// xy: Direction, z: Wavelength, w: Speed
+const vec4 WAVES[4] = vec4[](
+    vec4( 1.0,  0.3, 37.0, 4.0),
+    vec4(-0.4,  1.0, 23.0, 3.1),
+    vec4( 0.7, -0.8, 11.0, 2.3),
+    vec4(-0.9, -0.2,  5.3, 1.4)
+);
+
+uniform float time;
+
+// Height of the longest wave, shorter waves are smaller in proportion to their length
+uniform float wave_height;
+
+/**
+    Sums the sine waves at the point on the water, which fade out with distance as the projected
+    grid is too coarse to show them far away
+
+    @param xz The point on the water plane
+    @param distance The distance from the camera to the point
+
+    @return x: The height of the waves, yz: Their slope along x and z
+*/
+vec3 calculate_waves(vec2 xz, float distance)
+{
+    float height = wave_height * clamp(1.0 - distance / 600.0, 0.0, 1.0);
+
+    vec3 waves = vec3(0.0);
+    for (int i = 0; i < 4; i++)
+    {
+        vec2 direction = normalize(WAVES[i].xy);
+        float frequency = 2.0 * PI / WAVES[i].z;
+        float amplitude = height * WAVES[i].z / WAVES[0].z;
+        float phase = frequency * (dot(direction, xz) - WAVES[i].w * time);
+
+        waves.x += amplitude * sin(phase);
+        waves.yz += amplitude * frequency * cos(phase) * direction;
+    }
+    return waves;
+}
\ No newline at end of file
@@ -0,0 +1,679 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <SFML/System/Clock.hpp>
+#include <imgui.h>
+
+#include "Graphics/BVH.h"
+#include "Graphics/Frustum.h"
+#include "Graphics/GpuTerrainGenerator.h"
+#include "Graphics/LightClusters.h"
+#include "Graphics/Mesh.h"
+#include "Utils/AsciiGrid.h"
+#include "Utils/Erosion.h"
+#include "Utils/HeightMap.h"
+#include "Utils/TextureCompression.h"
+#include "Utils/Util.h"
+#include "WorldGenerator.h"
+
+namespace
+{
+    struct Benchmark
+    {
+        const char* name;
+        std::function<std::string()> run;
+        std::string result = "Not run";
+    };
+
+    /// Runs the given function "iterations" times, returning the average time in microseconds
+    template <typename F>
+    float time_average_us(int iterations, F f)
+    {
+        sf::Clock clock;
+        for (int i = 0; i < iterations; i++)
+        {
+            f();
+        }
+        return static_cast<float>(clock.getElapsedTime().asMicroseconds()) /
+               static_cast<float>(iterations);
+    }
+
+    /// Writes a size x size ESRI ASCII grid of rolling hills to the cache, if it is not already
+    std::filesystem::path write_test_ascii_grid(int size)
+    {
+        std::filesystem::path path = "cache/benchmarks/grid_" + std::to_string(size) + ".asc";
+        if (std::filesystem::exists(path))
+        {
+            return path;
+        }
+        std::filesystem::create_directories(path.parent_path());
+
+        std::ofstream file(path, std::ios::binary);
+        file << "ncols " << size << "\nnrows " << size << "\nxllcorner 0\nyllcorner 0\n"
+             << "cellsize 1\nNODATA_value -9999\n";
+
+        std::string line;
+        char buffer[32];
+        for (int y = 0; y < size; y++)
+        {
+            line.clear();
+            for (int x = 0; x < size; x++)
+            {
+                // Some of the corner is left empty, like the sea in real elevation data
+                float height = std::sin(x * 0.01f) * std::cos(y * 0.013f) * 300.0f + 300.0f;
+                if (x + y < size / 8)
+                {
+                    height = -9999.0f;
+                }
+                auto end = std::to_chars(buffer, buffer + sizeof(buffer), height,
+                                         std::chars_format::fixed, 2)
+                               .ptr;
+                line.append(buffer, end);
+                line += ' ';
+            }
+            line += '\n';
+            file << line;
+        }
+        return path;
+    }
+
+    /// How ASCII grids were parsed before, line by line with std::stof
+    std::vector<float> parse_ascii_grid_getline(const std::filesystem::path& path)
+    {
+        std::ifstream file(path);
+        std::string line;
+        std::vector<float> values;
+        for (int i = 0; i < 6 && std::getline(file, line); i++)
+        {
+        }
+        while (std::getline(file, line))
+        {
+            for (auto& value : split_string(line))
+            {
+                values.push_back(std::stof(value));
+            }
+        }
+        return values;
+    }
+
+    /// How terrain vertices were generated before, one bounds checked point at a time
+    void generate_terrain_vertices_serial(const HeightMap& height_map,
+                                          std::vector<BasicVertex>& vertices)
+    {
+        int size = height_map.size;
+        vertices.clear();
+        for (int z = 0; z < size; z++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                float left = x > 0 ? height_map.get_height(x - 1, z) : 0;
+                float right = x < size - 1 ? height_map.get_height(x + 1, z) : 0;
+                float down = z > 0 ? height_map.get_height(x, z - 1) : 0;
+                float up = z < size - 1 ? height_map.get_height(x, z + 1) : 0;
+
+                BasicVertex vertex;
+                vertex.position = {x, height_map.get_height(x, z), z};
+                vertex.texture_coord = {x, z};
+                vertex.normal = glm::normalize(glm::vec3{left - right, 2.0f, down - up});
+                vertices.push_back(vertex);
+            }
+        }
+    }
+
+    /// Smooth gradients with some finer detail and noise, a bit like a photographed texture
+    std::vector<std::uint8_t> generate_test_image(int size)
+    {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> noise(-6.0f, 6.0f);
+
+        std::vector<std::uint8_t> rgba(static_cast<std::size_t>(size) * size * 4);
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                float u = static_cast<float>(x) / size;
+                float v = static_cast<float>(y) / size;
+                std::array<float, 4> colour = {
+                    128.0f + 100.0f * std::sin(u * 7.0f + v * 3.0f),
+                    255.0f * u,
+                    255.0f * v * (0.5f + 0.5f * std::cos(u * 11.0f)),
+                    255.0f * (0.5f + 0.5f * std::sin(v * 5.0f)),
+                };
+                for (int c = 0; c < 4; c++)
+                {
+                    rgba[(static_cast<std::size_t>(y) * size + x) * 4 + c] =
+                        static_cast<std::uint8_t>(std::clamp(colour[c] + noise(rng), 0.0f, 255.0f));
+                }
+            }
+        }
+        return rgba;
+    }
+
+    /// Peak signal to noise ratio in decibels, over the first "channels" channels of each pixel
+    float calculate_psnr(const std::vector<std::uint8_t>& a, const std::vector<std::uint8_t>& b,
+                         int channels)
+    {
+        double squared_error = 0.0;
+        std::size_t pixels = a.size() / 4;
+        for (std::size_t i = 0; i < pixels; i++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                double difference = a[i * 4 + c] - b[i * 4 + c];
+                squared_error += difference * difference;
+            }
+        }
+        double mean_squared_error = squared_error / static_cast<double>(pixels * channels);
+        if (mean_squared_error == 0.0)
+        {
+            return std::numeric_limits<float>::infinity();
+        }
+        return static_cast<float>(10.0 * std::log10(255.0 * 255.0 / mean_squared_error));
+    }
+} // namespace
+
+namespace Benchmarks
+{
+    std::string frustum_culling()
+    {
+        constexpr int BOX_COUNT = 100000;
+        constexpr int ITERATIONS = 100;
+
+        // Fixed seed so runs are comparable
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+        std::uniform_real_distribution<float> size(0.5f, 10.0f);
+
+        AABBList boxes;
+        boxes.reserve(BOX_COUNT);
+        for (int i = 0; i < BOX_COUNT; i++)
+        {
+            glm::vec3 min{position(rng), position(rng), position(rng)};
+            boxes.add({min, min + glm::vec3{size(rng), size(rng), size(rng)}});
+        }
+
+        auto projection = glm::perspective(glm::radians(75.0f), 16.0f / 9.0f, 0.2f, 2000.0f);
+        auto view = glm::lookAt(glm::vec3{0, 0, 0}, glm::vec3{1, 0.2f, 0.5f}, {0, 1, 0});
+        auto frustum = Frustum::from_matrix(projection * view);
+
+        std::vector<std::uint8_t> scalar_result;
+        std::vector<std::uint8_t> simd_result;
+        std::size_t visible = 0;
+
+        float scalar_time = time_average_us(
+            ITERATIONS, [&] { visible = boxes.cull_scalar(frustum, scalar_result); });
+        float simd_time =
+            time_average_us(ITERATIONS, [&] { visible = boxes.cull(frustum, simd_result); });
+
+        std::ostringstream output;
+        output << BOX_COUNT << " boxes, " << visible << " visible\n"
+               << "Scalar: " << scalar_time << "us (" << BOX_COUNT / scalar_time << " boxes/us)\n"
+               << "SIMD:   " << simd_time << "us (" << BOX_COUNT / simd_time << " boxes/us)\n"
+               << "Results match: " << (scalar_result == simd_result ? "Yes" : "NO");
+        return output.str();
+    }
+
+    std::string bvh_culling()
+    {
+        constexpr int ITERATIONS = 100;
+
+        // Narrow view of a large world, which is where the hierarchy pays off
+        auto projection = glm::perspective(glm::radians(75.0f), 16.0f / 9.0f, 0.2f, 200.0f);
+        auto view = glm::lookAt(glm::vec3{0, 0, 0}, glm::vec3{1, 0.2f, 0.5f}, {0, 1, 0});
+        auto frustum = Frustum::from_matrix(projection * view);
+
+        std::ostringstream output;
+        for (int count : {1000, 10000, 100000})
+        {
+            std::mt19937 rng(1234);
+            std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+            std::uniform_real_distribution<float> size(0.5f, 10.0f);
+
+            AABBList boxes;
+            BVH bvh;
+            boxes.reserve(count);
+
+            sf::Clock build_clock;
+            for (int i = 0; i < count; i++)
+            {
+                glm::vec3 min{position(rng), position(rng), position(rng)};
+                AABB aabb{min, min + glm::vec3{size(rng), size(rng), size(rng)}};
+                boxes.add(aabb);
+                bvh.insert(aabb, i);
+            }
+            float build_time = build_clock.getElapsedTime().asSeconds() * 1000.0f;
+
+            std::vector<std::uint8_t> linear_result;
+            std::vector<int> bvh_result;
+            std::size_t linear_visible = 0;
+
+            float linear_time = time_average_us(
+                ITERATIONS, [&] { linear_visible = boxes.cull(frustum, linear_result); });
+            float bvh_time = time_average_us(ITERATIONS,
+                                             [&]
+                                             {
+                                                 bvh_result.clear();
+                                                 bvh.query(frustum, bvh_result);
+                                             });
+
+            output << count << " boxes, " << linear_visible << " visible, BVH height "
+                   << bvh.height() << " (built in " << build_time << "ms)\n"
+                   << "Linear: " << linear_time << "us  BVH: " << bvh_time << "us\n"
+                   << "Results match: "
+                   << (bvh_result.size() == linear_visible ? "Yes" : "NO") << "\n";
+        }
+        return output.str();
+    }
+
+    std::string light_clustering()
+    {
+        constexpr int ITERATIONS = 100;
+
+        auto projection = glm::perspective(glm::radians(75.0f), 16.0f / 9.0f, 0.2f, 2000.0f);
+        auto view = glm::lookAt(glm::vec3{256, 60, 256}, glm::vec3{400, 40, 300}, {0, 1, 0});
+
+        LightClusters clusters;
+        std::ostringstream output;
+        for (int count : {1000, 4000})
+        {
+            // Lights scattered over a terrain sized area, with a ~40 unit radius
+            std::mt19937 rng(1234);
+            std::uniform_real_distribution<float> position(0.0f, 512.0f);
+            std::vector<PointLight> lights(count);
+            for (auto& light : lights)
+            {
+                light.position = {position(rng), position(rng) * 0.2f, position(rng), 0.0f};
+                light.att.linear = 0.2f;
+                light.att.exponant = 0.1f;
+            }
+
+            float time =
+                time_average_us(ITERATIONS, [&] { clusters.build(lights, view, projection); });
+
+            auto& stats = clusters.get_stats();
+            output << count << " lights, " << stats.visible_lights << " visible: " << time
+                   << "us\n"
+                   << "Light indices: " << stats.light_indices << " (max "
+                   << stats.max_lights_per_cluster << " per cluster)\n";
+        }
+        return output.str();
+    }
+
+    std::string ascii_grid_parsing()
+    {
+        std::ostringstream output;
+        for (int size : {1024, 8192})
+        {
+            auto path = write_test_ascii_grid(size);
+            float megabytes = std::filesystem::file_size(path) / (1024.0f * 1024.0f);
+
+            // Parse once first so every run reads the file from the page cache
+            AsciiGrid serial;
+            AsciiGrid parallel;
+            load_ascii_grid(path, serial, 1);
+
+            float serial_time = time_average_us(1, [&] { load_ascii_grid(path, serial, 1); });
+            float parallel_time = time_average_us(1, [&] { load_ascii_grid(path, parallel); });
+
+            output << size << "x" << size << " (" << megabytes << "MB)\n";
+
+            // The old parser takes minutes on the large grid
+            if (size <= 1024)
+            {
+                std::vector<float> values;
+                float getline_time =
+                    time_average_us(1, [&] { values = parse_ascii_grid_getline(path); });
+                output << "getline/stof: " << getline_time / 1000.0f << "ms ("
+                       << megabytes / getline_time * 1e6f << "MB/s)\n"
+                       << "Results match: " << (values == serial.values ? "Yes" : "NO") << "\n";
+            }
+            output << "from_chars:   " << serial_time / 1000.0f << "ms ("
+                   << megabytes / serial_time * 1e6f << "MB/s)\n"
+                   << "Parallel:     " << parallel_time / 1000.0f << "ms ("
+                   << megabytes / parallel_time * 1e6f << "MB/s)\n"
+                   << "Results match: " << (parallel.values == serial.values ? "Yes" : "NO")
+                   << "\n";
+        }
+        return output.str();
+    }
+
+    std::string height_sampling()
+    {
+        constexpr int SAMPLE_COUNT = 100000;
+        constexpr int ITERATIONS = 100;
+
+        HeightMap height_map{512};
+        height_map.generate_terrain({});
+
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> position(0.0f, 511.0f);
+        std::vector<glm::vec2> positions(SAMPLE_COUNT);
+        for (auto& p : positions)
+        {
+            p = {position(rng), position(rng)};
+        }
+
+        // The results are kept so the loops are not optimised away
+        std::vector<float> truncated(SAMPLE_COUNT);
+        std::vector<float> scalar(SAMPLE_COUNT);
+        std::vector<float> simd(SAMPLE_COUNT);
+        float truncated_time = time_average_us(
+            ITERATIONS,
+            [&]
+            {
+                for (int i = 0; i < SAMPLE_COUNT; i++)
+                {
+                    auto& p = positions[i];
+                    truncated[i] =
+                        height_map.get_height(static_cast<int>(p.x), static_cast<int>(p.y));
+                }
+            });
+        float scalar_time = time_average_us(ITERATIONS,
+                                            [&]
+                                            {
+                                                for (int i = 0; i < SAMPLE_COUNT; i++)
+                                                {
+                                                    auto& p = positions[i];
+                                                    scalar[i] = height_map.sample(p.x, p.y);
+                                                }
+                                            });
+        float simd_time =
+            time_average_us(ITERATIONS, [&] { height_map.sample_many(positions, simd); });
+
+        float max_difference = 0.0f;
+        for (int i = 0; i < SAMPLE_COUNT; i++)
+        {
+            max_difference = std::max(max_difference, std::abs(scalar[i] - simd[i]));
+        }
+
+        std::ostringstream output;
+        output << SAMPLE_COUNT << " samples\n"
+               << "get_height (truncated): " << truncated_time << "us\n"
+               << "sample:      " << scalar_time << "us (" << SAMPLE_COUNT / scalar_time
+               << " samples/us)\n"
+               << "sample_many: " << simd_time << "us (" << SAMPLE_COUNT / simd_time
+               << " samples/us)\n"
+               << "Results match: " << (max_difference < 1e-4f ? "Yes" : "NO");
+        return output.str();
+    }
+
+    std::string terrain_vertices()
+    {
+        constexpr int ITERATIONS = 3;
+
+        std::ostringstream output;
+        for (int size : {2048, 4096})
+        {
+            HeightMap height_map{size};
+            height_map.generate_terrain({});
+
+            std::vector<BasicVertex> serial;
+            std::vector<BasicVertex> single_thread;
+            std::vector<BasicVertex> parallel;
+            float serial_time = time_average_us(
+                ITERATIONS, [&] { generate_terrain_vertices_serial(height_map, serial); });
+            float single_thread_time = time_average_us(
+                ITERATIONS, [&] { generate_terrain_vertices(height_map, single_thread, 0, 1); });
+            float parallel_time = time_average_us(
+                ITERATIONS, [&] { generate_terrain_vertices(height_map, parallel); });
+
+            float max_difference = 0.0f;
+            for (std::size_t i = 0; i < serial.size(); i++)
+            {
+                auto difference = glm::abs(serial[i].normal - parallel[i].normal);
+                float height_difference = std::abs(serial[i].position.y - parallel[i].position.y);
+                max_difference = std::max(
+                    {max_difference, difference.x, difference.y, difference.z, height_difference});
+            }
+
+            output << size << "x" << size << "\n"
+                   << "Serial:   " << serial_time / 1000.0f << "ms\n"
+                   << "1 thread: " << single_thread_time / 1000.0f << "ms ("
+                   << serial_time / single_thread_time << "x)\n"
+                   << "Parallel: " << parallel_time / 1000.0f << "ms ("
+                   << serial_time / parallel_time << "x, "
+                   << std::max(std::thread::hardware_concurrency(), 1u) << " threads)\n"
+                   << "Results match: " << (max_difference < 1e-5f ? "Yes" : "NO") << "\n";
+        }
+        return output.str();
+    }
+
+    std::string gpu_terrain_generation()
+    {
+        GpuTerrainGenerator generator;
+        if (!generator.init())
+        {
+            return "Failed to load the terrain compute shader";
+        }
+
+        TerrainGenerationOptions options;
+        std::ostringstream output;
+        for (int size : {512, 2048})
+        {
+            HeightMap cpu{size};
+            HeightMap gpu{size};
+            float cpu_time = time_average_us(1, [&] { cpu.generate_terrain(options); });
+
+            // Includes reading the heights back, which is the slowest part on a real GPU
+            float gpu_time = time_average_us(1,
+                                             [&]
+                                             {
+                                                 generator.generate(options, size);
+                                                 generator.poll_readback(gpu, true);
+                                             });
+
+            float max_difference = 0.0f;
+            for (std::size_t i = 0; i < cpu.heights.size(); i++)
+            {
+                max_difference =
+                    std::max(max_difference, std::abs(cpu.heights[i] - gpu.heights[i]));
+            }
+
+            output << size << "x" << size << "\n"
+                   << "CPU: " << cpu_time / 1000.0f << "ms\n"
+                   << "GPU: " << gpu_time / 1000.0f << "ms (" << cpu_time / gpu_time << "x)\n"
+                   << "Max difference: " << max_difference << " (within "
+                   << GpuTerrainGenerator::TOLERANCE << ": "
+                   << (max_difference <= GpuTerrainGenerator::TOLERANCE ? "Yes" : "NO") << ")\n";
+        }
+        return output.str();
+    }
+
+    std::string terrain_erosion()
+    {
+        auto thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+        // Hydraulic erosion and thermal weathering are timed on their own
+        ErosionOptions hydraulic;
+        hydraulic.thermal_iterations = 0;
+        ErosionOptions thermal;
+        thermal.droplet_density = 0.0f;
+
+        std::ostringstream output;
+        for (int size : {512, 1024})
+        {
+            HeightMap terrain{size};
+            terrain.generate_terrain({});
+
+            // Returns the iterations per second
+            auto time_erosion = [&](const ErosionOptions& options, unsigned threads, bool droplets)
+            {
+                HeightMap height_map = terrain;
+                TerrainEroder eroder{threads};
+                eroder.start(size, options);
+                float time = time_average_us(1, [&] { eroder.finish(height_map); });
+
+                auto& stats = eroder.get_stats();
+                auto iterations = droplets ? stats.droplets : stats.thermal_iterations;
+                return static_cast<float>(iterations) / time * 1000000.0f;
+            };
+            float hydraulic_serial = time_erosion(hydraulic, 1, true);
+            float hydraulic_parallel = time_erosion(hydraulic, thread_count, true);
+            float thermal_serial = time_erosion(thermal, 1, false);
+            float thermal_parallel = time_erosion(thermal, thread_count, false);
+
+            // Eroding in one go on one thread must match eroding over many small frame budgets
+            HeightMap serial = terrain;
+            TerrainEroder serial_eroder{1};
+            serial_eroder.start(size, {});
+            serial_eroder.finish(serial);
+
+            HeightMap incremental = terrain;
+            TerrainEroder incremental_eroder;
+            incremental_eroder.start(size, {});
+            while (!incremental_eroder.update(incremental, sf::milliseconds(1)))
+            {
+            }
+
+            output << size << "x" << size << "\n"
+                   << "Droplets/sec: " << hydraulic_serial << " (1 thread), "
+                   << hydraulic_parallel << " (" << hydraulic_parallel / hydraulic_serial << "x, "
+                   << thread_count << " threads)\n"
+                   << "Thermal iterations/sec: " << thermal_serial << " (1 thread), "
+                   << thermal_parallel << " (" << thermal_parallel / thermal_serial << "x)\n"
+                   << "Deterministic: " << (serial.heights == incremental.heights ? "Yes" : "NO")
+                   << "\n";
+        }
+        return output.str();
+    }
+
+    std::string world_generation()
+    {
+        // A seed of its own so it never loads the game's cached world
+        WorldOptions options;
+        options.terrain.seed = 1234;
+
+        std::optional<WorldSnapshot> generated;
+        float generate_time =
+            time_average_us(1, [&] { generated.emplace(generate_world(options)); });
+
+        // The first load caches the world if this is the first run, the second loads it
+        load_or_generate_world(options);
+        std::optional<WorldSnapshot> loaded;
+        float load_time =
+            time_average_us(1, [&] { loaded.emplace(load_or_generate_world(options)); });
+
+        // Two worlds from the same options must be identical
+        auto regenerated = generate_world(options);
+        bool reproducible = regenerated.content_hash == generated->content_hash &&
+                            regenerated.height_map.heights == generated->height_map.heights;
+
+        std::ostringstream output;
+        output << options.size << "x" << options.size << ", " << options.people_count
+               << " people\n"
+               << "Generate: " << generate_time / 1000.0f << "ms\n"
+               << "Load from cache: " << load_time / 1000.0f << "ms ("
+               << generate_time / load_time << "x)\n"
+               << "Loaded from cache: " << (loaded->loaded_from_cache ? "Yes" : "NO") << "\n"
+               << "Cached world matches: "
+               << (loaded->content_hash == generated->content_hash ? "Yes" : "NO") << "\n"
+               << "Reproducible: " << (reproducible ? "Yes" : "NO") << "\n";
+        return output.str();
+    }
+
+    std::string texture_compression()
+    {
+        constexpr int SIZE = 256;
+
+        struct FormatTest
+        {
+            BlockFormat format;
+            const char* name;
+
+            // BC1 has no alpha and BC5 only has red and green
+            int channels;
+            float min_psnr;
+        };
+        constexpr std::array<FormatTest, 4> FORMATS = {{
+            {BlockFormat::BC1, "BC1", 3, 34.0f},
+            {BlockFormat::BC3, "BC3", 4, 35.0f},
+            {BlockFormat::BC5, "BC5", 2, 45.0f},
+            {BlockFormat::BC7, "BC7", 4, 35.0f},
+        }};
+
+        auto image = generate_test_image(SIZE);
+        std::filesystem::create_directories("cache/benchmarks");
+
+        std::ostringstream output;
+        output << SIZE << "x" << SIZE << ", checked with the reference decoder\n";
+        for (auto& test : FORMATS)
+        {
+            std::vector<std::uint8_t> compressed;
+            float compress_time = time_average_us(
+                1, [&] { compressed = compress_image(image.data(), SIZE, SIZE, test.format); });
+
+            std::vector<std::uint8_t> decoded;
+            bool decoded_ok = decompress_image(compressed, SIZE, SIZE, test.format, decoded);
+            float psnr = decoded_ok ? calculate_psnr(image, decoded, test.channels) : 0.0f;
+
+            // Every mip must come back from the file exactly as it was written
+            auto texture = compress_texture(image.data(), SIZE, SIZE, test.format, 16);
+            auto path = std::filesystem::path{"cache/benchmarks"} /
+                        (std::string{"texture_"} + test.name + ".dds");
+            CompressedTexture loaded;
+            bool round_trip = save_dds(path, texture) && load_dds(path, loaded) &&
+                              loaded.format == texture.format &&
+                              loaded.mips.size() == texture.mips.size();
+            for (std::size_t i = 0; round_trip && i < texture.mips.size(); i++)
+            {
+                round_trip = loaded.mips[i].width == texture.mips[i].width &&
+                             loaded.mips[i].height == texture.mips[i].height &&
+                             loaded.mips[i].data == texture.mips[i].data;
+            }
+
+            output << test.name << ": " << compress_time / 1000.0f << "ms ("
+                   << SIZE * SIZE / compress_time << " pixels/us)\n"
+                   << "  PSNR: " << psnr << "dB (at least " << test.min_psnr << ": "
+                   << (decoded_ok && psnr >= test.min_psnr ? "Yes" : "NO") << ")\n"
+                   << "  DDS round trip (" << texture.mips.size()
+                   << " mips): " << (round_trip ? "Yes" : "NO") << "\n";
+        }
+        return output.str();
+    }
+
+    void gui()
+    {
+        static std::vector<Benchmark> benchmarks = {
+            {"Frustum Culling", &frustum_culling},
+            {"BVH Culling", &bvh_culling},
+            {"Light Clustering", &light_clustering},
+            {"ASCII Grid Parsing", &ascii_grid_parsing},
+            {"Height Sampling", &height_sampling},
+            {"Terrain Vertices", &terrain_vertices},
+            {"GPU Terrain Generation", &gpu_terrain_generation},
+            {"Terrain Erosion", &terrain_erosion},
+            {"World Generation", &world_generation},
+            {"Texture Compression", &texture_compression},
+        };
+
+        if (ImGui::Begin("Benchmarks"))
+        {
+            for (auto& benchmark : benchmarks)
+            {
+                ImGui::PushID(benchmark.name);
+                ImGui::Text("%s", benchmark.name);
+                ImGui::SameLine();
+                if (ImGui::Button("Run"))
+                {
+                    benchmark.result = benchmark.run();
+                }
+                ImGui::TextWrapped("%s", benchmark.result.c_str());
+                ImGui::Separator();
+                ImGui::PopID();
+            }
+        }
+        ImGui::End();
+    }
+} // namespace Benchmarks
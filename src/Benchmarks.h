@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+/// CPU benchmarks of engine systems, run on demand from the "Benchmarks" debug window
+namespace Benchmarks
+{
+    std::string frustum_culling();
+    std::string bvh_culling();
+    std::string light_clustering();
+    std::string ascii_grid_parsing();
+    std::string height_sampling();
+    std::string terrain_vertices();
+    std::string gpu_terrain_generation();
+    std::string terrain_erosion();
+    std::string world_generation();
+    std::string texture_compression();
+
+    void gui();
+} // namespace Benchmarks
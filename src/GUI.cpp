@@ -1,8 +1,11 @@
 #include "GUI.h"
 
+#include <bit>
+
 #include <imgui_sfml/imgui-SFML.h>
 #include <imgui_sfml/imgui_impl_opengl3.h>
 
+#include "Graphics/CascadedShadowMap.h"
 #include "Graphics/DebugRenderer.h"
 #include "Utils/Util.h"
 
@@ -79,6 +82,34 @@ namespace GUI
 
             ImGui::Separator();
             ImGui::Checkbox("Grass ground?", &settings.grass);
+            ImGui::Checkbox("Occlusion culling?", &settings.occlusion_culling);
+            ImGui::Checkbox("Deferred rendering?", &settings.deferred_rendering);
+            ImGui::Checkbox("Hot reload assets?", &settings.hot_reload);
+            ImGui::Checkbox("Stream terrain?", &settings.stream_terrain);
+            ImGui::Checkbox("Generate terrain on GPU?", &settings.gpu_terrain);
+
+            ImGui::Separator();
+
+            ImGui::PushID("Shadows");
+            ImGui::Text("Shadows");
+            ImGui::Checkbox("Enabled", &settings.shadows.enabled);
+            ImGui::SliderInt("Cascades", &settings.shadows.cascade_count, 1,
+                             CascadedShadowMap::MAX_CASCADES);
+
+            // Powers of 2 from 512 (2^9)
+            auto resolution = static_cast<unsigned>(settings.shadows.resolution);
+            int resolution_index = std::countr_zero(resolution) - 9;
+            if (ImGui::Combo("Resolution", &resolution_index, "512\0" "1024\0" "2048\0" "4096\0"))
+            {
+                settings.shadows.resolution = 512 << resolution_index;
+            }
+            ImGui::SliderFloat("Distance", &settings.shadows.distance, 50.0f, 2000.0f);
+            ImGui::SliderFloat("Split Lambda", &settings.shadows.split_lambda, 0.0f, 1.0f);
+            ImGui::SliderFloat("Caster Distance", &settings.shadows.caster_distance, 0.0f, 1000.0f);
+            ImGui::SliderFloat("Depth Bias", &settings.shadows.depth_bias, 0.0f, 8.0f);
+            ImGui::SliderFloat("Normal Offset", &settings.shadows.normal_offset, 0.0f, 4.0f);
+            ImGui::Checkbox("Show Cascades", &settings.shadows.show_cascades);
+            ImGui::PopID();
 
             ImGui::Separator();
 
@@ -95,6 +126,7 @@ namespace GUI
 
             ImGui::PushID("PointLight");
             ImGui::Text("Point light");
+            ImGui::SliderInt("Count", &settings.point_light_count, 1, 4096);
             base_light_widgets(settings.lights.point_light);
             attenuation_widgets(settings.lights.point_light.att);
             ImGui::PopID();
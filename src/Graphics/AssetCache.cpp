@@ -0,0 +1,277 @@
+#include "AssetCache.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "TextureLoader.h"
+
+namespace
+{
+    /// The same file can be reached through different relative paths, so key on the canonical one
+    std::string get_path_key(const std::filesystem::path& path)
+    {
+        return FileWatcher::get_canonical_path(path).generic_string();
+    }
+} // namespace
+
+AssetCache::AssetCache(TextureLoader& texture_loader, GLsizeiptr memory_budget)
+    : texture_loader_(texture_loader)
+    , memory_budget_(memory_budget)
+{
+}
+
+std::shared_ptr<Texture2D> AssetCache::get_texture(const std::filesystem::path& path,
+                                                   GLsizei levels, bool flip_vertically,
+                                                   bool flip_horizontally)
+{
+    auto key = get_path_key(path) + ":" + std::to_string(levels) + ":" +
+               std::to_string(flip_vertically) + std::to_string(flip_horizontally);
+    if (auto texture = find(textures_, key))
+    {
+        return texture;
+    }
+
+    auto texture = std::make_shared<Texture2D>();
+    texture_loader_.load(*texture, path, levels, flip_vertically, flip_horizontally);
+
+    // The entry owns the texture, so it outlives the reload function
+    Entry<Texture2D> entry;
+    entry.asset = texture;
+    entry.files = {path};
+    entry.reload = [=, this, texture = texture.get()]
+    {
+        texture_loader_.reload(*texture, path, levels, flip_vertically, flip_horizontally);
+        stats_.reloads++;
+    };
+    insert(textures_, key, std::move(entry));
+    return texture;
+}
+
+std::shared_ptr<Model> AssetCache::get_model(const std::filesystem::path& path)
+{
+    auto key = get_path_key(path);
+    if (auto model = find(models_, key))
+    {
+        return model;
+    }
+
+    auto model = std::make_shared<Model>();
+    if (!model->load_from_file(path, this))
+    {
+        return nullptr;
+    }
+
+    Entry<Model> entry;
+    entry.asset = model;
+    entry.files = {path};
+    entry.reload = [=, this, model = model.get()]
+    {
+        Model reloaded;
+        if (!reloaded.load_from_file(path, this))
+        {
+            stats_.failed_reloads++;
+            return;
+        }
+
+        // Users such as the static scene refer to the meshes by index
+        if (reloaded.get_meshes().size() != model->get_meshes().size())
+        {
+            std::cerr << "The number of meshes in " << path
+                      << " has changed, restart to see the changes.\n";
+            stats_.failed_reloads++;
+            return;
+        }
+        *model = std::move(reloaded);
+        stats_.reloads++;
+    };
+    insert(models_, key, std::move(entry));
+    return model;
+}
+
+std::shared_ptr<Shader> AssetCache::get_shader(const std::filesystem::path& vertex_file_path,
+                                               const std::filesystem::path& fragment_file_path,
+                                               std::vector<std::string> defines)
+{
+    std::sort(defines.begin(), defines.end());
+    auto files_key = get_path_key(vertex_file_path) + ":" + get_path_key(fragment_file_path);
+    auto key = files_key;
+    for (auto& define : defines)
+    {
+        key += ":" + define;
+    }
+    if (auto shader = find(shaders_, key))
+    {
+        return shader;
+    }
+
+    // Every variant is a separate program to compile, so keep the number of them in check
+    auto& variants = shader_variants_[files_key];
+    if (variants >= MAX_SHADER_VARIANTS)
+    {
+        std::cerr << "Too many variants of " << vertex_file_path << " and "
+                  << fragment_file_path << ", the limit is " << MAX_SHADER_VARIANTS << ".\n";
+        return nullptr;
+    }
+
+    auto shader = std::make_shared<Shader>();
+    if (!shader->load_from_file(vertex_file_path, fragment_file_path, defines))
+    {
+        return nullptr;
+    }
+    variants++;
+    stats_.max_shader_variants = std::max(stats_.max_shader_variants, variants);
+
+    // The new program is swapped in by hot_reload() once it has linked
+    Entry<Shader> entry;
+    entry.asset = shader;
+    entry.files = shader->get_source_files();
+    entry.reload = [this, shader = shader.get()]
+    {
+        if (!shader->begin_reload())
+        {
+            stats_.failed_reloads++;
+        }
+    };
+    insert(shaders_, key, std::move(entry));
+    return shader;
+}
+
+void AssetCache::collect()
+{
+    update_stats();
+
+    // Pending textures are still referenced by the texture loader
+    if (texture_loader_.get_stats().pending > 0)
+    {
+        return;
+    }
+
+    // Models hold on to their textures, so evicting them can let more textures be evicted
+    while (stats_.texture_memory > memory_budget_ &&
+           (evict_one(textures_) || evict_one(models_)))
+    {
+        update_stats();
+    }
+}
+
+void AssetCache::hot_reload()
+{
+    for (auto& path : file_watcher_.poll())
+    {
+        reload_changed(textures_, path);
+        reload_changed(models_, path);
+        reload_changed(shaders_, path);
+    }
+
+    for (auto& [key, entry] : shaders_)
+    {
+        switch (entry.asset->update_reload())
+        {
+            // The reloaded files may include different files
+            case Shader::ReloadStatus::Reloaded:
+                entry.files = entry.asset->get_source_files();
+                watch_files(entry.files);
+                stats_.reloads++;
+                break;
+
+            case Shader::ReloadStatus::Failed:
+                stats_.failed_reloads++;
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+const AssetCache::Stats& AssetCache::get_stats() const
+{
+    return stats_;
+}
+
+template <typename T>
+std::shared_ptr<T> AssetCache::find(std::unordered_map<std::string, Entry<T>>& entries,
+                                    const std::string& key)
+{
+    auto itr = entries.find(key);
+    if (itr == entries.end())
+    {
+        stats_.misses++;
+        return nullptr;
+    }
+
+    stats_.hits++;
+    itr->second.hits++;
+    itr->second.last_used = ++requests_;
+    return itr->second.asset;
+}
+
+template <typename T>
+void AssetCache::insert(std::unordered_map<std::string, Entry<T>>& entries,
+                        const std::string& key, Entry<T> entry)
+{
+    watch_files(entry.files);
+    entry.last_used = ++requests_;
+    entries[key] = std::move(entry);
+}
+
+template <typename T>
+void AssetCache::reload_changed(std::unordered_map<std::string, Entry<T>>& entries,
+                                const std::filesystem::path& path)
+{
+    for (auto& [key, entry] : entries)
+    {
+        if (std::find(entry.files.begin(), entry.files.end(), path) != entry.files.end())
+        {
+            std::cout << "Reloading " << path << ".\n";
+            entry.reload();
+        }
+    }
+}
+
+template <typename T>
+bool AssetCache::evict_one(std::unordered_map<std::string, Entry<T>>& entries)
+{
+    auto oldest = entries.end();
+    for (auto itr = entries.begin(); itr != entries.end(); itr++)
+    {
+        if (itr->second.asset.use_count() == 1 &&
+            (oldest == entries.end() || itr->second.last_used < oldest->second.last_used))
+        {
+            oldest = itr;
+        }
+    }
+    if (oldest == entries.end())
+    {
+        return false;
+    }
+
+    entries.erase(oldest);
+    stats_.evictions++;
+    return true;
+}
+
+void AssetCache::watch_files(std::vector<std::filesystem::path>& files)
+{
+    for (auto& file : files)
+    {
+        file = FileWatcher::get_canonical_path(file);
+        file_watcher_.watch(file);
+    }
+}
+
+void AssetCache::update_stats()
+{
+    stats_.textures = static_cast<int>(textures_.size());
+    stats_.models = static_cast<int>(models_.size());
+    stats_.shaders = static_cast<int>(shaders_.size());
+
+    stats_.texture_memory = 0;
+    stats_.saved_memory = 0;
+    for (auto& [key, entry] : textures_)
+    {
+        auto size = entry.asset->get_memory_size();
+        stats_.texture_memory += size;
+        stats_.saved_memory += size * entry.hits;
+    }
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Utils/FileWatcher.h"
+#include "Model.h"
+#include "OpenGL/Shader.h"
+#include "OpenGL/Texture.h"
+
+class TextureLoader;
+
+/**
+ * @brief Shares textures, models and shaders between everything that uses them, so each file is
+ * only loaded once.
+ *
+ * Assets are keyed by their canonical path and the options they were loaded with, and handed out
+ * as shared pointers. The cache keeps its own reference, so an asset stays loaded after its last
+ * user lets go of it in case it is requested again. collect() evicts the assets only the cache is
+ * referencing, least recently requested first, once the textures go over the memory budget.
+ *
+ * The files of every asset are watched, and hot_reload() reloads the assets whose files change so
+ * they can be edited without restarting. Assets are reloaded in place, so existing handles see
+ * the new version, and the old version is kept if the new one fails to load.
+ *
+ * Textures are loaded in the background by the texture loader, which must outlive the cache.
+ */
+class AssetCache
+{
+  public:
+    struct Stats
+    {
+        int textures = 0;
+        int models = 0;
+        int shaders = 0;
+
+        /// Most variants of any one pair of shader files
+        int max_shader_variants = 0;
+
+        int hits = 0;
+        int misses = 0;
+        int evictions = 0;
+        int reloads = 0;
+        int failed_reloads = 0;
+
+        /// Estimated GPU memory used by the cached textures
+        GLsizeiptr texture_memory = 0;
+
+        /// Estimated GPU memory that loading each texture request separately would have added
+        GLsizeiptr saved_memory = 0;
+    };
+
+    /// @param memory_budget Texture memory in bytes, above which unused assets are evicted
+    AssetCache(TextureLoader& texture_loader, GLsizeiptr memory_budget = 512 * 1024 * 1024);
+
+    AssetCache(const AssetCache& other) = delete;
+    AssetCache& operator=(const AssetCache& other) = delete;
+
+    std::shared_ptr<Texture2D> get_texture(const std::filesystem::path& path, GLsizei levels,
+                                           bool flip_vertically, bool flip_horizontally);
+
+    /// The model's textures are loaded through the cache as well
+    std::shared_ptr<Model> get_model(const std::filesystem::path& path);
+
+    /// Each pair of shader files can be compiled with up to this many different sets of defines
+    constexpr static int MAX_SHADER_VARIANTS = 8;
+
+    /**
+     * @brief Gets the variant of the shader compiled with the given defines, the order of which
+     * does not matter.
+     *
+     * Returns nullptr if the shader failed to load, in which case it is not cached, or if it would
+     * go over MAX_SHADER_VARIANTS.
+     */
+    std::shared_ptr<Shader> get_shader(const std::filesystem::path& vertex_file_path,
+                                       const std::filesystem::path& fragment_file_path,
+                                       std::vector<std::string> defines = {});
+
+    /// Updates the stats, and evicts unused assets while the textures are over the memory budget
+    void collect();
+
+    /**
+     * @brief Reloads the assets whose files have changed. Textures are loaded in the background by
+     * the texture loader, and shaders are compiled by the driver in the background and swapped in
+     * on a later call once they have linked.
+     */
+    void hot_reload();
+
+    const Stats& get_stats() const;
+
+  private:
+    template <typename T>
+    struct Entry
+    {
+        std::shared_ptr<T> asset;
+        std::uint64_t last_used = 0;
+
+        // Number of times the asset was requested after it was loaded
+        int hits = 0;
+
+        // Files the asset is loaded from, and how to load it again when they change
+        std::vector<std::filesystem::path> files;
+        std::function<void()> reload;
+    };
+
+    template <typename T>
+    std::shared_ptr<T> find(std::unordered_map<std::string, Entry<T>>& entries,
+                            const std::string& key);
+
+    template <typename T>
+    void insert(std::unordered_map<std::string, Entry<T>>& entries, const std::string& key,
+                Entry<T> entry);
+
+    template <typename T>
+    void reload_changed(std::unordered_map<std::string, Entry<T>>& entries,
+                        const std::filesystem::path& path);
+
+    /// Evicts the least recently used asset that nothing else references, returns false if there
+    /// are none
+    template <typename T>
+    bool evict_one(std::unordered_map<std::string, Entry<T>>& entries);
+
+    /// Makes the paths canonical so they match the paths from the file watcher, and watches them
+    void watch_files(std::vector<std::filesystem::path>& files);
+
+    void update_stats();
+
+    std::unordered_map<std::string, Entry<Texture2D>> textures_;
+    std::unordered_map<std::string, Entry<Model>> models_;
+    std::unordered_map<std::string, Entry<Shader>> shaders_;
+
+    // Number of variants of each pair of shader files
+    std::unordered_map<std::string, int> shader_variants_;
+
+    FileWatcher file_watcher_;
+    TextureLoader& texture_loader_;
+    GLsizeiptr memory_budget_ = 0;
+    std::uint64_t requests_ = 0;
+
+    Stats stats_;
+};
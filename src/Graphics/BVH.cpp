@@ -0,0 +1,412 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "Frustum.h"
+
+namespace
+{
+    enum class Containment
+    {
+        Outside,
+        Intersects,
+        Inside,
+    };
+
+    Containment classify(const Frustum& frustum, const AABB& aabb)
+    {
+        auto centre = aabb.centre();
+        auto extents = aabb.extents();
+
+        auto result = Containment::Inside;
+        for (auto& plane : frustum.planes)
+        {
+            float radius = std::abs(plane.normal.x) * extents.x +
+                           std::abs(plane.normal.y) * extents.y +
+                           std::abs(plane.normal.z) * extents.z;
+            float distance = plane.distance_to_point(centre);
+            if (distance + radius < 0.0f)
+            {
+                return Containment::Outside;
+            }
+            if (distance - radius < 0.0f)
+            {
+                result = Containment::Intersects;
+            }
+        }
+        return result;
+    }
+
+    AABB merge(const AABB& a, const AABB& b)
+    {
+        AABB result = a;
+        result.expand(b);
+        return result;
+    }
+} // namespace
+
+int BVH::insert(const AABB& bounds, int user_data)
+{
+    int leaf = allocate_node();
+    nodes_[leaf].bounds = bounds;
+    nodes_[leaf].user_data = user_data;
+    nodes_[leaf].height = 0;
+
+    insert_leaf(leaf);
+    leaf_count_++;
+    return leaf;
+}
+
+void BVH::remove(int leaf)
+{
+    assert(leaf >= 0 && leaf < static_cast<int>(nodes_.size()) && nodes_[leaf].is_leaf());
+    remove_leaf(leaf);
+    free_node(leaf);
+    leaf_count_--;
+}
+
+void BVH::update(int leaf, const AABB& bounds)
+{
+    remove_leaf(leaf);
+    nodes_[leaf].bounds = bounds;
+    insert_leaf(leaf);
+}
+
+void BVH::clear()
+{
+    nodes_.clear();
+    free_nodes_.clear();
+    root_ = -1;
+    leaf_count_ = 0;
+}
+
+void BVH::query(const Frustum& frustum, std::vector<int>& out_user_data) const
+{
+    if (root_ == -1)
+    {
+        return;
+    }
+
+    std::vector<int> stack;
+    stack.push_back(root_);
+    while (!stack.empty())
+    {
+        int index = stack.back();
+        stack.pop_back();
+
+        const Node& node = nodes_[index];
+        switch (classify(frustum, node.bounds))
+        {
+            case Containment::Outside:
+                break;
+
+            // Everything below a node that is fully inside is visible, so no more plane tests
+            case Containment::Inside:
+                collect_leaves(index, out_user_data);
+                break;
+
+            case Containment::Intersects:
+                if (node.is_leaf())
+                {
+                    out_user_data.push_back(node.user_data);
+                }
+                else
+                {
+                    stack.push_back(node.left);
+                    stack.push_back(node.right);
+                }
+                break;
+        }
+    }
+}
+
+RaycastResult BVH::raycast(const Ray& ray, float max_distance) const
+{
+    return raycast(ray, max_distance, [](int, float bounds_distance) { return bounds_distance; });
+}
+
+int BVH::size() const
+{
+    return leaf_count_;
+}
+
+int BVH::height() const
+{
+    return root_ == -1 ? 0 : nodes_[root_].height;
+}
+
+int BVH::node_count() const
+{
+    return static_cast<int>(nodes_.size() - free_nodes_.size());
+}
+
+int BVH::allocate_node()
+{
+    if (!free_nodes_.empty())
+    {
+        int node = free_nodes_.back();
+        free_nodes_.pop_back();
+        nodes_[node] = Node{};
+        return node;
+    }
+    nodes_.emplace_back();
+    return static_cast<int>(nodes_.size()) - 1;
+}
+
+void BVH::free_node(int node)
+{
+    nodes_[node].height = -1;
+    free_nodes_.push_back(node);
+}
+
+void BVH::insert_leaf(int leaf)
+{
+    if (root_ == -1)
+    {
+        root_ = leaf;
+        nodes_[leaf].parent = -1;
+        return;
+    }
+
+    // Find the best sibling for the leaf by walking down the tree and choosing the child with the
+    // lowest surface area cost
+    const AABB leaf_bounds = nodes_[leaf].bounds;
+    int index = root_;
+    while (!nodes_[index].is_leaf())
+    {
+        const Node& node = nodes_[index];
+        float area = node.bounds.surface_area();
+        float combined_area = merge(node.bounds, leaf_bounds).surface_area();
+
+        // Cost of creating a new parent for this node and the new leaf
+        float cost = 2.0f * combined_area;
+
+        // Minimum cost of pushing the leaf further down the tree
+        float inheritance_cost = 2.0f * (combined_area - area);
+
+        auto child_cost = [&](int child)
+        {
+            const Node& c = nodes_[child];
+            float merged_area = merge(c.bounds, leaf_bounds).surface_area();
+            return c.is_leaf() ? merged_area + inheritance_cost
+                               : merged_area - c.bounds.surface_area() + inheritance_cost;
+        };
+        float left_cost = child_cost(node.left);
+        float right_cost = child_cost(node.right);
+
+        if (cost < left_cost && cost < right_cost)
+        {
+            break;
+        }
+        index = left_cost < right_cost ? node.left : node.right;
+    }
+    int sibling = index;
+
+    // Create a new parent for the sibling and the leaf
+    int old_parent = nodes_[sibling].parent;
+    int new_parent = allocate_node();
+    nodes_[new_parent].parent = old_parent;
+    nodes_[new_parent].bounds = merge(leaf_bounds, nodes_[sibling].bounds);
+    nodes_[new_parent].height = nodes_[sibling].height + 1;
+    nodes_[new_parent].left = sibling;
+    nodes_[new_parent].right = leaf;
+    nodes_[sibling].parent = new_parent;
+    nodes_[leaf].parent = new_parent;
+
+    if (old_parent != -1)
+    {
+        if (nodes_[old_parent].left == sibling)
+        {
+            nodes_[old_parent].left = new_parent;
+        }
+        else
+        {
+            nodes_[old_parent].right = new_parent;
+        }
+    }
+    else
+    {
+        root_ = new_parent;
+    }
+
+    refit_ancestors(nodes_[leaf].parent);
+}
+
+void BVH::remove_leaf(int leaf)
+{
+    if (leaf == root_)
+    {
+        root_ = -1;
+        return;
+    }
+
+    int parent = nodes_[leaf].parent;
+    int grand_parent = nodes_[parent].parent;
+    int sibling = nodes_[parent].left == leaf ? nodes_[parent].right : nodes_[parent].left;
+
+    // The parent is no longer needed, so the sibling takes its place
+    if (grand_parent != -1)
+    {
+        if (nodes_[grand_parent].left == parent)
+        {
+            nodes_[grand_parent].left = sibling;
+        }
+        else
+        {
+            nodes_[grand_parent].right = sibling;
+        }
+        nodes_[sibling].parent = grand_parent;
+        free_node(parent);
+        refit_ancestors(grand_parent);
+    }
+    else
+    {
+        root_ = sibling;
+        nodes_[sibling].parent = -1;
+        free_node(parent);
+    }
+}
+
+void BVH::refit_ancestors(int index)
+{
+    while (index != -1)
+    {
+        index = balance(index);
+
+        Node& node = nodes_[index];
+        node.height = 1 + std::max(nodes_[node.left].height, nodes_[node.right].height);
+        node.bounds = merge(nodes_[node.left].bounds, nodes_[node.right].bounds);
+
+        index = node.parent;
+    }
+}
+
+int BVH::balance(int index_a)
+{
+    // Performs a left or right rotation if node A is imbalanced, returning the new root of the
+    // sub-tree. Based on the rotations in Box2D's b2DynamicTree, where B and C are the children
+    // of A, D and E are the children of B, and F and G are the children of C
+    Node& a = nodes_[index_a];
+    if (a.is_leaf() || a.height < 2)
+    {
+        return index_a;
+    }
+
+    int index_b = a.left;
+    int index_c = a.right;
+    Node& b = nodes_[index_b];
+    Node& c = nodes_[index_c];
+
+    int balance = c.height - b.height;
+
+    auto replace_in_parent = [&](int parent, int old_child, int new_child)
+    {
+        if (parent == -1)
+        {
+            root_ = new_child;
+        }
+        else if (nodes_[parent].left == old_child)
+        {
+            nodes_[parent].left = new_child;
+        }
+        else
+        {
+            nodes_[parent].right = new_child;
+        }
+    };
+
+    // Rotate C up
+    if (balance > 1)
+    {
+        int index_f = c.left;
+        int index_g = c.right;
+        Node& f = nodes_[index_f];
+        Node& g = nodes_[index_g];
+
+        c.left = index_a;
+        c.parent = a.parent;
+        a.parent = index_c;
+        replace_in_parent(c.parent, index_a, index_c);
+
+        if (f.height > g.height)
+        {
+            c.right = index_f;
+            a.right = index_g;
+            g.parent = index_a;
+            a.bounds = merge(b.bounds, g.bounds);
+            c.bounds = merge(a.bounds, f.bounds);
+            a.height = 1 + std::max(b.height, g.height);
+            c.height = 1 + std::max(a.height, f.height);
+        }
+        else
+        {
+            c.right = index_g;
+            a.right = index_f;
+            f.parent = index_a;
+            a.bounds = merge(b.bounds, f.bounds);
+            c.bounds = merge(a.bounds, g.bounds);
+            a.height = 1 + std::max(b.height, f.height);
+            c.height = 1 + std::max(a.height, g.height);
+        }
+        return index_c;
+    }
+
+    // Rotate B up
+    if (balance < -1)
+    {
+        int index_d = b.left;
+        int index_e = b.right;
+        Node& d = nodes_[index_d];
+        Node& e = nodes_[index_e];
+
+        b.left = index_a;
+        b.parent = a.parent;
+        a.parent = index_b;
+        replace_in_parent(b.parent, index_a, index_b);
+
+        if (d.height > e.height)
+        {
+            b.right = index_d;
+            a.left = index_e;
+            e.parent = index_a;
+            a.bounds = merge(c.bounds, e.bounds);
+            b.bounds = merge(a.bounds, d.bounds);
+            a.height = 1 + std::max(c.height, e.height);
+            b.height = 1 + std::max(a.height, d.height);
+        }
+        else
+        {
+            b.right = index_e;
+            a.left = index_d;
+            d.parent = index_a;
+            a.bounds = merge(c.bounds, d.bounds);
+            b.bounds = merge(a.bounds, e.bounds);
+            a.height = 1 + std::max(c.height, d.height);
+            b.height = 1 + std::max(a.height, e.height);
+        }
+        return index_b;
+    }
+
+    return index_a;
+}
+
+void BVH::collect_leaves(int index, std::vector<int>& out_user_data) const
+{
+    std::vector<int> stack;
+    stack.push_back(index);
+    while (!stack.empty())
+    {
+        const Node& node = nodes_[stack.back()];
+        stack.pop_back();
+        if (node.is_leaf())
+        {
+            out_user_data.push_back(node.user_data);
+        }
+        else
+        {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <vector>
+
+#include "../Utils/Maths.h"
+
+struct Frustum;
+
+struct RaycastResult
+{
+    bool hit = false;
+    int user_data = -1;
+    float distance = 0.0f;
+};
+
+/**
+ * @brief Dynamic bounding volume hierarchy over axis aligned boxes.
+ *
+ * Objects can be added and removed at any time; each insertion walks down the tree picking the
+ * cheapest sibling by surface area and the tree is re-balanced on the way back up using AVL
+ * style rotations, so the tree stays O(log n) deep without needing a full rebuild.
+ */
+class BVH
+{
+    struct Node
+    {
+        AABB bounds;
+        int parent = -1;
+        int left = -1;
+        int right = -1;
+        int height = 0;
+        int user_data = -1;
+
+        bool is_leaf() const
+        {
+            return left == -1;
+        }
+    };
+
+  public:
+    /// Adds an object to the tree, returning a handle to its leaf that can be used to remove it
+    int insert(const AABB& bounds, int user_data);
+    void remove(int leaf);
+
+    /// Removes the leaf and re-inserts it with the new bounds
+    void update(int leaf, const AABB& bounds);
+
+    void clear();
+
+    /// Finds all objects which are inside or intersect the frustum
+    void query(const Frustum& frustum, std::vector<int>& out_user_data) const;
+
+    /// Finds the nearest object whose bounds are hit by the ray
+    RaycastResult raycast(const Ray& ray, float max_distance) const;
+
+    /**
+     * @brief Finds the nearest object hit by the ray, using a callback to test the objects that
+     * the ray hits the bounds of
+     *
+     * @param leaf_test Callable of "float(int user_data, float bounds_distance)" returning the
+     * distance the object was hit at, or a negative value if it was not hit. bounds_distance is
+     * where the ray entered the bounds of the object.
+     */
+    template <typename LeafTest>
+    RaycastResult raycast(const Ray& ray, float max_distance, LeafTest leaf_test) const;
+
+    int size() const;
+    int height() const;
+    int node_count() const;
+
+  private:
+    int allocate_node();
+    void free_node(int node);
+
+    void insert_leaf(int leaf);
+    void remove_leaf(int leaf);
+    void refit_ancestors(int node);
+    int balance(int node);
+
+    void collect_leaves(int node, std::vector<int>& out_user_data) const;
+
+    std::vector<Node> nodes_;
+    std::vector<int> free_nodes_;
+    int root_ = -1;
+    int leaf_count_ = 0;
+};
+
+template <typename LeafTest>
+inline RaycastResult BVH::raycast(const Ray& ray, float max_distance, LeafTest leaf_test) const
+{
+    RaycastResult result;
+    if (root_ == -1)
+    {
+        return result;
+    }
+
+    std::vector<int> stack;
+    stack.push_back(root_);
+    while (!stack.empty())
+    {
+        const Node& node = nodes_[stack.back()];
+        stack.pop_back();
+
+        // Max distance shrinks as closer hits are found, so far away branches are skipped
+        float distance = 0.0f;
+        if (!intersect_ray_aabb(ray, node.bounds, max_distance, distance))
+        {
+            continue;
+        }
+
+        if (node.is_leaf())
+        {
+            float hit_distance = leaf_test(node.user_data, distance);
+            if (hit_distance >= 0.0f && hit_distance < max_distance)
+            {
+                max_distance = hit_distance;
+                result = {true, node.user_data, hit_distance};
+            }
+        }
+        else
+        {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+    return result;
+}
@@ -50,3 +50,13 @@ const glm::vec3& PerspectiveCamera::get_forwards() const
     return forwards_;
 }
 
+float PerspectiveCamera::get_near() const
+{
+    return near_;
+}
+
+float PerspectiveCamera::get_far() const
+{
+    return far_;
+}
+
@@ -15,6 +15,8 @@ struct PerspectiveCamera
     const glm::mat4& get_view_matrix() const;
     const glm::mat4& get_projection() const;
     const glm::vec3& get_forwards() const;
+    float get_near() const;
+    float get_far() const;
 
   private:
     glm::mat4 projection_matrix_{1.0f};
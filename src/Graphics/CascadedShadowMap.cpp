@@ -0,0 +1,228 @@
+#include "CascadedShadowMap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <imgui.h>
+
+#include "../Utils/Profiler.h"
+#include "Camera.h"
+
+namespace
+{
+    // Corners of the camera's near and far planes, which every slice of the frustum is between
+    struct FrustumCorners
+    {
+        std::array<glm::vec3, 4> near_corners;
+        std::array<glm::vec3, 4> far_corners;
+    };
+
+    FrustumCorners get_frustum_corners(const glm::mat4& view_projection)
+    {
+        auto inverse_view_projection = glm::inverse(view_projection);
+        auto unproject = [&](float x, float y, float z)
+        {
+            auto corner = inverse_view_projection * glm::vec4{x, y, z, 1.0f};
+            return glm::vec3{corner} / corner.w;
+        };
+
+        FrustumCorners corners;
+        for (int i = 0; i < 4; i++)
+        {
+            float x = i & 1 ? 1.0f : -1.0f;
+            float y = i & 2 ? 1.0f : -1.0f;
+            corners.near_corners[i] = unproject(x, y, -1.0f);
+            corners.far_corners[i] = unproject(x, y, 1.0f);
+        }
+        return corners;
+    }
+} // namespace
+
+CascadedShadowMap::CascadedShadowMap()
+{
+    shadow_ubo_.create_store(sizeof(ShadowData));
+
+    // The lighting shaders always sample the shadow map, so it must exist while shadows are off
+    create_shadow_map(1, 1);
+}
+
+void CascadedShadowMap::update(const Settings::Shadows& settings,
+                               const PerspectiveCamera& camera, const glm::vec3& light_direction)
+{
+    settings_ = settings;
+    cascade_count_ = settings.enabled ? std::clamp(settings.cascade_count, 1, MAX_CASCADES) : 0;
+    shadow_data_.params = {cascade_count_, settings.normal_offset, settings.show_cascades, 0};
+    if (cascade_count_ == 0)
+    {
+        return;
+    }
+    if (settings.resolution != resolution_ || cascade_count_ > layers_)
+    {
+        create_shadow_map(settings.resolution, cascade_count_);
+    }
+
+    float near = camera.get_near();
+    float far = camera.get_far();
+    float distance = std::clamp(settings.distance, near + 1.0f, far);
+    auto frustum_corners = get_frustum_corners(camera.get_projection() * camera.get_view_matrix());
+
+    // The light's view has a fixed orientation, so only its position changes with the camera
+    auto direction = glm::normalize(light_direction);
+    auto up = std::abs(direction.y) > 0.99f ? glm::vec3{0.0f, 0.0f, 1.0f}
+                                            : glm::vec3{0.0f, 1.0f, 0.0f};
+
+    float split_near = near;
+    for (int i = 0; i < cascade_count_; i++)
+    {
+        // Mixes logarithmic splits, which match how perspective shrinks things, with even splits
+        // so the nearest cascade is not too small
+        float fraction = static_cast<float>(i + 1) / static_cast<float>(cascade_count_);
+        float log_split = near * std::pow(distance / near, fraction);
+        float even_split = near + (distance - near) * fraction;
+        float split_far = glm::mix(even_split, log_split, settings.split_lambda);
+
+        std::array<glm::vec3, 8> corners;
+        for (int c = 0; c < 4; c++)
+        {
+            auto& near_corner = frustum_corners.near_corners[c];
+            auto& far_corner = frustum_corners.far_corners[c];
+            corners[c] = glm::mix(near_corner, far_corner, (split_near - near) / (far - near));
+            corners[c + 4] = glm::mix(near_corner, far_corner, (split_far - near) / (far - near));
+        }
+
+        // A sphere around the slice is the same size whichever way the camera faces. The radius is
+        // rounded so floating point error does not change the size of the texels.
+        glm::vec3 centre{0.0f};
+        for (auto& corner : corners)
+        {
+            centre += corner / 8.0f;
+        }
+        float radius = 0.0f;
+        for (auto& corner : corners)
+        {
+            radius = std::max(radius, glm::distance(centre, corner));
+        }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        auto& cascade = cascades_[i];
+        cascade.near_distance = split_near;
+        cascade.far_distance = split_far;
+        cascade.view = glm::lookAt(centre - direction * (radius + settings.caster_distance),
+                                   centre, up);
+        cascade.projection = glm::ortho(-radius, radius, -radius, radius, 0.0f,
+                                        radius * 2.0f + settings.caster_distance);
+
+        // Moves the projection so the world's origin is on a texel, which keeps every point of the
+        // world on the same texel as the cascade follows the camera
+        auto texel_scale = static_cast<float>(resolution_) / 2.0f;
+        auto origin = glm::vec2{cascade.projection * cascade.view * glm::vec4{0, 0, 0, 1}};
+        auto offset = (glm::round(origin * texel_scale) - origin * texel_scale) / texel_scale;
+        cascade.projection[3][0] += offset.x;
+        cascade.projection[3][1] += offset.y;
+
+        auto view_projection = cascade.projection * cascade.view;
+        cascade.frustum = Frustum::from_matrix(view_projection);
+
+        // Clip space is -1 to 1, the shadow map's texture coordinates and depth are 0 to 1
+        auto to_texture = glm::translate(glm::mat4{1.0f}, glm::vec3{0.5f}) *
+                          glm::scale(glm::mat4{1.0f}, glm::vec3{0.5f});
+        shadow_data_.cascade_matrices[i] = to_texture * view_projection;
+        shadow_data_.texel_sizes[i] = radius * 2.0f / static_cast<float>(resolution_);
+
+        split_near = split_far;
+    }
+}
+
+int CascadedShadowMap::get_cascade_count() const
+{
+    return cascade_count_;
+}
+
+const CascadedShadowMap::Cascade& CascadedShadowMap::get_cascade(int index) const
+{
+    return cascades_[index];
+}
+
+void CascadedShadowMap::begin_cascade(int index)
+{
+    timers_[index].begin();
+    framebuffers_[index]->bind();
+
+    // Casters between the light and the near plane are flattened onto it rather than clipped
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(settings_.depth_bias, 1.0f);
+}
+
+void CascadedShadowMap::end_cascade(int index, int casters)
+{
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_CLAMP);
+    timers_[index].end();
+    stats_.casters[index] = casters;
+}
+
+void CascadedShadowMap::bind()
+{
+    shadow_ubo_.buffer_sub_data(0, shadow_data_);
+    shadow_ubo_.bind_buffer_base(BindBufferTarget::UniformBuffer, SHADOW_UBO_INDEX);
+    shadow_map_.bind(SHADOW_MAP_UNIT);
+}
+
+void CascadedShadowMap::update_timings(Profiler& profiler)
+{
+    for (int i = 0; i < MAX_CASCADES; i++)
+    {
+        if (auto time = timers_[i].poll())
+        {
+            stats_.gpu_times[i] = *time;
+            profiler.add_time("ShadowCascade" + std::to_string(i) + " (GPU)", *time);
+        }
+    }
+}
+
+void CascadedShadowMap::gui() const
+{
+    // Shown with the shadow settings
+    if (ImGui::Begin("Debug Window"))
+    {
+        ImGui::Separator();
+        ImGui::Text("Shadow map: %dx%d, %d layers", resolution_, resolution_, layers_);
+        for (int i = 0; i < cascade_count_; i++)
+        {
+            auto& cascade = cascades_[i];
+            ImGui::Text("Cascade %d: %.1f to %.1f, %.2f texel, %d casters, %.2fms", i,
+                        cascade.near_distance, cascade.far_distance, shadow_data_.texel_sizes[i],
+                        stats_.casters[i], stats_.gpu_times[i].asSeconds() * 1000.0f);
+        }
+    }
+    ImGui::End();
+}
+
+void CascadedShadowMap::create_shadow_map(int resolution, int layers)
+{
+    resolution_ = resolution;
+    layers_ = layers;
+
+    shadow_map_ = Texture2DArray{};
+    shadow_map_.create(resolution, resolution, layers, 1, TextureFormat::Depth32F);
+    shadow_map_.set_wrap_s(TextureWrap::ClampToEdge);
+    shadow_map_.set_wrap_t(TextureWrap::ClampToEdge);
+
+    // Sampled with a sampler2DArrayShadow, where the linear filter blends the comparisons of the
+    // four nearest texels
+    glTextureParameteri(shadow_map_.id, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTextureParameteri(shadow_map_.id, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    for (int i = 0; i < MAX_CASCADES; i++)
+    {
+        framebuffers_[i].reset();
+        if (i < layers)
+        {
+            framebuffers_[i].emplace(resolution, resolution);
+            framebuffers_[i]->attach_depth_layer(shadow_map_, i);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <optional>
+
+#include <SFML/System/Time.hpp>
+
+#include "../Settings.h"
+#include "../Utils/Maths.h"
+#include "Frustum.h"
+#include "OpenGL/Framebuffer.h"
+#include "OpenGL/GpuTimer.h"
+#include "OpenGL/Texture.h"
+#include "OpenGL/VertexArray.h"
+
+class Profiler;
+struct PerspectiveCamera;
+
+/**
+ * @brief Shadows of the directional light, from a shadow map for each of a few slices of the
+ * camera's frustum.
+ *
+ * The frustum is split along the view direction, with the cascades closest to the camera covering
+ * the least distance so they have the most detail. Each cascade's orthographic projection is fitted
+ * to a sphere around its slice, so it keeps the same size as the camera turns, and is snapped to
+ * whole texels so the shadow edges do not shimmer as the camera moves.
+ *
+ * The depth of each cascade is rendered into a layer of a texture array with the casters culled
+ * against that cascade's frustum. Shaders read it through the "ShadowData" uniform block and the
+ * "shadow_map" sampler2DArrayShadow, picking the first cascade the fragment is inside of.
+ */
+class CascadedShadowMap
+{
+  public:
+    constexpr static int MAX_CASCADES = 4;
+
+    // Binding points used in the shaders
+    constexpr static GLuint SHADOW_UBO_INDEX = 4;
+    constexpr static GLuint SHADOW_MAP_UNIT = 8;
+
+    /// Must match the layout of "ShadowData" in the shaders (std140)
+    struct ShadowData
+    {
+        // World space to the cascade's shadow map texture coordinates and depth
+        std::array<glm::mat4, MAX_CASCADES> cascade_matrices{};
+
+        // Size of a texel of each cascade in world units
+        glm::vec4 texel_sizes{0.0f};
+
+        // x: Cascade count, 0 when shadows are disabled, y: Normal offset in texels,
+        // z: 1 to tint the cascades
+        glm::vec4 params{0.0f};
+    };
+
+    struct Cascade
+    {
+        glm::mat4 view{1.0f};
+        glm::mat4 projection{1.0f};
+
+        /// Frustum of the light's projection, which the casters are culled against
+        Frustum frustum;
+
+        // Distances from the camera that the cascade covers
+        float near_distance = 0.0f;
+        float far_distance = 0.0f;
+    };
+
+    struct Stats
+    {
+        std::array<sf::Time, MAX_CASCADES> gpu_times{};
+        std::array<int, MAX_CASCADES> casters{};
+    };
+
+    CascadedShadowMap();
+
+    /// Fits the cascades to the camera, and recreates the shadow map if its size has changed
+    void update(const Settings::Shadows& settings, const PerspectiveCamera& camera,
+                const glm::vec3& light_direction);
+
+    /// Number of cascades to render this frame, which is 0 when shadows are disabled
+    int get_cascade_count() const;
+    const Cascade& get_cascade(int index) const;
+
+    /// Binds the cascade's layer of the shadow map for a depth only pass
+    void begin_cascade(int index);
+    void end_cascade(int index, int casters);
+
+    /// Binds the shadow map and uploads the cascades for the lighting shaders
+    void bind();
+
+    /// Adds the GPU time of each cascade to the profiler, once it is known
+    void update_timings(Profiler& profiler);
+
+    /// Adds the cascades' details and timings to the debug window
+    void gui() const;
+
+  private:
+    void create_shadow_map(int resolution, int layers);
+
+    std::array<Cascade, MAX_CASCADES> cascades_;
+    std::array<std::optional<Framebuffer>, MAX_CASCADES> framebuffers_;
+    std::array<GpuTimer, MAX_CASCADES> timers_;
+    Texture2DArray shadow_map_;
+    BufferObject shadow_ubo_;
+
+    ShadowData shadow_data_;
+    Stats stats_;
+    Settings::Shadows settings_;
+
+    int cascade_count_ = 0;
+    int resolution_ = 0;
+    int layers_ = 0;
+};
@@ -0,0 +1,209 @@
+#include "Frustum.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../Utils/Simd.h"
+
+namespace
+{
+    constexpr std::size_t SIMD_WIDTH = 4;
+
+    Plane normalize_plane(const glm::vec4& plane)
+    {
+        float length = glm::length(glm::vec3{plane});
+        return {glm::vec3{plane} / length, plane.w / length};
+    }
+
+    bool is_outside(const Plane& plane, const glm::vec3& centre, const glm::vec3& extents)
+    {
+        // Projected "radius" of the box onto the plane normal
+        float radius = std::abs(plane.normal.x) * extents.x + std::abs(plane.normal.y) * extents.y +
+                       std::abs(plane.normal.z) * extents.z;
+        return plane.distance_to_point(centre) + radius < 0.0f;
+    }
+} // namespace
+
+float Plane::distance_to_point(const glm::vec3& point) const
+{
+    return glm::dot(normal, point) + distance;
+}
+
+Frustum Frustum::from_matrix(const glm::mat4& m)
+{
+    // GLM is column major, so rows must be taken across the columns
+    auto row = [&](int r) { return glm::vec4{m[0][r], m[1][r], m[2][r], m[3][r]}; };
+
+    Frustum frustum;
+    frustum.planes[Left] = normalize_plane(row(3) + row(0));
+    frustum.planes[Right] = normalize_plane(row(3) - row(0));
+    frustum.planes[Bottom] = normalize_plane(row(3) + row(1));
+    frustum.planes[Top] = normalize_plane(row(3) - row(1));
+    frustum.planes[Near] = normalize_plane(row(3) + row(2));
+    frustum.planes[Far] = normalize_plane(row(3) - row(2));
+    return frustum;
+}
+
+bool Frustum::is_visible(const AABB& aabb) const
+{
+    auto centre = aabb.centre();
+    auto extents = aabb.extents();
+    for (auto& plane : planes)
+    {
+        if (is_outside(plane, centre, extents))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::is_visible(const BoundingSphere& sphere) const
+{
+    for (auto& plane : planes)
+    {
+        if (plane.distance_to_point(sphere.centre) < -sphere.radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void AABBList::clear()
+{
+    centre_x_.clear();
+    centre_y_.clear();
+    centre_z_.clear();
+    extent_x_.clear();
+    extent_y_.clear();
+    extent_z_.clear();
+    count_ = 0;
+}
+
+void AABBList::reserve(std::size_t count)
+{
+    count += SIMD_WIDTH;
+    centre_x_.reserve(count);
+    centre_y_.reserve(count);
+    centre_z_.reserve(count);
+    extent_x_.reserve(count);
+    extent_y_.reserve(count);
+    extent_z_.reserve(count);
+}
+
+void AABBList::add(const AABB& aabb)
+{
+    auto centre = aabb.centre();
+    auto extents = aabb.extents();
+
+    // Overwrite the padding if there is any, otherwise add a new block of 4
+    if (count_ == centre_x_.size())
+    {
+        auto padded = centre_x_.size() + SIMD_WIDTH;
+        centre_x_.resize(padded, 0.0f);
+        centre_y_.resize(padded, 0.0f);
+        centre_z_.resize(padded, 0.0f);
+        extent_x_.resize(padded, 0.0f);
+        extent_y_.resize(padded, 0.0f);
+        extent_z_.resize(padded, 0.0f);
+    }
+    centre_x_[count_] = centre.x;
+    centre_y_[count_] = centre.y;
+    centre_z_[count_] = centre.z;
+    extent_x_[count_] = extents.x;
+    extent_y_[count_] = extents.y;
+    extent_z_[count_] = extents.z;
+    count_++;
+}
+
+std::size_t AABBList::size() const
+{
+    return count_;
+}
+
+std::size_t AABBList::cull_scalar(const Frustum& frustum,
+                                  std::vector<std::uint8_t>& out_visible) const
+{
+    out_visible.resize(count_);
+    std::size_t visible_count = 0;
+    for (std::size_t i = 0; i < count_; i++)
+    {
+        glm::vec3 centre{centre_x_[i], centre_y_[i], centre_z_[i]};
+        glm::vec3 extents{extent_x_[i], extent_y_[i], extent_z_[i]};
+
+        bool visible = true;
+        for (auto& plane : frustum.planes)
+        {
+            if (is_outside(plane, centre, extents))
+            {
+                visible = false;
+                break;
+            }
+        }
+        out_visible[i] = visible;
+        visible_count += visible;
+    }
+    return visible_count;
+}
+
+#ifdef SPOOKY_USE_SSE
+std::size_t AABBList::cull(const Frustum& frustum, std::vector<std::uint8_t>& out_visible) const
+{
+    out_visible.resize(count_);
+    std::size_t visible_count = 0;
+
+    // Broadcast each plane once up front
+    struct SIMDPlane
+    {
+        __m128 nx, ny, nz, abs_nx, abs_ny, abs_nz, d;
+    };
+    std::array<SIMDPlane, 6> planes;
+    for (int i = 0; i < 6; i++)
+    {
+        auto& p = frustum.planes[i];
+        planes[i] = {_mm_set1_ps(p.normal.x),           _mm_set1_ps(p.normal.y),
+                     _mm_set1_ps(p.normal.z),           _mm_set1_ps(std::abs(p.normal.x)),
+                     _mm_set1_ps(std::abs(p.normal.y)), _mm_set1_ps(std::abs(p.normal.z)),
+                     _mm_set1_ps(p.distance)};
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    for (std::size_t i = 0; i < count_; i += SIMD_WIDTH)
+    {
+        __m128 cx = _mm_loadu_ps(&centre_x_[i]);
+        __m128 cy = _mm_loadu_ps(&centre_y_[i]);
+        __m128 cz = _mm_loadu_ps(&centre_z_[i]);
+        __m128 ex = _mm_loadu_ps(&extent_x_[i]);
+        __m128 ey = _mm_loadu_ps(&extent_y_[i]);
+        __m128 ez = _mm_loadu_ps(&extent_z_[i]);
+
+        // Accumulate "outside" results across all planes for the 4 boxes
+        __m128 outside = _mm_setzero_ps();
+        for (auto& p : planes)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p.nx, cx), _mm_mul_ps(p.ny, cy)),
+                                         _mm_add_ps(_mm_mul_ps(p.nz, cz), p.d));
+            __m128 radius =
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(p.abs_nx, ex), _mm_mul_ps(p.abs_ny, ey)),
+                           _mm_mul_ps(p.abs_nz, ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        std::size_t end = std::min(count_ - i, SIMD_WIDTH);
+        for (std::size_t j = 0; j < end; j++)
+        {
+            bool visible = !(mask & (1 << j));
+            out_visible[i + j] = visible;
+            visible_count += visible;
+        }
+    }
+    return visible_count;
+}
+#else
+std::size_t AABBList::cull(const Frustum& frustum, std::vector<std::uint8_t>& out_visible) const
+{
+    return cull_scalar(frustum, out_visible);
+}
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "../Utils/Maths.h"
+
+struct Plane
+{
+    glm::vec3 normal{0.0f};
+    float distance = 0.0f;
+
+    float distance_to_point(const glm::vec3& point) const;
+};
+
+/// View frustum, with the planes facing inwards
+struct Frustum
+{
+    enum Side
+    {
+        Left,
+        Right,
+        Bottom,
+        Top,
+        Near,
+        Far,
+    };
+    std::array<Plane, 6> planes;
+
+    /// Extracts the 6 frustum planes from a projection * view matrix (Gribb/Hartmann)
+    static Frustum from_matrix(const glm::mat4& view_projection);
+
+    bool is_visible(const AABB& aabb) const;
+    bool is_visible(const BoundingSphere& sphere) const;
+};
+
+/**
+ * @brief List of bounding boxes stored as structure-of-arrays (centre and extents) so that many
+ * boxes can be tested against a frustum at once using SIMD
+ */
+class AABBList
+{
+  public:
+    void clear();
+    void reserve(std::size_t count);
+    void add(const AABB& aabb);
+
+    std::size_t size() const;
+
+    /**
+     * @brief Tests every box against the frustum
+     *
+     * @param frustum The frustum to test against
+     * @param out_visible Set to 1 for boxes that are inside or intersect the frustum, 0 otherwise.
+     * @return The number of visible boxes
+     */
+    std::size_t cull(const Frustum& frustum, std::vector<std::uint8_t>& out_visible) const;
+
+    /// Same as cull, without SIMD. Used to verify the results of cull
+    std::size_t cull_scalar(const Frustum& frustum, std::vector<std::uint8_t>& out_visible) const;
+
+  private:
+    // The arrays are padded to a multiple of 4 so the SIMD loop never reads out of bounds
+    std::vector<float> centre_x_;
+    std::vector<float> centre_y_;
+    std::vector<float> centre_z_;
+    std::vector<float> extent_x_;
+    std::vector<float> extent_y_;
+    std::vector<float> extent_z_;
+    std::size_t count_ = 0;
+};
@@ -11,20 +11,32 @@ namespace
 
 GBuffer::GBuffer(GLuint width, GLuint height)
     : g_buffer_(width, height)
+    , width_(width)
+    , height_(height)
 {
-    // Attach the position buffer, normal buffer, and the albedo specular buffer
-    g_buffer_.attach_colour(TextureFormat::RGBA16F)
+    // Attach the position buffer, normal buffer, and the albedo specular buffer. Positions are
+    // full floats as half floats are too imprecise across the size of the terrain
+    g_buffer_.attach_colour(TextureFormat::RGBA32F)
         .attach_colour(TextureFormat::RGBA16F)
-        .attach_colour(TextureFormat::RGB8);
+        .attach_colour(TextureFormat::RGBA8);
 
     glNamedFramebufferDrawBuffers(g_buffer_.id, 3, attachments.data());
 
-    g_buffer_.attach_depth_buffer();
+    // Same format as the main framebuffer, so the depth can be blitted across
+    g_buffer_.attach_renderbuffer();
 }
 
 void GBuffer::bind()
 {
     g_buffer_.bind();
+
+    // The lighting pass uses the normal's w component to find empty pixels, so must be cleared to 0
+    // rather than the clear colour
+    constexpr std::array<GLfloat, 4> zero = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (GLint i = 0; i < static_cast<GLint>(attachments.size()); i++)
+    {
+        glClearNamedFramebufferfv(g_buffer_.id, GL_COLOR, i, zero.data());
+    }
 }
 
 void GBuffer::bind_textures()
@@ -48,3 +60,14 @@ void GBuffer::bind_albedo_specular_buffer_texture(GLuint unit)
 {
     g_buffer_.bind_colour_attachment(2, unit);
 }
+
+void GBuffer::blit_depth(const Framebuffer& target)
+{
+    glBlitNamedFramebuffer(g_buffer_.id, target.id, 0, 0, width_, height_, 0, 0, width_, height_,
+                           GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+}
+
+bool GBuffer::is_complete() const
+{
+    return g_buffer_.is_complete();
+}
@@ -14,6 +14,13 @@ class GBuffer
     void bind_normal_buffer_texture(GLuint unit);
     void bind_albedo_specular_buffer_texture(GLuint unit);
 
+    /// Copies the depth buffer to the target, so it can be rendered to on top of the lit scene
+    void blit_depth(const Framebuffer& target);
+
+    bool is_complete() const;
+
   private:
     Framebuffer g_buffer_;
+    GLuint width_ = 0;
+    GLuint height_ = 0;
 };
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "GpuTerrainGenerator.h"
+
+#include <cassert>
+
+#include "../Utils/HeightMap.h"
+
+namespace
+{
+    // Must match the local size of TerrainHeightCompute.glsl
+    constexpr int WORK_GROUP_SIZE = 8;
+
+    // How long each wait for the readback blocks for, in nanoseconds
+    constexpr GLuint64 WAIT_TIMEOUT = 1000000;
+} // namespace
+
+GpuTerrainGenerator::~GpuTerrainGenerator()
+{
+    if (readback_fence_)
+    {
+        glDeleteSync(readback_fence_);
+    }
+}
+
+bool GpuTerrainGenerator::init()
+{
+    return shader_.load_compute_from_file("assets/shaders/TerrainHeightCompute.glsl");
+}
+
+void GpuTerrainGenerator::generate(const TerrainGenerationOptions& options, int size,
+                                   int offset_x, int offset_z)
+{
+    auto bytes = static_cast<GLsizeiptr>(size) * size * sizeof(float);
+    if (size != size_)
+    {
+        height_texture_ = Texture2D{};
+        height_texture_.create(size, size, 1, TextureFormat::R32F);
+        height_texture_.set_min_filter(TextureMinFilter::Nearest);
+        height_texture_.set_mag_filter(TextureMagFilter::Nearest);
+        height_texture_.set_wrap_s(TextureWrap::ClampToEdge);
+        height_texture_.set_wrap_t(TextureWrap::ClampToEdge);
+
+        readback_buffer_.reset();
+        glNamedBufferStorage(readback_buffer_.id, bytes, nullptr, GL_CLIENT_STORAGE_BIT);
+        size_ = size;
+    }
+
+    shader_.set_uniform("size", size);
+    shader_.set_uniform("offset_x", offset_x);
+    shader_.set_uniform("offset_z", offset_z);
+    shader_.set_uniform("seed", options.seed);
+    shader_.set_uniform("frequency", options.frequency);
+    shader_.set_uniform("octaves", options.octaves);
+    shader_.set_uniform("lacunarity", options.lacunarity);
+    shader_.set_uniform("amplitude", options.amplitude);
+    shader_.set_uniform("amplitude_dampen", options.amplitude_dampen);
+    shader_.set_uniform("water_level", options.water_level);
+    shader_.set_uniform("water_level_damper", static_cast<int>(options.water_level_damper));
+    shader_.set_uniform("generate_island", static_cast<int>(options.generate_island));
+    shader_.set_uniform("bump_power", options.bump_power);
+
+    glBindImageTexture(0, height_texture_.id, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    auto groups = static_cast<GLuint>((size + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE);
+    shader_.dispatch(groups, groups);
+
+    // The heights are read by the terrain vertex shader and copied into the readback buffer
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+    // The copy happens on the GPU, and the fence tells when it is safe to read the buffer
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback_buffer_.id);
+    glGetTextureImage(height_texture_.id, 0, GL_RED, GL_FLOAT, static_cast<GLsizei>(bytes),
+                      nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (readback_fence_)
+    {
+        glDeleteSync(readback_fence_);
+    }
+    readback_fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool GpuTerrainGenerator::poll_readback(HeightMap& height_map, bool wait)
+{
+    if (!readback_fence_)
+    {
+        return false;
+    }
+
+    auto result = glClientWaitSync(readback_fence_, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (wait && result == GL_TIMEOUT_EXPIRED)
+    {
+        result = glClientWaitSync(readback_fence_, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT);
+    }
+    if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+    {
+        return false;
+    }
+    glDeleteSync(readback_fence_);
+    readback_fence_ = nullptr;
+
+    assert(height_map.size == size_);
+    glGetNamedBufferSubData(readback_buffer_.id, 0,
+                            static_cast<GLsizeiptr>(size_) * size_ * sizeof(float),
+                            height_map.heights.data());
+    height_map.update_min_max();
+    return true;
+}
+
+bool GpuTerrainGenerator::is_readback_pending() const
+{
+    return readback_fence_ != nullptr;
+}
+
+const Texture2D& GpuTerrainGenerator::get_height_texture() const
+{
+    return height_texture_;
+}
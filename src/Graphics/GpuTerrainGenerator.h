@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "OpenGL/Shader.h"
+#include "OpenGL/Texture.h"
+#include "OpenGL/VertexArray.h"
+
+struct HeightMap;
+struct TerrainGenerationOptions;
+
+/**
+ * @brief Generates terrain heights with a compute shader into a texture, which the terrain vertex
+ * shader displaces a flat grid of vertices with (the GPU_TERRAIN variant of SceneVertex.glsl).
+ *
+ * The noise and shaping are the same as HeightMap::generate_terrain, so the heights match the CPU
+ * within TOLERANCE as long as the height map uses the default noise. The heights are read back
+ * to the CPU without stalling, for physics and culling, once the GPU has finished with them.
+ *
+ * Only needs OpenGL 4.5 core, so it also runs on software drivers such as Mesa's llvmpipe.
+ */
+class GpuTerrainGenerator
+{
+  public:
+    /// Heights from the GPU are within this of the CPU heights, as the GPU is free to round
+    /// differently
+    constexpr static float TOLERANCE = 0.05f;
+
+    GpuTerrainGenerator() = default;
+    ~GpuTerrainGenerator();
+
+    GpuTerrainGenerator(const GpuTerrainGenerator& other) = delete;
+    GpuTerrainGenerator& operator=(const GpuTerrainGenerator& other) = delete;
+
+    /// Loads the compute shader, returns false if it failed to compile
+    bool init();
+
+    /// Generates size x size heights into the height texture, and starts reading them back. The
+    /// offset is the world position of the first point, as with HeightMap::generate_terrain.
+    void generate(const TerrainGenerationOptions& options, int size, int offset_x = 0,
+                  int offset_z = 0);
+
+    /**
+     * @brief Copies the heights into the height map once the GPU has finished generating and
+     * reading them back. The height map must be the size that was generated.
+     *
+     * @param wait Blocks until the heights are ready rather than checking if they are
+     * @return True if the heights were copied, which happens once for each call to generate()
+     */
+    bool poll_readback(HeightMap& height_map, bool wait = false);
+
+    bool is_readback_pending() const;
+
+    const Texture2D& get_height_texture() const;
+
+  private:
+    Shader shader_;
+    Texture2D height_texture_;
+    BufferObject readback_buffer_;
+    GLsync readback_fence_ = nullptr;
+    int size_ = 0;
+};
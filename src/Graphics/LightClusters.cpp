@@ -0,0 +1,263 @@
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    /// Lights dimmer than this cannot change an 8-bit colour channel
+    constexpr float LIGHT_THRESHOLD = 1.0f / 256.0f;
+
+    constexpr GLsizeiptr MIN_BUFFER_SIZE = 1024;
+
+    float distance_squared(const AABB& aabb, const glm::vec3& point)
+    {
+        auto closest = glm::clamp(point, aabb.min, aabb.max);
+        auto difference = closest - point;
+        return glm::dot(difference, difference);
+    }
+} // namespace
+
+float calculate_light_radius(const PointLight& light)
+{
+    float colour = std::max({light.colour.r, light.colour.g, light.colour.b});
+    float intensity =
+        colour * (light.ambient_intensity + light.diffuse_intensity + light.specular_intensity);
+
+    // Solve "intensity / (constant + linear * d + exponant * d^2) = threshold" for d
+    float c = light.att.constant - intensity / LIGHT_THRESHOLD;
+    float b = light.att.linear;
+    float a = light.att.exponant;
+    if (c >= 0.0f)
+    {
+        return 0.0f;
+    }
+    if (a > 0.0f)
+    {
+        return (-b + std::sqrt(b * b - 4.0f * a * c)) / (2.0f * a);
+    }
+    if (b > 0.0f)
+    {
+        return -c / b;
+    }
+    return std::numeric_limits<float>::max();
+}
+
+LightClusters::LightClusters()
+    : clusters_(CLUSTER_COUNT)
+{
+    info_ubo_.create_store(sizeof(ClusterInfo));
+    clusters_ssbo_.create_store(sizeof(ClusterRange) * CLUSTER_COUNT);
+}
+
+void LightClusters::build(const std::vector<PointLight>& lights, const glm::mat4& view,
+                          const glm::mat4& projection)
+{
+    if (projection != projection_)
+    {
+        build_cluster_bounds(projection);
+    }
+
+    stats_ = {};
+    stats_.lights = static_cast<int>(lights.size());
+    overlaps_.clear();
+
+    float log_depth_range = std::log(far_ / near_);
+    auto slice = [&](float depth)
+    {
+        float s = std::log(depth / near_) / log_depth_range * CLUSTERS_Z;
+        return std::clamp(static_cast<int>(s), 0, CLUSTERS_Z - 1);
+    };
+    auto tile = [](float ndc, int count)
+    { return std::clamp(static_cast<int>((ndc * 0.5f + 0.5f) * count), 0, count - 1); };
+
+    for (std::uint32_t i = 0; i < lights.size(); i++)
+    {
+        auto& light = lights[i];
+        float radius = calculate_light_radius(light);
+        glm::vec3 centre{view * glm::vec4{glm::vec3{light.position}, 1.0f}};
+
+        // Depth is positive into the screen
+        float min_depth = -centre.z - radius;
+        float max_depth = -centre.z + radius;
+        if (radius <= 0.0f || max_depth < near_ || min_depth > far_)
+        {
+            continue;
+        }
+        int z0 = slice(std::max(min_depth, near_));
+        int z1 = slice(std::min(max_depth, far_));
+
+        // Bound the light on screen using the corners of its view space bounding box, which is
+        // only possible if it is entirely in front of the camera
+        int x0 = 0;
+        int x1 = CLUSTERS_X - 1;
+        int y0 = 0;
+        int y1 = CLUSTERS_Y - 1;
+        if (min_depth > near_)
+        {
+            glm::vec2 ndc_min{std::numeric_limits<float>::max()};
+            glm::vec2 ndc_max{std::numeric_limits<float>::lowest()};
+            for (float depth : {min_depth, max_depth})
+            {
+                for (float offset : {-radius, radius})
+                {
+                    glm::vec2 ndc{
+                        (centre.x + offset) * projection[0][0] / depth,
+                        (centre.y + offset) * projection[1][1] / depth,
+                    };
+                    ndc_min = glm::min(ndc_min, ndc);
+                    ndc_max = glm::max(ndc_max, ndc);
+                }
+            }
+            if (ndc_max.x < -1.0f || ndc_max.y < -1.0f || ndc_min.x > 1.0f || ndc_min.y > 1.0f)
+            {
+                continue;
+            }
+            x0 = tile(ndc_min.x, CLUSTERS_X);
+            x1 = tile(ndc_max.x, CLUSTERS_X);
+            y0 = tile(ndc_min.y, CLUSTERS_Y);
+            y1 = tile(ndc_max.y, CLUSTERS_Y);
+        }
+
+        auto overlap_count = overlaps_.size();
+        float radius_squared = radius * radius;
+        for (int z = z0; z <= z1; z++)
+        {
+            for (int y = y0; y <= y1; y++)
+            {
+                for (int x = x0; x <= x1; x++)
+                {
+                    auto cluster =
+                        static_cast<std::uint32_t>(x + CLUSTERS_X * (y + CLUSTERS_Y * z));
+                    if (distance_squared(cluster_bounds_[cluster], centre) <= radius_squared)
+                    {
+                        overlaps_.emplace_back(cluster, i);
+                    }
+                }
+            }
+        }
+        stats_.visible_lights += overlaps_.size() > overlap_count;
+    }
+
+    // Counting sort the overlaps by cluster, giving each cluster a contiguous range of indices
+    for (auto& cluster : clusters_)
+    {
+        cluster = {};
+    }
+    for (auto& [cluster, light] : overlaps_)
+    {
+        clusters_[cluster].count++;
+    }
+    std::uint32_t offset = 0;
+    for (auto& cluster : clusters_)
+    {
+        cluster.offset = offset;
+        offset += cluster.count;
+        stats_.max_lights_per_cluster =
+            std::max(stats_.max_lights_per_cluster, static_cast<int>(cluster.count));
+        cluster.count = 0;
+    }
+
+    light_indices_.resize(overlaps_.size());
+    for (auto& [cluster, light] : overlaps_)
+    {
+        auto& range = clusters_[cluster];
+        light_indices_[range.offset + range.count++] = light;
+    }
+    stats_.light_indices = static_cast<int>(light_indices_.size());
+}
+
+void LightClusters::upload(const std::vector<PointLight>& lights, const glm::vec2& framebuffer_size)
+{
+    ClusterInfo info;
+    float log_depth_range = std::log(far_ / near_);
+    info.cluster_params = {
+        framebuffer_size.x / CLUSTERS_X,
+        framebuffer_size.y / CLUSTERS_Y,
+        CLUSTERS_Z / log_depth_range,
+        CLUSTERS_Z * std::log(near_) / log_depth_range,
+    };
+    info_ubo_.buffer_sub_data(0, info);
+    info_ubo_.bind_buffer_base(BindBufferTarget::UniformBuffer, INFO_UBO_INDEX);
+
+    reserve(lights_ssbo_, lights_capacity_, sizeof(PointLight) * lights.size(), LIGHTS_SSBO_INDEX);
+    reserve(indices_ssbo_, indices_capacity_, sizeof(std::uint32_t) * light_indices_.size(),
+            INDICES_SSBO_INDEX);
+
+    glNamedBufferSubData(lights_ssbo_.id, 0, sizeof(PointLight) * lights.size(), lights.data());
+    glNamedBufferSubData(clusters_ssbo_.id, 0, sizeof(ClusterRange) * clusters_.size(),
+                         clusters_.data());
+    glNamedBufferSubData(indices_ssbo_.id, 0, sizeof(std::uint32_t) * light_indices_.size(),
+                         light_indices_.data());
+
+    clusters_ssbo_.bind_buffer_base(BindBufferTarget::ShaderStorageBuffer, CLUSTERS_SSBO_INDEX);
+}
+
+const std::vector<LightClusters::ClusterRange>& LightClusters::get_clusters() const
+{
+    return clusters_;
+}
+
+const std::vector<std::uint32_t>& LightClusters::get_light_indices() const
+{
+    return light_indices_;
+}
+
+const LightClusters::Stats& LightClusters::get_stats() const
+{
+    return stats_;
+}
+
+void LightClusters::build_cluster_bounds(const glm::mat4& projection)
+{
+    projection_ = projection;
+
+    // Recover the near and far planes from the perspective projection matrix
+    near_ = projection[3][2] / (projection[2][2] - 1.0f);
+    far_ = projection[3][2] / (projection[2][2] + 1.0f);
+
+    cluster_bounds_.resize(CLUSTER_COUNT);
+    for (int z = 0; z < CLUSTERS_Z; z++)
+    {
+        float slice_near = near_ * std::pow(far_ / near_, static_cast<float>(z) / CLUSTERS_Z);
+        float slice_far = near_ * std::pow(far_ / near_, static_cast<float>(z + 1) / CLUSTERS_Z);
+        for (int y = 0; y < CLUSTERS_Y; y++)
+        {
+            for (int x = 0; x < CLUSTERS_X; x++)
+            {
+                // Corners of the tile in normalized device coordinates
+                float ndc_x0 = static_cast<float>(x) / CLUSTERS_X * 2.0f - 1.0f;
+                float ndc_x1 = static_cast<float>(x + 1) / CLUSTERS_X * 2.0f - 1.0f;
+                float ndc_y0 = static_cast<float>(y) / CLUSTERS_Y * 2.0f - 1.0f;
+                float ndc_y1 = static_cast<float>(y + 1) / CLUSTERS_Y * 2.0f - 1.0f;
+
+                AABB& bounds = cluster_bounds_[x + CLUSTERS_X * (y + CLUSTERS_Y * z)];
+                bounds = {};
+                for (float depth : {slice_near, slice_far})
+                {
+                    for (float ndc_x : {ndc_x0, ndc_x1})
+                    {
+                        for (float ndc_y : {ndc_y0, ndc_y1})
+                        {
+                            bounds.expand({ndc_x * depth / projection[0][0],
+                                           ndc_y * depth / projection[1][1], -depth});
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LightClusters::reserve(BufferObject& buffer, GLsizeiptr& capacity, GLsizeiptr bytes,
+                            GLuint index)
+{
+    // Buffers must have storage to be bound, even if there is nothing to put in them
+    if (bytes > capacity || capacity == 0)
+    {
+        capacity = std::max(MIN_BUFFER_SIZE, std::max(bytes, capacity * 2));
+        buffer.reset();
+        buffer.create_store(capacity);
+    }
+    buffer.bind_buffer_base(BindBufferTarget::ShaderStorageBuffer, index);
+}
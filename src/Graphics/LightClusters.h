@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "../Utils/Maths.h"
+#include "Lights.h"
+#include "OpenGL/VertexArray.h"
+
+/// Distance at which the point light's contribution becomes too small to be seen
+float calculate_light_radius(const PointLight& light);
+
+/**
+ * @brief Bins point lights into a grid of view space clusters, so each fragment only needs to
+ * evaluate the lights that can reach it.
+ *
+ * The screen is split into tiles, and each tile is split along the view direction into slices
+ * that grow exponentially with distance. Each cluster stores a range into a flat list of light
+ * indices, which along with the lights themselves are uploaded as shader storage buffers.
+ *
+ * Shaders access them using the "PointLights", "LightClusters" and "LightIndices" buffer blocks
+ * and the "LightClusterInfo" uniform block.
+ */
+class LightClusters
+{
+  public:
+    constexpr static int CLUSTERS_X = 16;
+    constexpr static int CLUSTERS_Y = 9;
+    constexpr static int CLUSTERS_Z = 24;
+    constexpr static int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+    // Binding points for the blocks used in the shaders
+    constexpr static GLuint INFO_UBO_INDEX = 3;
+    constexpr static GLuint LIGHTS_SSBO_INDEX = 0;
+    constexpr static GLuint CLUSTERS_SSBO_INDEX = 1;
+    constexpr static GLuint INDICES_SSBO_INDEX = 2;
+
+    /// Must match the layout of "LightClusterInfo" in the shaders (std140)
+    struct ClusterInfo
+    {
+        glm::uvec4 cluster_counts{CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, 0};
+
+        // xy: Size of a tile in pixels, z: Slice scale, w: Slice bias
+        glm::vec4 cluster_params{0.0f};
+    };
+
+    /// Offset and count into the light indices for a single cluster
+    struct ClusterRange
+    {
+        std::uint32_t offset = 0;
+        std::uint32_t count = 0;
+    };
+
+    struct Stats
+    {
+        int lights = 0;
+        int visible_lights = 0;
+        int light_indices = 0;
+        int max_lights_per_cluster = 0;
+    };
+
+    LightClusters();
+
+    /**
+     * @brief Assigns lights to the clusters on the CPU, without touching OpenGL
+     *
+     * @param lights The lights, in world space
+     * @param view The camera view matrix
+     * @param projection The camera projection matrix, must be a perspective projection
+     */
+    void build(const std::vector<PointLight>& lights, const glm::mat4& view,
+               const glm::mat4& projection);
+
+    /// Uploads the lights and clusters to the GPU and binds them to their indices. The clusters
+    /// are split across the size of the framebuffer that is lit with them, not the window's.
+    void upload(const std::vector<PointLight>& lights, const glm::vec2& framebuffer_size);
+
+    const std::vector<ClusterRange>& get_clusters() const;
+    const std::vector<std::uint32_t>& get_light_indices() const;
+    const Stats& get_stats() const;
+
+  private:
+    void build_cluster_bounds(const glm::mat4& projection);
+
+    /// Resizes the buffer if it is too small, as storage created with glNamedBufferStorage is
+    /// immutable
+    void reserve(BufferObject& buffer, GLsizeiptr& capacity, GLsizeiptr bytes, GLuint index);
+
+    std::vector<AABB> cluster_bounds_;
+    std::vector<ClusterRange> clusters_;
+    std::vector<std::uint32_t> light_indices_;
+
+    // Cluster index and light index pair for every light/cluster overlap, before sorting
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> overlaps_;
+
+    glm::mat4 projection_{0.0f};
+    float near_ = 0.0f;
+    float far_ = 0.0f;
+
+    BufferObject info_ubo_;
+    BufferObject lights_ssbo_;
+    BufferObject clusters_ssbo_;
+    BufferObject indices_ssbo_;
+    GLsizeiptr lights_capacity_ = 0;
+    GLsizeiptr indices_capacity_ = 0;
+
+    Stats stats_;
+};
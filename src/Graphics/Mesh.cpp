@@ -1,10 +1,109 @@
 #include "Mesh.h"
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
 #include <numeric>
+#include <thread>
 
 #include <SFML/Graphics/Image.hpp>
 
 #include "../Utils/HeightMap.h"
+#include "../Utils/Simd.h"
+
+namespace
+{
+    // Below this many vertices the threads cost more than they save
+    constexpr std::size_t MIN_VERTICES_PER_THREAD = 64 * 1024;
+
+    glm::vec3 calculate_terrain_normal(const HeightMap& height_map, int x, int z)
+    {
+        float height_left = x > 0 ? height_map.get_height(x - 1, z) : 0;
+        float height_right = x < height_map.size - 1 ? height_map.get_height(x + 1, z) : 0;
+        float height_down = z > 0 ? height_map.get_height(x, z - 1) : 0;
+        float height_up = z < height_map.size - 1 ? height_map.get_height(x, z + 1) : 0;
+
+        return glm::normalize(glm::vec3{
+            height_left - height_right,
+            2.0f,
+            height_down - height_up,
+        });
+    }
+
+    void write_terrain_vertex(BasicVertex& vertex, int x, int z, float height,
+                              const glm::vec3& normal)
+    {
+        vertex.position = {static_cast<float>(x), height, static_cast<float>(z)};
+        vertex.texture_coord = {static_cast<float>(x), static_cast<float>(z)};
+        vertex.normal = normal;
+    }
+
+    /// Generates one row of terrain vertices. Points with all four neighbours read them straight
+    /// from the rows above and below, four at a time when SSE2 is available.
+    void generate_terrain_row(const HeightMap& height_map, int border, int z, int size,
+                              BasicVertex* out)
+    {
+        int row_z = z + border;
+        const float* row = height_map.heights.data() + row_z * height_map.size + border;
+
+        // Points on the edges of the height map are missing neighbours, so are done one by one
+        bool has_rows = row_z > 0 && row_z < height_map.size - 1;
+        int begin = has_rows ? (border > 0 ? 0 : 1) : size;
+        int end = has_rows ? (border > 0 ? size : size - 1) : size;
+        for (int x = 0; x < std::min(begin, size); x++)
+        {
+            write_terrain_vertex(out[x], x, z, row[x],
+                                 calculate_terrain_normal(height_map, x + border, row_z));
+        }
+        for (int x = std::max(end, begin); x < size; x++)
+        {
+            write_terrain_vertex(out[x], x, z, row[x],
+                                 calculate_terrain_normal(height_map, x + border, row_z));
+        }
+        if (begin >= end)
+        {
+            return;
+        }
+
+        const float* down = row - height_map.size;
+        const float* up = row + height_map.size;
+        int x = begin;
+#ifdef SPOOKY_USE_SSE
+        // The normal is normalize(left - right, 2, down - up)
+        const __m128 two_squared = _mm_set1_ps(4.0f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        alignas(16) float normal_x[4];
+        alignas(16) float normal_z[4];
+        alignas(16) float inverse_length[4];
+        for (; x + 4 <= end; x += 4)
+        {
+            __m128 nx = _mm_sub_ps(_mm_loadu_ps(row + x - 1), _mm_loadu_ps(row + x + 1));
+            __m128 nz = _mm_sub_ps(_mm_loadu_ps(down + x), _mm_loadu_ps(up + x));
+            __m128 length_squared =
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(nz, nz)), two_squared);
+            __m128 inverse = _mm_div_ps(one, _mm_sqrt_ps(length_squared));
+
+            _mm_store_ps(normal_x, _mm_mul_ps(nx, inverse));
+            _mm_store_ps(normal_z, _mm_mul_ps(nz, inverse));
+            _mm_store_ps(inverse_length, inverse);
+            for (int i = 0; i < 4; i++)
+            {
+                write_terrain_vertex(out[x + i], x + i, z, row[x + i],
+                                     {normal_x[i], 2.0f * inverse_length[i], normal_z[i]});
+            }
+        }
+#endif
+        for (; x < end; x++)
+        {
+            float nx = row[x - 1] - row[x + 1];
+            float nz = down[x] - up[x];
+            float inverse = 1.0f / std::sqrt(nx * nx + 4.0f + nz * nz);
+            write_terrain_vertex(out[x], x, z, row[x],
+                                 {nx * inverse, 2.0f * inverse, nz * inverse});
+        }
+    }
+} // namespace
 
 /*
 Cool blue RGB:
@@ -174,56 +273,150 @@ BasicMesh generate_terrain_mesh(const HeightMap& height_map)
 
 void update_terrain_mesh(BasicMesh& mesh, const HeightMap& height_map)
 {
-    float sizef = static_cast<float>(height_map.size);
+    generate_terrain_vertices(height_map, mesh.vertices);
+    generate_terrain_indices(height_map.size, mesh.indices);
+}
 
-    mesh.vertices.clear();
-    mesh.indices.clear();
+void generate_terrain_vertices(const HeightMap& height_map, std::vector<BasicVertex>& vertices,
+                               int border, unsigned thread_count)
+{
+    int size = height_map.size - border * 2;
+    vertices.resize(static_cast<std::size_t>(size) * size);
+    generate_terrain_vertices(height_map, std::span{vertices}, border, thread_count);
+}
 
-    for (int z = 0; z < height_map.size; z++)
+void generate_terrain_vertices(const HeightMap& height_map, std::span<BasicVertex> vertices,
+                               int border, unsigned thread_count)
+{
+    int size = height_map.size - border * 2;
+    assert(vertices.size() >= static_cast<std::size_t>(size) * size);
+
+    if (thread_count == 0)
     {
-        for (int x = 0; x < height_map.size; x++)
-        {
-            GLfloat fz = static_cast<GLfloat>(z);
-            GLfloat fx = static_cast<GLfloat>(x);
+        thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    thread_count = static_cast<unsigned>(std::clamp<std::size_t>(
+        static_cast<std::size_t>(size) * size / MIN_VERTICES_PER_THREAD, 1, thread_count));
 
-            BasicVertex vertex;
-            vertex.position.x = fx;
-            vertex.position.y = height_map.get_height(x, z);
-            vertex.position.z = fz;
+    // Each thread generates its own block of rows
+    auto generate_rows = [&](unsigned i)
+    {
+        int end = static_cast<int>(static_cast<std::size_t>(size) * (i + 1) / thread_count);
+        for (int z = static_cast<int>(static_cast<std::size_t>(size) * i / thread_count); z < end;
+             z++)
+        {
+            generate_terrain_row(height_map, border, z, size, vertices.data() + z * size);
+        }
+    };
 
-            vertex.texture_coord.s = fx;
-            vertex.texture_coord.t = fz;
+    std::vector<std::jthread> threads;
+    for (unsigned i = 1; i < thread_count; i++)
+    {
+        threads.emplace_back(generate_rows, i);
+    }
+    generate_rows(0);
+}
 
-            float height_left = x > 0 ? height_map.get_height(x - 1, z) : 0;
-            float height_right = x < height_map.size - 1 ? height_map.get_height(x + 1, z) : 0;
-            float height_down = z > 0 ? height_map.get_height(x, z - 1) : 0;
-            float height_up = z < height_map.size - 1 ? height_map.get_height(x, z + 1) : 0;
+void generate_terrain_indices(int size, std::vector<GLuint>& indices)
+{
+    indices.clear();
 
-            vertex.normal = glm::normalize(glm::vec3{
-                height_left - height_right,
-                2.0f,
-                height_down - height_up,
-            });
+    // The indices are grouped by tile so each tile can be drawn as one range of the index buffer
+    int quads = size - 1;
+    for (int tile_z = 0; tile_z < quads; tile_z += TERRAIN_TILE_SIZE)
+    {
+        for (int tile_x = 0; tile_x < quads; tile_x += TERRAIN_TILE_SIZE)
+        {
+            for (int z = tile_z; z < std::min(tile_z + TERRAIN_TILE_SIZE, quads); z++)
+            {
+                for (int x = tile_x; x < std::min(tile_x + TERRAIN_TILE_SIZE, quads); x++)
+                {
+                    int topLeft = (z * size) + x;
+                    int topRight = topLeft + 1;
+                    int bottomLeft = ((z + 1) * size) + x;
+                    int bottomRight = bottomLeft + 1;
+
+                    indices.push_back(topLeft);
+                    indices.push_back(bottomLeft);
+                    indices.push_back(topRight);
+                    indices.push_back(topRight);
+                    indices.push_back(bottomLeft);
+                    indices.push_back(bottomRight);
+                }
+            }
+        }
+    }
+}
 
-            mesh.vertices.push_back(vertex);
+std::vector<TerrainTile> generate_terrain_tiles(const HeightMap& height_map)
+{
+    // Must match the order the indices are created in update_terrain_mesh
+    std::vector<TerrainTile> tiles;
+    GLuint first_index = 0;
+    int quads = height_map.size - 1;
+    for (int tile_z = 0; tile_z < quads; tile_z += TERRAIN_TILE_SIZE)
+    {
+        for (int tile_x = 0; tile_x < quads; tile_x += TERRAIN_TILE_SIZE)
+        {
+            int end_x = std::min(tile_x + TERRAIN_TILE_SIZE, quads);
+            int end_z = std::min(tile_z + TERRAIN_TILE_SIZE, quads);
+
+            TerrainTile& tile = tiles.emplace_back();
+            tile.first_index = first_index;
+            tile.index_count = (end_x - tile_x) * (end_z - tile_z) * 6;
+            first_index += tile.index_count;
+
+            // Vertices on the far edges are shared with the next tile, which get_min_max includes
+            auto min_max = height_map.get_min_max(tile_x, tile_z, end_x - tile_x, end_z - tile_z);
+            tile.bounds.expand({static_cast<float>(tile_x), min_max.x, static_cast<float>(tile_z)});
+            tile.bounds.expand({static_cast<float>(end_x), min_max.y, static_cast<float>(end_z)});
         }
     }
+    return tiles;
+}
+
+std::vector<std::vector<std::uint8_t>> generate_terrain_splat_map(const HeightMap& height_map,
+                                                                  int border, float peak_height)
+{
+    int size = height_map.size - border * 2;
+    std::vector<std::vector<std::uint8_t>> splat_map(
+        TERRAIN_SPLAT_MAP_LAYERS,
+        std::vector<std::uint8_t>(static_cast<std::size_t>(size) * size * 4));
+
+    // Snow only appears on terrain with tall enough peaks
+    float max_height = peak_height > 0.0f ? peak_height : height_map.max_height();
+    float snow_begin = max_height * 0.75f;
+    float snow_end = max_height * 0.8f;
 
-    for (int z = 0; z < height_map.size - 1; z++)
+    for (int z = 0; z < size; z++)
     {
-        for (int x = 0; x < height_map.size - 1; x++)
+        for (int x = 0; x < size; x++)
         {
-            int topLeft = (z * height_map.size) + x;
-            int topRight = topLeft + 1;
-            int bottomLeft = ((z + 1) * height_map.size) + x;
-            int bottomRight = bottomLeft + 1;
-
-            mesh.indices.push_back(topLeft);
-            mesh.indices.push_back(bottomLeft);
-            mesh.indices.push_back(topRight);
-            mesh.indices.push_back(topRight);
-            mesh.indices.push_back(bottomLeft);
-            mesh.indices.push_back(bottomRight);
+            // Slopes are exaggerated so that only fairly flat ground is covered in grass or snow
+            auto normal = calculate_terrain_normal(height_map, x + border, z + border);
+            float flat = std::clamp(glm::normalize(normal * glm::vec3{3.0f, 1.0f, 3.0f}).y, 0.0f,
+                                    1.0f);
+
+            float snow = 0.0f;
+            if (max_height > 100.0f)
+            {
+                snow = std::clamp((height_map.get_height(x + border, z + border) - snow_begin) /
+                                      (snow_end - snow_begin),
+                                  0.0f, 1.0f);
+            }
+
+            std::array<float, TERRAIN_LAYER_COUNT> weights{};
+            weights[TERRAIN_LAYER_GRASS] = flat * (1.0f - snow);
+            weights[TERRAIN_LAYER_MUD] = 1.0f - flat;
+            weights[TERRAIN_LAYER_SNOW] = flat * snow;
+
+            for (int layer = 0; layer < TERRAIN_LAYER_COUNT; layer++)
+            {
+                auto texel = (static_cast<std::size_t>(z) * size + x) * 4 + layer % 4;
+                splat_map[layer / 4][texel] =
+                    static_cast<std::uint8_t>(weights[layer] * 255.0f + 0.5f);
+            }
         }
     }
+    return splat_map;
 }
@@ -2,12 +2,14 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <span>
 #include <vector>
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include "../Utils/Maths.h"
 #include "OpenGL/VertexArray.h"
 
 struct HeightMap;
@@ -52,14 +54,44 @@ class Mesh
     void buffer();
     void update();
 
+    /**
+     * @brief Buffers the mesh straight from memory that is not owned by the mesh, such as a
+     * region of a MappedFile, leaving the vertices and indices vectors empty.
+     *
+     * The storage is immutable so the mesh cannot be updated afterwards, and the memory only
+     * needs to stay valid for the duration of the call. Empty spans create no storage, so the
+     * mesh has nothing to draw.
+     *
+     * @param vertices Tightly packed vertices of the mesh's vertex type
+     * @param indices Tightly packed GLuint indices
+     * @param bounds Local space bounding box of the vertices
+     */
+    void buffer(std::span<const std::byte> vertices, std::span<const std::byte> indices,
+                const AABB& bounds);
+
+    /**
+     * @brief Same as above, but uses an index buffer owned elsewhere, so meshes with the same
+     * indices can share them. The index buffer must outlive the mesh.
+     *
+     * @param index_count Number of GLuint indices in the index buffer
+     */
+    void buffer(std::span<const std::byte> vertices, const BufferObject& indices,
+                GLuint index_count, const AABB& bounds);
+
     void bind() const;
     void draw(GLenum draw_mode = GL_TRIANGLES) const;
+    void draw_elements(GLuint first_index, GLuint count, GLenum draw_mode = GL_TRIANGLES) const;
+
+    /// Recalculates the local space bounding box from the vertices. Called by buffer/update.
+    void update_bounds();
+    const AABB& get_bounds() const;
 
   private:
     VertexArray vao_;
     BufferObject vbo_;
     BufferObject ebo_;
 
+    AABB bounds_;
     GLuint indices_ = 0;
 
     bool buffered_ = false;
@@ -94,6 +126,63 @@ inline void Mesh<VertexType>::buffer()
     vbo_.buffer_data(vertices);
     VertexType::link_attribs(vao_, vbo_);
 
+    update_bounds();
+    buffered_ = true;
+}
+
+template <typename VertexType>
+inline void Mesh<VertexType>::buffer(std::span<const std::byte> vertices,
+                                     std::span<const std::byte> indices, const AABB& bounds)
+{
+    assert(vertices.size() % sizeof(VertexType) == 0);
+    assert(indices.size() % sizeof(GLuint) == 0);
+
+    vao_.reset();
+    vbo_.reset();
+    ebo_.reset();
+
+    indices_ = static_cast<GLuint>(indices.size() / sizeof(GLuint));
+
+    // Immutable storage cannot be 0 bytes
+    if (!indices.empty() && !vertices.empty())
+    {
+        ebo_.create_store(indices);
+        glVertexArrayElementBuffer(vao_.id, ebo_.id);
+
+        vbo_.create_store(vertices);
+        VertexType::link_attribs(vao_, vbo_);
+    }
+    else
+    {
+        indices_ = 0;
+    }
+
+    bounds_ = bounds;
+    buffered_ = true;
+}
+
+template <typename VertexType>
+inline void Mesh<VertexType>::buffer(std::span<const std::byte> vertices,
+                                     const BufferObject& indices, GLuint index_count,
+                                     const AABB& bounds)
+{
+    assert(vertices.size() % sizeof(VertexType) == 0);
+
+    vao_.reset();
+    vbo_.reset();
+    ebo_.reset();
+
+    indices_ = index_count;
+    glVertexArrayElementBuffer(vao_.id, indices.id);
+
+    // Immutable storage cannot be 0 bytes
+    if (!vertices.empty())
+    {
+        vbo_.create_store(vertices);
+        VertexType::link_attribs(vao_, vbo_);
+    }
+
+    bounds_ = bounds;
     buffered_ = true;
 }
 
@@ -114,6 +203,7 @@ inline void Mesh<VertexType>::update()
     }
     ebo_.buffer_sub_data(0, indices);
     vbo_.buffer_sub_data(0, vertices);
+    update_bounds();
 }
 
 template <typename VertexType>
@@ -129,9 +219,89 @@ inline void Mesh<VertexType>::draw(GLenum draw_mode) const
     glDrawElements(draw_mode, indices_, GL_UNSIGNED_INT, nullptr);
 }
 
+template <typename VertexType>
+inline void Mesh<VertexType>::draw_elements(GLuint first_index, GLuint count,
+                                            GLenum draw_mode) const
+{
+    assert(first_index + count <= indices_);
+    glDrawElements(draw_mode, count, GL_UNSIGNED_INT,
+                   reinterpret_cast<const void*>(first_index * sizeof(GLuint)));
+}
+
+template <typename VertexType>
+inline void Mesh<VertexType>::update_bounds()
+{
+    bounds_ = AABB{};
+    for (auto& vertex : vertices)
+    {
+        bounds_.expand(vertex.position);
+    }
+}
+
+template <typename VertexType>
+inline const AABB& Mesh<VertexType>::get_bounds() const
+{
+    return bounds_;
+}
+
+/// Number of quads along each side of a terrain tile
+constexpr int TERRAIN_TILE_SIZE = 64;
+
+/// Section of the terrain mesh's indices which can be culled and drawn on its own
+struct TerrainTile
+{
+    AABB bounds;
+    GLuint first_index = 0;
+    GLuint index_count = 0;
+};
+
+/// Materials that are blended across the terrain, in the order of the terrain texture array layers
+enum TerrainLayer
+{
+    TERRAIN_LAYER_GRASS,
+    TERRAIN_LAYER_MUD,
+    TERRAIN_LAYER_SNOW,
+
+    TERRAIN_LAYER_COUNT,
+};
+
+/// Each splat map layer holds the weights of four terrain layers in its RGBA channels
+constexpr int TERRAIN_SPLAT_MAP_LAYERS = (TERRAIN_LAYER_COUNT + 3) / 4;
+
 [[nodiscard]] BasicMesh generate_quad_mesh(float w, float h);
 [[nodiscard]] BasicMesh generate_plane_mesh(float w, float d);
 [[nodiscard]] BasicMesh generate_cube_mesh(const glm::vec3& size, bool repeat_texture);
 [[nodiscard]] BasicMesh generate_centered_cube_mesh(const glm::vec3& size);
 [[nodiscard]] BasicMesh generate_terrain_mesh(const HeightMap& height_map);
-void update_terrain_mesh(BasicMesh& mesh, const HeightMap& height_map);
\ No newline at end of file
+void update_terrain_mesh(BasicMesh& mesh, const HeightMap& height_map);
+[[nodiscard]] std::vector<TerrainTile> generate_terrain_tiles(const HeightMap& height_map);
+
+/**
+ * @brief Generates a vertex for each point of the height map. The border is a number of points
+ * around the edges that are only used for the normals, so meshes of neighbouring height maps line
+ * up.
+ *
+ * Blocks of rows are generated in parallel once the map is large enough to be worth it.
+ *
+ * @param thread_count Number of threads to generate with, 0 picks based on the hardware
+ */
+void generate_terrain_vertices(const HeightMap& height_map, std::vector<BasicVertex>& vertices,
+                               int border = 0, unsigned thread_count = 0);
+
+/// Writes the vertices straight into memory that already holds enough of them, such as a mapped
+/// vertex buffer
+void generate_terrain_vertices(const HeightMap& height_map, std::span<BasicVertex> vertices,
+                               int border = 0, unsigned thread_count = 0);
+
+/// Generates the indices of a size x size grid of terrain vertices, grouped by terrain tile
+void generate_terrain_indices(int size, std::vector<GLuint>& indices);
+
+/**
+ * @brief Generates the weight of each terrain layer at every point of the height map, as one
+ * RGBA8 image per splat map layer.
+ *
+ * @param border Number of points around the edges to leave out, as with the vertices
+ * @param peak_height Height that snow is placed relative to, 0 uses the highest point of the map
+ */
+[[nodiscard]] std::vector<std::vector<std::uint8_t>>
+generate_terrain_splat_map(const HeightMap& height_map, int border = 0, float peak_height = 0.0f);
\ No newline at end of file
@@ -1,17 +1,184 @@
 #include "Model.h"
 
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
 #include <assimp/Importer.hpp>
 
+#include "../Utils/MappedFile.h"
+#include "../Utils/Util.h"
+#include "AssetCache.h"
 #include "OpenGL/Shader.h"
 #include <iostream>
 
+namespace
+{
+    // Cooked models are a header, followed by the texture table, followed by each mesh's header,
+    // texture indices, vertices and indices. Every section is padded to 4 bytes.
+    constexpr std::uint32_t COOKED_MODEL_MAGIC = 0x444D4253; // "SBMD"
+
+    // Must be incremented when the layout or the Assimp import flags change
+    constexpr std::uint32_t COOKED_MODEL_VERSION = 1;
+
+    const std::filesystem::path COOKED_MODEL_DIRECTORY = "cache/models";
+
+    struct CookedModelHeader
+    {
+        std::uint32_t magic = COOKED_MODEL_MAGIC;
+        std::uint32_t version = COOKED_MODEL_VERSION;
+
+        // The source is only hashed when its timestamp or size changes
+        std::int64_t source_timestamp = 0;
+        std::uint64_t source_size = 0;
+        std::uint64_t source_hash = 0;
+
+        std::uint32_t mesh_count = 0;
+        std::uint32_t texture_count = 0;
+        AABB bounds;
+    };
+
+    struct CookedTexture
+    {
+        std::uint32_t type_length = 0;
+        std::uint32_t path_length = 0;
+    };
+
+    struct CookedMesh
+    {
+        std::uint32_t vertex_count = 0;
+        std::uint32_t index_count = 0;
+        std::uint32_t texture_count = 0;
+        std::uint32_t padding_ = 0;
+        AABB bounds;
+    };
+
+    static_assert(std::is_trivially_copyable_v<CookedModelHeader>);
+    static_assert(std::is_trivially_copyable_v<BasicVertex>);
+
+    std::filesystem::path get_cooked_path(const std::filesystem::path& source)
+    {
+        auto key = source.lexically_normal().generic_string();
+        auto hash = hash_bytes(key.data(), key.size());
+        return COOKED_MODEL_DIRECTORY / (source.stem().string() + "_" + std::to_string(hash) + ".model");
+    }
+
+    std::uint64_t hash_file(const std::filesystem::path& path)
+    {
+        MappedFile file;
+        if (!file.open(path))
+        {
+            return 0;
+        }
+        return hash_bytes(file.data(), file.size());
+    }
+
+    std::int64_t get_timestamp(const std::filesystem::path& path)
+    {
+        std::error_code error;
+        return std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    }
+
+    /// Reads values from a byte buffer, failing rather than reading past the end
+    class BinaryReader
+    {
+      public:
+        BinaryReader(std::span<const std::byte> bytes)
+            : bytes_(bytes)
+        {
+        }
+
+        template <typename T>
+        bool read(T* out, std::size_t count = 1)
+        {
+            auto size = sizeof(T) * count;
+            if (offset_ + size > bytes_.size())
+            {
+                return false;
+            }
+            if (size > 0)
+            {
+                std::memcpy(out, bytes_.data() + offset_, size);
+            }
+            offset_ += (size + 3) & ~std::size_t{3};
+            return true;
+        }
+
+        /// Points the span at the next bytes rather than copying them out
+        bool view(std::span<const std::byte>* out, std::size_t size)
+        {
+            if (offset_ + size > bytes_.size())
+            {
+                return false;
+            }
+            *out = bytes_.subspan(offset_, size);
+            offset_ += (size + 3) & ~std::size_t{3};
+            return true;
+        }
+
+      private:
+        std::span<const std::byte> bytes_;
+        std::size_t offset_ = 0;
+    };
+
+    /// Writes values to a file, padding each write to 4 bytes to match BinaryReader. The values
+    /// go to a temporary file until finish(), so a partly written file is never loaded.
+    class BinaryWriter
+    {
+      public:
+        BinaryWriter(const std::filesystem::path& path)
+            : path_(path)
+            , temporary_path_(std::filesystem::path{path} += ".tmp")
+            , file_(temporary_path_, std::ios::binary)
+        {
+        }
+
+        template <typename T>
+        void write(const T* data, std::size_t count = 1)
+        {
+            auto size = sizeof(T) * count;
+            file_.write(reinterpret_cast<const char*>(data), size);
+
+            constexpr char padding[4] = {};
+            file_.write(padding, ((size + 3) & ~std::size_t{3}) - size);
+        }
+
+        /// Moves the file into place if everything was written
+        bool finish()
+        {
+            file_.close();
+            if (!file_)
+            {
+                return false;
+            }
+            std::error_code error;
+            std::filesystem::rename(temporary_path_, path_, error);
+            return !error;
+        }
+
+      private:
+        std::filesystem::path path_;
+        std::filesystem::path temporary_path_;
+        std::ofstream file_;
+    };
+} // namespace
+
 Model::Model(const std::filesystem::path& path)
 {
     load_from_file(path);
 }
 
-bool Model::load_from_file(const std::filesystem::path& path)
+bool Model::load_from_file(const std::filesystem::path& path, AssetCache* asset_cache)
 {
+    directory_ = path.string().substr(0, path.string().find_last_of('/'));
+    asset_cache_ = asset_cache;
+
+    auto cooked_path = get_cooked_path(path);
+    if (load_cooked(path, cooked_path))
+    {
+        return true;
+    }
+
     Assimp::Importer importer;
     auto scene = importer.ReadFile(path.string(), aiProcess_Triangulate | aiProcess_FlipUVs |
                                                       aiProcess_GenNormals);
@@ -23,12 +190,173 @@ bool Model::load_from_file(const std::filesystem::path& path)
         return false;
     }
 
-    directory_ = path.string().substr(0, path.string().find_last_of('/'));
-
     process_node(scene->mRootNode, scene);
+    save_cooked(path, cooked_path);
     return true;
 }
 
+bool Model::load_cooked(const std::filesystem::path& source, const std::filesystem::path& cooked)
+{
+    // Shared with the meshes, which point into it
+    auto file = std::make_shared<MappedFile>();
+    if (!std::filesystem::exists(cooked) || !file->open(cooked))
+    {
+        return false;
+    }
+
+    BinaryReader reader(file->bytes());
+    CookedModelHeader header;
+    if (!reader.read(&header) || header.magic != COOKED_MODEL_MAGIC ||
+        header.version != COOKED_MODEL_VERSION)
+    {
+        return false;
+    }
+
+    // The source is only hashed if it looks like it has changed, so touching the file without
+    // changing it does not cause it to be re-imported. If the source is missing then the cooked
+    // model is used as is.
+    bool refresh_timestamp = false;
+    std::error_code error;
+    auto source_size = std::filesystem::file_size(source, error);
+    if (!error)
+    {
+        auto timestamp = get_timestamp(source);
+        if (timestamp != header.source_timestamp || source_size != header.source_size)
+        {
+            if (hash_file(source) != header.source_hash)
+            {
+                return false;
+            }
+            header.source_timestamp = timestamp;
+            header.source_size = source_size;
+            refresh_timestamp = true;
+        }
+    }
+
+    // The header is updated before the meshes are read, as the file stays mapped afterwards
+    if (refresh_timestamp)
+    {
+        file->close();
+        {
+            std::fstream out(cooked, std::ios::binary | std::ios::in | std::ios::out);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+        if (!file->open(cooked))
+        {
+            return false;
+        }
+        CookedModelHeader skipped_header;
+        reader = BinaryReader(file->bytes());
+        reader.read(&skipped_header);
+    }
+
+    std::vector<std::size_t> textures;
+    for (std::uint32_t i = 0; i < header.texture_count; i++)
+    {
+        CookedTexture texture;
+        if (!reader.read(&texture))
+        {
+            return false;
+        }
+        std::string type(texture.type_length, '\0');
+        std::string path(texture.path_length, '\0');
+        if (!reader.read(type.data(), type.size()) || !reader.read(path.data(), path.size()))
+        {
+            return false;
+        }
+        textures.push_back(load_texture(path, type));
+    }
+
+    std::vector<ModelMesh> meshes(header.mesh_count);
+    for (auto& mesh : meshes)
+    {
+        CookedMesh cooked_mesh;
+        if (!reader.read(&cooked_mesh))
+        {
+            return false;
+        }
+
+        std::vector<std::uint32_t> texture_indices(cooked_mesh.texture_count);
+        std::span<const std::byte> vertices;
+        std::span<const std::byte> indices;
+        if (!reader.read(texture_indices.data(), texture_indices.size()) ||
+            !reader.view(&vertices, sizeof(BasicVertex) * cooked_mesh.vertex_count) ||
+            !reader.view(&indices, sizeof(GLuint) * cooked_mesh.index_count))
+        {
+            return false;
+        }
+
+        for (auto index : texture_indices)
+        {
+            if (index >= textures.size())
+            {
+                return false;
+            }
+            mesh.textures.push_back(static_cast<int>(textures[index]));
+        }
+
+        // The vertices and indices go straight from the mapped file to the GPU, so they are never
+        // copied onto the heap. The collision shapes read them from the mapped file too.
+        mesh.mesh.buffer(vertices, indices, cooked_mesh.bounds);
+        mesh.buffered = true;
+        mesh.cooked_file = file;
+        mesh.cooked_vertices = {reinterpret_cast<const BasicVertex*>(vertices.data()),
+                                cooked_mesh.vertex_count};
+        mesh.cooked_indices = {reinterpret_cast<const GLuint*>(indices.data()),
+                               cooked_mesh.index_count};
+    }
+
+    meshes_.insert(meshes_.end(), std::make_move_iterator(meshes.begin()),
+                   std::make_move_iterator(meshes.end()));
+    bounds_.expand(header.bounds);
+    return true;
+}
+
+void Model::save_cooked(const std::filesystem::path& source, const std::filesystem::path& cooked)
+{
+    std::error_code error;
+    std::filesystem::create_directories(cooked.parent_path(), error);
+
+    CookedModelHeader header;
+    header.source_timestamp = get_timestamp(source);
+    header.source_size = std::filesystem::file_size(source, error);
+    header.source_hash = hash_file(source);
+    header.mesh_count = static_cast<std::uint32_t>(meshes_.size());
+    header.texture_count = static_cast<std::uint32_t>(textures_.size());
+    header.bounds = bounds_;
+
+    BinaryWriter writer(cooked);
+    writer.write(&header);
+    for (auto& texture : textures_)
+    {
+        CookedTexture cooked_texture{static_cast<std::uint32_t>(texture.type.size()),
+                                     static_cast<std::uint32_t>(texture.path.size())};
+        writer.write(&cooked_texture);
+        writer.write(texture.type.data(), texture.type.size());
+        writer.write(texture.path.data(), texture.path.size());
+    }
+
+    for (auto& mesh : meshes_)
+    {
+        CookedMesh cooked_mesh;
+        cooked_mesh.vertex_count = static_cast<std::uint32_t>(mesh.mesh.vertices.size());
+        cooked_mesh.index_count = static_cast<std::uint32_t>(mesh.mesh.indices.size());
+        cooked_mesh.texture_count = static_cast<std::uint32_t>(mesh.textures.size());
+        cooked_mesh.bounds = mesh.mesh.get_bounds();
+
+        std::vector<std::uint32_t> texture_indices(mesh.textures.begin(), mesh.textures.end());
+        writer.write(&cooked_mesh);
+        writer.write(texture_indices.data(), texture_indices.size());
+        writer.write(mesh.mesh.vertices.data(), mesh.mesh.vertices.size());
+        writer.write(mesh.mesh.indices.data(), mesh.mesh.indices.size());
+    }
+
+    if (!writer.finish())
+    {
+        std::cerr << "Failed to write cooked model " << cooked << '\n';
+    }
+}
+
 void Model::process_node(aiNode* node, const aiScene* scene)
 {
     for (unsigned i = 0; i < node->mNumMeshes; i++)
@@ -36,7 +364,9 @@ void Model::process_node(aiNode* node, const aiScene* scene)
         auto mesh = scene->mMeshes[node->mMeshes[i]];
         if (mesh->mName != aiString("Collision"))
         {
-            meshes_.push_back(process_mesh(mesh, scene));
+            auto& model_mesh = meshes_.emplace_back(process_mesh(mesh, scene));
+            model_mesh.mesh.update_bounds();
+            bounds_.expand(model_mesh.mesh.get_bounds());
         }
     }
 
@@ -55,47 +385,51 @@ std::vector<size_t> Model::load_material(aiMaterial* material, aiTextureType tex
         aiString str;
         material->GetTexture(texture_type, i, &str);
 
-        // Check if the texture is already in the cache
-        bool should_load = true;
-        for (int i = 0; i < textures_cache_.size(); i++)
+        auto type = [texture_type]()
         {
-            if (textures_cache_[i].path == std::string(str.C_Str()))
+            switch (texture_type)
             {
-                textures.push_back(i);
-                should_load = false;
-                break;
-            }
-        }
 
-        // Load the texture if it is not
-        if (should_load)
-        {
-            Texture texture;
-
-            texture.type = [texture_type]()
-            {
-                switch (texture_type)
-                {
+                case aiTextureType_DIFFUSE:
+                    return "diffuse";
+                    break;
+                case aiTextureType_SPECULAR:
+                    return "specular";
+                    break;
+                default:
+                    return "Unknown";
+            }
+        }();
+        textures.push_back(load_texture(str.C_Str(), type));
+    }
 
-                    case aiTextureType_DIFFUSE:
-                        return "diffuse";
-                        break;
-                    case aiTextureType_SPECULAR:
-                        return "specular";
-                        break;
-                    default:
-                        return "Unknown";
-                }
-            }();
+    return textures;
+}
 
-            texture.path = str.C_Str();
-            texture.texture.load_from_file(directory_ + "/" + str.C_Str(), 1, true, false);
-            textures.push_back(textures_cache_.size());
-            textures_cache_.push_back(std::move(texture));
-        }
+size_t Model::load_texture(const std::string& path, const std::string& type)
+{
+    // Check if the texture is already used by this model
+    auto itr = texture_indices_.find(path);
+    if (itr != texture_indices_.end())
+    {
+        return itr->second;
     }
 
-    return textures;
+    // Load the texture if it is not
+    Texture& texture = textures_.emplace_back();
+    texture.type = type;
+    texture.path = path;
+    if (asset_cache_)
+    {
+        texture.texture = asset_cache_->get_texture(directory_ + "/" + path, 1, true, false);
+    }
+    else
+    {
+        texture.texture = std::make_shared<Texture2D>();
+        texture.texture->load_from_file(directory_ + "/" + path, 1, true, false);
+    }
+    texture_indices_.emplace(path, textures_.size() - 1);
+    return textures_.size() - 1;
 }
 
 Model::ModelMesh Model::process_mesh(aiMesh* ai_mesh, const aiScene* scene)
@@ -160,37 +494,60 @@ Model::ModelMesh Model::process_mesh(aiMesh* ai_mesh, const aiScene* scene)
 
 void Model::draw(Shader& shader)
 {
-    for (ModelMesh& mesh : meshes_)
+    for (std::size_t i = 0; i < meshes_.size(); i++)
     {
-        if (!mesh.buffered)
-        {
-            mesh.mesh.buffer();
-            mesh.buffered = true;
-        }
+        draw_mesh(shader, i);
+    }
+}
 
-        GLuint diffuse_id = 0;
-        GLuint specular_id = 0;
-        for (int i = 0; i < mesh.textures.size(); i++)
-        {
-            std::string number;
-            std::string name = textures_cache_[mesh.textures[i]].type;
-            if (name == "diffuse")
-                number = std::to_string(diffuse_id++);
-            else if (name == "specular")
-                number = std::to_string(specular_id++);
+void Model::draw_mesh(Shader& shader, std::size_t index)
+{
+    ModelMesh& mesh = meshes_[index];
+    if (!mesh.buffered)
+    {
+        mesh.mesh.buffer();
+        mesh.buffered = true;
+    }
 
-            auto uni = "material." + name + number;
-            shader.set_uniform(uni, i);
+    GLuint diffuse_id = 0;
+    GLuint specular_id = 0;
+    for (int i = 0; i < mesh.textures.size(); i++)
+    {
+        std::string number;
+        std::string name = textures_[mesh.textures[i]].type;
+        if (name == "diffuse")
+            number = std::to_string(diffuse_id++);
+        else if (name == "specular")
+            number = std::to_string(specular_id++);
 
-            textures_cache_[mesh.textures[i]].texture.bind(i);
-        }
-        // draw mesh
-        mesh.mesh.bind();
-        mesh.mesh.draw();
+        auto uni = "material." + name + number;
+        shader.set_uniform(uni, i);
+
+        textures_[mesh.textures[i]].texture->bind(i);
     }
+    // draw mesh
+    mesh.mesh.bind();
+    mesh.mesh.draw();
+}
+
+void Model::draw_mesh_depth(std::size_t index)
+{
+    ModelMesh& mesh = meshes_[index];
+    if (!mesh.buffered)
+    {
+        mesh.mesh.buffer();
+        mesh.buffered = true;
+    }
+    mesh.mesh.bind();
+    mesh.mesh.draw();
 }
 
 const std::vector<Model::ModelMesh>& Model::get_meshes() const
 {
     return meshes_;
 }
+
+const AABB& Model::get_bounds() const
+{
+    return bounds_;
+}
@@ -1,21 +1,26 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
+#include <span>
+#include <unordered_map>
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include "../Utils/MappedFile.h"
 #include "Mesh.h"
 #include "OpenGL/Texture.h"
 
+class AssetCache;
 class Shader;
 
 class Model
 {
     struct Texture
     {
-        Texture2D texture;
+        std::shared_ptr<Texture2D> texture;
         std::string type;
         std::string path;
     };
@@ -26,6 +31,13 @@ class Model
         BasicMesh mesh;
         std::vector<int> textures;
 
+        // Vertices and indices of a cooked mesh, which point into the cooked file so they are
+        // never copied onto the heap. Holding onto the file keeps them valid, such as for
+        // collision shapes. Empty for imported meshes, which keep them in the mesh instead.
+        std::shared_ptr<const MappedFile> cooked_file;
+        std::span<const BasicVertex> cooked_vertices;
+        std::span<const GLuint> cooked_indices;
+
         bool buffered = false;
     };
 
@@ -33,16 +45,33 @@ class Model
     Model(const BasicMesh& mesh);
     Model(const std::filesystem::path& path);
 
-    bool load_from_file(const std::filesystem::path& path);
+    /// Loads the model from its cooked binary form if it is up to date, otherwise imports it with
+    /// Assimp and cooks it for next time. Textures are shared through the asset cache and loaded
+    /// in the background if one is given, otherwise they are loaded straight away.
+    bool load_from_file(const std::filesystem::path& path, AssetCache* asset_cache = nullptr);
     void draw(Shader& shader);
+    void draw_mesh(Shader& shader, std::size_t index);
+
+    /// Draws the mesh without binding its textures, for depth only passes
+    void draw_mesh_depth(std::size_t index);
     const std::vector<ModelMesh>& get_meshes() const;
 
+    /// Local space bounds of all the meshes in the model
+    const AABB& get_bounds() const;
+
   private:
     void process_node(aiNode* node, const aiScene* scene);
     ModelMesh process_mesh(aiMesh* mesh, const aiScene* scene);
     std::vector<size_t> load_material(aiMaterial* material, aiTextureType texture_type);
+    size_t load_texture(const std::string& path, const std::string& type);
+
+    bool load_cooked(const std::filesystem::path& source, const std::filesystem::path& cooked);
+    void save_cooked(const std::filesystem::path& source, const std::filesystem::path& cooked);
 
     std::vector<ModelMesh> meshes_;
-    std::vector<Texture> textures_cache_;
+    std::vector<Texture> textures_;
+    std::unordered_map<std::string, std::size_t> texture_indices_;
     std::string directory_;
+    AssetCache* asset_cache_ = nullptr;
+    AABB bounds_;
 };
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include "../Utils/HeightMap.h"
+
+namespace
+{
+    /// Clip space vertex is behind the near plane
+    bool is_behind_near(const glm::vec4& v)
+    {
+        return v.z < -v.w;
+    }
+
+    glm::vec4 intersect_near(const glm::vec4& a, const glm::vec4& b)
+    {
+        float da = a.z + a.w;
+        float db = b.z + b.w;
+        return a + (b - a) * (da / (da - db));
+    }
+
+    /// Signed double area of the triangle, positive when counter-clockwise
+    float edge(const glm::vec3& a, const glm::vec3& b, float x, float y)
+    {
+        return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+    }
+} // namespace
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+{
+    // Each level is half the size of the previous, down to 1x1
+    while (true)
+    {
+        Level& level = levels_.emplace_back();
+        level.width = width;
+        level.height = height;
+        level.depth.resize(width * height, 1.0f);
+        if (width == 1 && height == 1)
+        {
+            break;
+        }
+        width = std::max(1, (width + 1) / 2);
+        height = std::max(1, (height + 1) / 2);
+    }
+}
+
+void OcclusionCuller::set_terrain_occluder(const HeightMap& height_map,
+                                           const glm::mat4& model_matrix, int block_size)
+{
+    occluder_vertices_.clear();
+    occluder_indices_.clear();
+
+    // Grid line positions, with the last one clamped to the edge of the height map
+    int last = height_map.size - 1;
+    std::vector<int> lines;
+    for (int i = 0; i < last; i += block_size)
+    {
+        lines.push_back(i);
+    }
+    lines.push_back(last);
+    int blocks = static_cast<int>(lines.size()) - 1;
+
+    // Lowest height within each block, including its edges
+    std::vector<float> block_min(blocks * blocks);
+    for (int bz = 0; bz < blocks; bz++)
+    {
+        for (int bx = 0; bx < blocks; bx++)
+        {
+            block_min[bz * blocks + bx] =
+                height_map
+                    .get_min_max(lines[bx], lines[bz], lines[bx + 1] - lines[bx],
+                                 lines[bz + 1] - lines[bz])
+                    .x;
+        }
+    }
+
+    // Each vertex takes the lowest height of the blocks around it, so every coarse triangle is
+    // under the real terrain and can never hide something that is actually visible
+    for (int z = 0; z <= blocks; z++)
+    {
+        for (int x = 0; x <= blocks; x++)
+        {
+            float lowest = std::numeric_limits<float>::max();
+            for (int bz = std::max(z - 1, 0); bz <= std::min(z, blocks - 1); bz++)
+            {
+                for (int bx = std::max(x - 1, 0); bx <= std::min(x, blocks - 1); bx++)
+                {
+                    lowest = std::min(lowest, block_min[bz * blocks + bx]);
+                }
+            }
+            glm::vec4 position{lines[x], lowest, lines[z], 1.0f};
+            occluder_vertices_.push_back(glm::vec3{model_matrix * position});
+        }
+    }
+
+    unsigned row = static_cast<unsigned>(blocks + 1);
+    for (unsigned z = 0; z < static_cast<unsigned>(blocks); z++)
+    {
+        for (unsigned x = 0; x < static_cast<unsigned>(blocks); x++)
+        {
+            unsigned i = z * row + x;
+            occluder_indices_.insert(occluder_indices_.end(),
+                                     {i, i + row, i + 1, i + 1, i + row, i + row + 1});
+        }
+    }
+}
+
+void OcclusionCuller::render(const glm::mat4& view_projection)
+{
+    view_projection_ = view_projection;
+    stats_ = {};
+
+    auto& base = levels_.front();
+    std::fill(base.depth.begin(), base.depth.end(), 1.0f);
+
+    std::vector<glm::vec4> clip_vertices;
+    clip_vertices.reserve(occluder_vertices_.size());
+    for (auto& vertex : occluder_vertices_)
+    {
+        clip_vertices.push_back(view_projection * glm::vec4{vertex, 1.0f});
+    }
+
+    for (std::size_t i = 0; i < occluder_indices_.size(); i += 3)
+    {
+        rasterize_triangle(clip_vertices[occluder_indices_[i]],
+                           clip_vertices[occluder_indices_[i + 1]],
+                           clip_vertices[occluder_indices_[i + 2]]);
+    }
+    build_pyramid();
+}
+
+bool OcclusionCuller::is_visible(const AABB& aabb)
+{
+    stats_.tested++;
+
+    glm::vec2 screen_min{std::numeric_limits<float>::max()};
+    glm::vec2 screen_max{std::numeric_limits<float>::lowest()};
+    float nearest = std::numeric_limits<float>::max();
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec4 corner{
+            i & 1 ? aabb.max.x : aabb.min.x,
+            i & 2 ? aabb.max.y : aabb.min.y,
+            i & 4 ? aabb.max.z : aabb.min.z,
+            1.0f,
+        };
+        auto clip = view_projection_ * corner;
+
+        // Boxes crossing the near plane cannot be projected reliably, and are close to the camera
+        // so are almost certainly visible anyway
+        if (is_behind_near(clip) || clip.w <= 0.0f)
+        {
+            return true;
+        }
+        glm::vec3 ndc{clip / clip.w};
+        screen_min = glm::min(screen_min, glm::vec2{ndc});
+        screen_max = glm::max(screen_max, glm::vec2{ndc});
+        nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+    }
+
+    // Outside of the screen, this is left to frustum culling
+    if (screen_max.x < -1.0f || screen_max.y < -1.0f || screen_min.x > 1.0f || screen_min.y > 1.0f)
+    {
+        return true;
+    }
+
+    auto& base = levels_.front();
+    auto to_pixel = [](float ndc, int size)
+    { return std::clamp(static_cast<int>((ndc * 0.5f + 0.5f) * size), 0, size - 1); };
+    int x0 = to_pixel(screen_min.x, base.width);
+    int x1 = to_pixel(screen_max.x, base.width);
+    int y0 = to_pixel(screen_min.y, base.height);
+    int y1 = to_pixel(screen_max.y, base.height);
+
+    // Pick the level where the box covers at most 2x2 texels
+    int extent = std::max(x1 - x0, y1 - y0) + 1;
+    int level_index = static_cast<int>(std::ceil(std::log2(static_cast<float>(extent))));
+    level_index = std::clamp(level_index, 0, static_cast<int>(levels_.size()) - 1);
+    auto& level = levels_[level_index];
+
+    float furthest = 0.0f;
+    for (int y = y0 >> level_index; y <= y1 >> level_index; y++)
+    {
+        for (int x = x0 >> level_index; x <= x1 >> level_index; x++)
+        {
+            furthest = std::max(furthest, level.depth[y * level.width + x]);
+        }
+    }
+
+    if (nearest > furthest)
+    {
+        stats_.occluded++;
+        return false;
+    }
+    return true;
+}
+
+const OcclusionCuller::Stats& OcclusionCuller::get_stats() const
+{
+    return stats_;
+}
+
+int OcclusionCuller::get_triangle_count() const
+{
+    return static_cast<int>(occluder_indices_.size() / 3);
+}
+
+void OcclusionCuller::rasterize_triangle(const glm::vec4& a, const glm::vec4& b,
+                                         const glm::vec4& c)
+{
+    // Trivially reject triangles entirely outside one of the clip planes
+    if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+        (a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w) ||
+        (a.z > a.w && b.z > b.w && c.z > c.w) ||
+        (is_behind_near(a) && is_behind_near(b) && is_behind_near(c)))
+    {
+        return;
+    }
+
+    // Clip against the near plane, which can turn the triangle into a quad
+    std::array<glm::vec4, 3> input = {a, b, c};
+    std::array<glm::vec4, 4> polygon;
+    int count = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        auto& current = input[i];
+        auto& next = input[(i + 1) % 3];
+        if (!is_behind_near(current))
+        {
+            polygon[count++] = current;
+        }
+        if (is_behind_near(current) != is_behind_near(next))
+        {
+            polygon[count++] = intersect_near(current, next);
+        }
+    }
+
+    auto& base = levels_.front();
+    std::array<glm::vec3, 4> screen;
+    for (int i = 0; i < count; i++)
+    {
+        auto& v = polygon[i];
+        screen[i] = {
+            (v.x / v.w * 0.5f + 0.5f) * base.width,
+            (v.y / v.w * 0.5f + 0.5f) * base.height,
+            v.z / v.w * 0.5f + 0.5f,
+        };
+    }
+
+    for (int i = 1; i + 1 < count; i++)
+    {
+        fill_triangle(screen[0], screen[i], screen[i + 1]);
+    }
+}
+
+void OcclusionCuller::fill_triangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    auto& base = levels_.front();
+
+    // Both windings are filled as the terrain can be seen from any side
+    float area = edge(a, b, c.x, c.y);
+    if (std::abs(area) < 1e-6f)
+    {
+        return;
+    }
+    const glm::vec3& v1 = area > 0.0f ? b : c;
+    const glm::vec3& v2 = area > 0.0f ? c : b;
+    area = std::abs(area);
+
+    int min_x = std::max(static_cast<int>(std::floor(std::min({a.x, b.x, c.x}))), 0);
+    int min_y = std::max(static_cast<int>(std::floor(std::min({a.y, b.y, c.y}))), 0);
+    int max_x = std::min(static_cast<int>(std::ceil(std::max({a.x, b.x, c.x}))), base.width - 1);
+    int max_y = std::min(static_cast<int>(std::ceil(std::max({a.y, b.y, c.y}))), base.height - 1);
+
+    // Depth is affine in screen space after the perspective divide, so can be interpolated with
+    // the barycentric weights directly
+    for (int y = min_y; y <= max_y; y++)
+    {
+        float py = static_cast<float>(y) + 0.5f;
+        for (int x = min_x; x <= max_x; x++)
+        {
+            float px = static_cast<float>(x) + 0.5f;
+            float w0 = edge(v1, v2, px, py);
+            float w1 = edge(v2, a, px, py);
+            float w2 = edge(a, v1, px, py);
+            if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+            {
+                continue;
+            }
+
+            float depth = (w0 * a.z + w1 * v1.z + w2 * v2.z) / area;
+            float& current = base.depth[y * base.width + x];
+            current = std::min(current, depth);
+        }
+    }
+}
+
+void OcclusionCuller::build_pyramid()
+{
+    // Each texel keeps the furthest depth of the 2x2 texels below it, so a box that is in front
+    // of a texel at any level is in front of everything that texel covers
+    for (std::size_t i = 1; i < levels_.size(); i++)
+    {
+        auto& src = levels_[i - 1];
+        auto& dst = levels_[i];
+        for (int y = 0; y < dst.height; y++)
+        {
+            int sy0 = std::min(y * 2, src.height - 1);
+            int sy1 = std::min(y * 2 + 1, src.height - 1);
+            for (int x = 0; x < dst.width; x++)
+            {
+                int sx0 = std::min(x * 2, src.width - 1);
+                int sx1 = std::min(x * 2 + 1, src.width - 1);
+                dst.depth[y * dst.width + x] = std::max({
+                    src.depth[sy0 * src.width + sx0],
+                    src.depth[sy0 * src.width + sx1],
+                    src.depth[sy1 * src.width + sx0],
+                    src.depth[sy1 * src.width + sx1],
+                });
+            }
+        }
+    }
+}
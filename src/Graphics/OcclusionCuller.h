@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+#include "../Utils/Maths.h"
+
+struct HeightMap;
+
+/**
+ * @brief Software occlusion culling against the terrain.
+ *
+ * A coarse version of the terrain is rasterized on the CPU into a small depth buffer each frame,
+ * which is then reduced into a hierarchical depth (Hi-Z) pyramid storing the furthest depth of
+ * each region. Bounding boxes are projected to the screen and compared to the pyramid level where
+ * the box covers at most 2x2 texels, so each test is a handful of reads regardless of box size.
+ *
+ * The coarse terrain is built from the lowest heights of each block so it always lies on or below
+ * the real terrain. It is not fully conservative though, as triangles are only rasterized where
+ * they cover the centre of a pixel. The edge of a hill can be up to half a pixel of the depth
+ * buffer out, so a box only just showing over a hill can be culled.
+ */
+class OcclusionCuller
+{
+  public:
+    struct Stats
+    {
+        int tested = 0;
+        int occluded = 0;
+    };
+
+    OcclusionCuller(int width, int height);
+
+    /// Builds the occluder mesh from the terrain, must be called again if the terrain changes
+    void set_terrain_occluder(const HeightMap& height_map, const glm::mat4& model_matrix,
+                              int block_size = 8);
+
+    /// Rasterizes the occluders and builds the depth pyramid for this frame
+    void render(const glm::mat4& view_projection);
+
+    /// Returns false if the box is fully hidden behind the occluders
+    bool is_visible(const AABB& aabb);
+
+    const Stats& get_stats() const;
+    int get_triangle_count() const;
+
+  private:
+    void rasterize_triangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+    void fill_triangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+    void build_pyramid();
+
+    struct Level
+    {
+        int width = 0;
+        int height = 0;
+
+        // Normalized device depth remapped to [0, 1], 1 being the far plane
+        std::vector<float> depth;
+    };
+    std::vector<Level> levels_;
+
+    std::vector<glm::vec3> occluder_vertices_;
+    std::vector<unsigned> occluder_indices_;
+
+    glm::mat4 view_projection_{1.0f};
+    Stats stats_;
+};
@@ -30,6 +30,12 @@ void Framebuffer::bind_colour_attachment(GLuint index, GLuint unit) const
     attachments_[index].bind(unit);
 }
 
+void Framebuffer::bind_depth_attachment(GLuint unit) const
+{
+    assert(depth_attachment_);
+    depth_attachment_->bind(unit);
+}
+
 Framebuffer& Framebuffer::attach_colour(TextureFormat format)
 {
     assert(attachments_.size() < GL_MAX_COLOR_ATTACHMENTS - 1);
@@ -59,6 +65,25 @@ Framebuffer& Framebuffer::attach_depth_buffer()
     return *this;
 }
 
+Framebuffer& Framebuffer::attach_depth_texture()
+{
+    assert(!depth_attachment_);
+    depth_attachment_.emplace();
+    depth_attachment_->create(width, height, 1, TextureFormat::Depth32F);
+    depth_attachment_->set_min_filter(TextureMinFilter::Nearest);
+    depth_attachment_->set_mag_filter(TextureMagFilter::Nearest);
+    glNamedFramebufferTexture(id, GL_DEPTH_ATTACHMENT, depth_attachment_->id, 0);
+    return *this;
+}
+
+Framebuffer& Framebuffer::attach_depth_layer(const Texture2DArray& texture, GLint layer)
+{
+    glNamedFramebufferTextureLayer(id, GL_DEPTH_ATTACHMENT, texture.id, 0, layer);
+    glNamedFramebufferDrawBuffer(id, GL_NONE);
+    glNamedFramebufferReadBuffer(id, GL_NONE);
+    return *this;
+}
+
 bool Framebuffer::is_complete() const
 {
     if (auto status = glCheckNamedFramebufferStatus(id, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
@@ -67,4 +92,9 @@ bool Framebuffer::is_complete() const
         return false;
     }
     return true;
+}
+
+glm::uvec2 Framebuffer::get_size() const
+{
+    return {width, height};
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "GLResource.h"
 #include "Texture.h"
 
+#include <optional>
 #include <unordered_map>
 
 struct Framebuffer : public GLResource<glCreateFramebuffers, glDeleteFramebuffers>
@@ -12,16 +13,27 @@ struct Framebuffer : public GLResource<glCreateFramebuffers, glDeleteFramebuffer
 
     void bind() const;
     void bind_colour_attachment(GLuint index, GLuint unit) const;
+    void bind_depth_attachment(GLuint unit) const;
 
     Framebuffer& attach_colour(TextureFormat format);
     Framebuffer& attach_renderbuffer();
     Framebuffer& attach_depth_buffer();
 
+    /// Depth attachment that can be sampled from afterwards, unlike the renderbuffers
+    Framebuffer& attach_depth_texture();
+
+    /// Renders depth only into a layer of the texture array, which must be the framebuffer's size
+    Framebuffer& attach_depth_layer(const Texture2DArray& texture, GLint layer);
+
     bool is_complete() const;
 
+    /// Size in pixels, which bind() sets the viewport to
+    glm::uvec2 get_size() const;
+
   private:
     std::vector<Texture2D> attachments_;
     std::vector<GLuint> renderbuffers_;
+    std::optional<Texture2D> depth_attachment_;
     GLuint width = 0;
     GLuint height = 0;
 };
@@ -0,0 +1,58 @@
+#include "GpuTimer.h"
+
+#include <cassert>
+
+GpuTimer::GpuTimer()
+{
+    glCreateQueries(GL_TIME_ELAPSED, QUERY_COUNT, queries_.data());
+}
+
+GpuTimer::~GpuTimer()
+{
+    glDeleteQueries(QUERY_COUNT, queries_.data());
+}
+
+void GpuTimer::begin()
+{
+    assert(!running_);
+    if (pending_ == QUERY_COUNT)
+    {
+        return;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, queries_[next_]);
+    running_ = true;
+}
+
+void GpuTimer::end()
+{
+    if (!running_)
+    {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    running_ = false;
+    next_ = (next_ + 1) % QUERY_COUNT;
+    pending_++;
+}
+
+std::optional<sf::Time> GpuTimer::poll()
+{
+    // Queries finish in the order they were issued, so stop at the first one still in flight
+    std::optional<sf::Time> time;
+    while (pending_ > 0)
+    {
+        GLuint query = queries_[(next_ - pending_ + QUERY_COUNT) % QUERY_COUNT];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            break;
+        }
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+        time = sf::seconds(static_cast<float>(nanoseconds) / 1e9f);
+        pending_--;
+    }
+    return time;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <optional>
+
+#include <SFML/System/Time.hpp>
+#include <glad/glad.h>
+
+/**
+ * @brief Times work on the GPU with GL_TIME_ELAPSED queries.
+ *
+ * The GPU runs a frame or two behind the CPU, so the results are read back frames later from a
+ * ring of queries rather than waited for. Only one timer can be running at once, as OpenGL does
+ * not allow time elapsed queries to be nested.
+ */
+class GpuTimer
+{
+  public:
+    GpuTimer();
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer& other) = delete;
+    GpuTimer& operator=(const GpuTimer& other) = delete;
+
+    /// Does nothing if every query is still waiting for its result, so that frame goes untimed
+    void begin();
+    void end();
+
+    /// The time of the newest query whose result has arrived since the last call
+    std::optional<sf::Time> poll();
+
+  private:
+    constexpr static int QUERY_COUNT = 4;
+
+    std::array<GLuint, QUERY_COUNT> queries_{};
+
+    // The next query to begin, and how many queries are waiting for their results
+    int next_ = 0;
+    int pending_ = 0;
+    bool running_ = false;
+};
@@ -1,13 +1,35 @@
 #include "Shader.h"
 
+#include <algorithm>
+#include <cctype>
 #include <cstring>
+#include <fstream>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <sstream>
 
+#include "../../Utils/MappedFile.h"
 #include "../../Utils/Util.h"
 
+// From GL_ARB_parallel_shader_compile, which lets the driver compile shaders on its own threads
+#ifndef GL_COMPLETION_STATUS_ARB
+#define GL_COMPLETION_STATUS_ARB 0x91B1
+#endif
+
 namespace
 {
+    constexpr int MAX_INCLUDE_DEPTH = 16;
+
+    const std::filesystem::path PROGRAM_BINARY_DIRECTORY = "cache/shaders";
+    constexpr std::uint32_t PROGRAM_BINARY_MAGIC = 0x42505353; // "SSPB"
+
+    struct ProgramBinaryHeader
+    {
+        std::uint32_t magic = PROGRAM_BINARY_MAGIC;
+        GLenum format = 0;
+        std::uint64_t source_hash = 0;
+    };
+
     bool verify_shader(GLuint shader, GLuint status_enum, std::string_view action)
     {
         // Verify
@@ -40,20 +62,118 @@ namespace
             }
 
             std::string buffer(length + 1, ' ');
-            glGetShaderInfoLog(shader, 1024, NULL, buffer.data());
+            if (status_enum == GL_LINK_STATUS)
+            {
+                glGetProgramInfoLog(shader, 1024, NULL, buffer.data());
+            }
+            else
+            {
+                glGetShaderInfoLog(shader, 1024, NULL, buffer.data());
+            }
             std::cerr << "Failed to " << action << " shader :\n" << buffer << std::endl;
             return false;
         }
         return true;
     }
 
-    GLuint compile_shader(const char* source, GLuint shader_type)
+    /**
+     * @brief Expands #include "file" directives relative to the including file, and adds the
+     * defines after the #version directive. Each file is only included once.
+     *
+     * #line directives keep the line numbers in compile errors correct, where the source string
+     * number is the index of the file in out_files.
+     */
+    bool preprocess_shader(const std::filesystem::path& path,
+                           const std::vector<std::string>& defines,
+                           std::vector<std::filesystem::path>& out_files, std::string& out_source,
+                           int depth = 0)
+    {
+        if (depth > MAX_INCLUDE_DEPTH)
+        {
+            std::cerr << "Shader includes are nested too deeply at " << path << '\n';
+            return false;
+        }
+
+        auto source = read_file_to_string(path);
+        if (source.empty())
+        {
+            return false;
+        }
+        auto file_index = std::to_string(out_files.size());
+        out_files.push_back(path.lexically_normal());
+
+        std::istringstream stream(source);
+        std::string line;
+        int line_number = 0;
+        while (std::getline(stream, line))
+        {
+            line_number++;
+            auto start = line.find_first_not_of(" \t");
+            auto directive = start == std::string::npos ? std::string_view{}
+                                                        : std::string_view{line}.substr(start);
+
+            if (directive.starts_with("#include"))
+            {
+                auto begin = line.find('"');
+                auto end = line.find('"', begin + 1);
+                if (begin == std::string::npos || end == std::string::npos)
+                {
+                    std::cerr << "Invalid #include at " << path << ":" << line_number << '\n';
+                    return false;
+                }
+
+                auto name = line.substr(begin + 1, end - begin - 1);
+                auto include_path = (path.parent_path() / name).lexically_normal();
+                if (std::find(out_files.begin(), out_files.end(), include_path) == out_files.end())
+                {
+                    out_source += "#line 1 " + std::to_string(out_files.size()) + "\n";
+                    if (!preprocess_shader(include_path, defines, out_files, out_source,
+                                           depth + 1))
+                    {
+                        return false;
+                    }
+                }
+                out_source += "#line " + std::to_string(line_number + 1) + " " + file_index + "\n";
+                continue;
+            }
+
+            out_source += line;
+            out_source += '\n';
+            if (depth == 0 && directive.starts_with("#version"))
+            {
+                for (auto& define : defines)
+                {
+                    out_source += "#define " + define + "\n";
+                }
+                out_source += "#line " + std::to_string(line_number + 1) + " 0\n";
+            }
+        }
+        return true;
+    }
+
+    /// Lists the files for the source string numbers in compile errors
+    void print_source_files(const std::vector<std::filesystem::path>& files)
+    {
+        for (std::size_t i = 0; i < files.size(); i++)
+        {
+            std::cerr << "  " << i << ": " << files[i] << '\n';
+        }
+    }
+
+    /// Creates the shader and starts compiling it, without waiting for the result
+    GLuint create_shader(const char* source, GLuint shader_type)
     {
-        //  Create and compile
         GLuint shader = glCreateShader(shader_type);
 
         glShaderSource(shader, 1, (const GLchar* const*)&source, nullptr);
         glCompileShader(shader);
+        return shader;
+    }
+
+    GLuint compile_shader(const char* source, GLuint shader_type)
+    {
+        //  Create and compile
+        GLuint shader = create_shader(source, shader_type);
 
         // Verify
         if (!verify_shader(shader, GL_COMPILE_STATUS, "compile"))
@@ -62,30 +182,331 @@ namespace
         }
         return shader;
     }
+
+    bool is_program_binary_supported()
+    {
+        static bool supported = []
+        {
+            GLint format_count = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+            return format_count > 0;
+        }();
+        return supported;
+    }
+
+    /// Program binaries only work with the driver that created them, so the driver is part of the
+    /// hash as well as the sources
+    std::uint64_t hash_program_sources(const std::string& vertex_source,
+                                       const std::string& fragment_source)
+    {
+        auto hash = hash_bytes(vertex_source.c_str(), vertex_source.size() + 1);
+        hash = hash_bytes(fragment_source.c_str(), fragment_source.size() + 1, hash);
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+        {
+            auto string = reinterpret_cast<const char*>(glGetString(name));
+            if (string)
+            {
+                hash = hash_bytes(string, std::strlen(string), hash);
+            }
+        }
+        return hash;
+    }
+
+    /// The name is the files and defines followed by the hash, so each variant of a shader has a
+    /// different prefix and only the hash changes when its sources are edited
+    std::filesystem::path get_program_binary_path(const std::filesystem::path& vertex_file_path,
+                                                  const std::filesystem::path& fragment_file_path,
+                                                  const std::vector<std::string>& defines,
+                                                  std::uint64_t source_hash)
+    {
+        auto name =
+            vertex_file_path.stem().string() + "_" + fragment_file_path.stem().string() + "_";
+        for (auto& define : defines)
+        {
+            for (char c : define)
+            {
+                name += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+            }
+            name += "_";
+        }
+        return PROGRAM_BINARY_DIRECTORY / (name + std::to_string(source_hash) + ".bin");
+    }
+
+    /// Removes the binaries of older versions of the same shader, which are never loaded again
+    void remove_stale_program_binaries(const std::filesystem::path& path)
+    {
+        auto stem = path.stem().string();
+        auto prefix = stem.substr(0, stem.find_last_not_of("0123456789") + 1);
+
+        std::error_code error;
+        for (auto& entry : std::filesystem::directory_iterator(path.parent_path(), error))
+        {
+            // Only names which are the prefix and a hash, other variants have more after the prefix
+            auto other_stem = entry.path().stem().string();
+            if (entry.path().extension() != ".bin" || entry.path() == path ||
+                !other_stem.starts_with(prefix) || other_stem.size() == prefix.size() ||
+                other_stem.find_first_not_of("0123456789", prefix.size()) != std::string::npos)
+            {
+                continue;
+            }
+            std::filesystem::remove(entry.path(), error);
+        }
+    }
+
+    /// Returns the linked program, or 0 if there is no usable binary for these sources
+    GLuint load_program_binary(const std::filesystem::path& path, std::uint64_t source_hash)
+    {
+        MappedFile file;
+        if (!file.open(path) || file.size() <= sizeof(ProgramBinaryHeader))
+        {
+            return 0;
+        }
+
+        ProgramBinaryHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (header.magic != PROGRAM_BINARY_MAGIC || header.source_hash != source_hash)
+        {
+            return 0;
+        }
+
+        auto binary = file.bytes().subspan(sizeof(header));
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+        // The driver rejects binaries it can no longer use, even if the version string is the same
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status == GL_FALSE)
+        {
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    /// The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    void save_program_binary(GLuint program, const std::filesystem::path& path,
+                             std::uint64_t source_hash)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+        {
+            return;
+        }
+
+        ProgramBinaryHeader header;
+        header.source_hash = source_hash;
+        std::vector<char> binary(length);
+        glGetProgramBinary(program, length, nullptr, &header.format, binary.data());
+
+        // Written to a temporary file first so a partly written binary is never loaded
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+        auto temporary_path = path;
+        temporary_path += ".tmp";
+        {
+            std::ofstream file(temporary_path, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(binary.data(), binary.size());
+            if (!file)
+            {
+                std::cerr << "Failed to write program binary " << path << '\n';
+                return;
+            }
+        }
+        std::filesystem::rename(temporary_path, path, error);
+        if (!error)
+        {
+            remove_stale_program_binaries(path);
+        }
+    }
+
+    bool is_parallel_compile_supported()
+    {
+        static bool supported = []
+        {
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+            for (GLint i = 0; i < count; i++)
+            {
+                auto name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+                if (std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0 ||
+                    std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }();
+        return supported;
+    }
+
+    void copy_uniform(GLuint from, GLint from_location, GLuint to, GLint to_location,
+                      GLenum type)
+    {
+        GLfloat floats[16];
+        GLint ints[4];
+        GLuint uints[4];
+        switch (type)
+        {
+            case GL_FLOAT:
+                glGetUniformfv(from, from_location, floats);
+                glProgramUniform1fv(to, to_location, 1, floats);
+                break;
+            case GL_FLOAT_VEC2:
+                glGetUniformfv(from, from_location, floats);
+                glProgramUniform2fv(to, to_location, 1, floats);
+                break;
+            case GL_FLOAT_VEC3:
+                glGetUniformfv(from, from_location, floats);
+                glProgramUniform3fv(to, to_location, 1, floats);
+                break;
+            case GL_FLOAT_VEC4:
+                glGetUniformfv(from, from_location, floats);
+                glProgramUniform4fv(to, to_location, 1, floats);
+                break;
+            case GL_FLOAT_MAT3:
+                glGetUniformfv(from, from_location, floats);
+                glProgramUniformMatrix3fv(to, to_location, 1, GL_FALSE, floats);
+                break;
+            case GL_FLOAT_MAT4:
+                glGetUniformfv(from, from_location, floats);
+                glProgramUniformMatrix4fv(to, to_location, 1, GL_FALSE, floats);
+                break;
+            case GL_INT_VEC2:
+                glGetUniformiv(from, from_location, ints);
+                glProgramUniform2iv(to, to_location, 1, ints);
+                break;
+            case GL_INT_VEC3:
+                glGetUniformiv(from, from_location, ints);
+                glProgramUniform3iv(to, to_location, 1, ints);
+                break;
+            case GL_INT_VEC4:
+                glGetUniformiv(from, from_location, ints);
+                glProgramUniform4iv(to, to_location, 1, ints);
+                break;
+            case GL_UNSIGNED_INT:
+                glGetUniformuiv(from, from_location, uints);
+                glProgramUniform1uiv(to, to_location, 1, uints);
+                break;
+
+            // Ints, bools, and samplers which hold their texture unit
+            default:
+                glGetUniformiv(from, from_location, ints);
+                glProgramUniform1iv(to, to_location, 1, ints);
+                break;
+        }
+    }
+
+    /// Copies the values of the default block uniforms that both programs have
+    void copy_uniforms(GLuint from, GLuint to)
+    {
+        GLint count = 0;
+        glGetProgramInterfaceiv(from, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const GLenum properties[] = {GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION, GL_BLOCK_INDEX};
+            GLint values[4] = {0};
+            glGetProgramResourceiv(from, GL_UNIFORM, i, 4, properties, 4, nullptr, values);
+            auto [type, array_size, location, block_index] = values;
+            if (location == -1 || block_index != -1)
+            {
+                continue;
+            }
+
+            char name[256];
+            glGetProgramResourceName(from, GL_UNIFORM, i, sizeof(name), nullptr, name);
+            GLint new_location = glGetUniformLocation(to, name);
+            if (new_location == -1)
+            {
+                continue;
+            }
+
+            // Elements of an array of basic types have consecutive locations
+            for (GLint element = 0; element < array_size; element++)
+            {
+                copy_uniform(from, location + element, to, new_location + element,
+                             static_cast<GLenum>(type));
+            }
+        }
+    }
+
+    /// Copies the binding points of the uniform or shader storage blocks that both programs have
+    void copy_block_bindings(GLuint from, GLuint to, GLenum block_interface)
+    {
+        GLint count = 0;
+        glGetProgramInterfaceiv(from, block_interface, GL_ACTIVE_RESOURCES, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const GLenum property = GL_BUFFER_BINDING;
+            GLint binding = 0;
+            glGetProgramResourceiv(from, block_interface, i, 1, &property, 1, nullptr, &binding);
+
+            char name[256];
+            glGetProgramResourceName(from, block_interface, i, sizeof(name), nullptr, name);
+            GLuint index = glGetProgramResourceIndex(to, block_interface, name);
+            if (index == GL_INVALID_INDEX)
+            {
+                continue;
+            }
+
+            if (block_interface == GL_UNIFORM_BLOCK)
+            {
+                glUniformBlockBinding(to, index, binding);
+            }
+            else
+            {
+                glShaderStorageBlockBinding(to, index, binding);
+            }
+        }
+    }
 } // namespace
 
 Shader::~Shader()
 {
     glDeleteProgram(program_);
+    glDeleteProgram(pending_program_);
+    glDeleteShader(pending_vertex_shader_);
+    glDeleteShader(pending_fragment_shader_);
 }
 
 bool Shader::load_from_file(const std::filesystem::path& vertex_file_path,
-                            const std::filesystem::path& fragment_file_path)
+                            const std::filesystem::path& fragment_file_path,
+                            const std::vector<std::string>& defines)
 {
+    vertex_file_path_ = vertex_file_path;
+    fragment_file_path_ = fragment_file_path;
+    defines_ = defines;
+
     // Load the files into strings and verify
-    auto vertex_file_source = read_file_to_string(vertex_file_path);
-    auto fragment_file_source = read_file_to_string(fragment_file_path);
-    if (vertex_file_source.length() == 0 || fragment_file_source.length() == 0)
+    std::string vertex_file_source;
+    std::string fragment_file_source;
+    if (!read_sources(vertex_file_source, fragment_file_source))
     {
         return false;
     }
 
+    // Use the program binary from a previous run if the sources and driver are the same
+    auto source_hash = hash_program_sources(vertex_file_source, fragment_file_source);
+    auto binary_path =
+        get_program_binary_path(vertex_file_path, fragment_file_path, defines_, source_hash);
+    if (is_program_binary_supported())
+    {
+        program_ = load_program_binary(binary_path, source_hash);
+        if (program_)
+        {
+            return true;
+        }
+    }
+
     // Compile the vertex shader
     std::cout << "Compiling " << vertex_file_path << ".\n";
     auto vertex_shader = compile_shader(vertex_file_source.c_str(), GL_VERTEX_SHADER);
     if (!vertex_shader)
     {
         std::cerr << "Failed to compile vertex shader file " << vertex_file_path << ".\n";
+        print_source_files(vertex_source_files_);
         return false;
     }
 
@@ -95,11 +516,13 @@ bool Shader::load_from_file(const std::filesystem::path& vertex_file_path,
     if (!fragment_shader)
     {
         std::cerr << "Failed to compile fragment shader file " << fragment_file_path << ".\n";
+        print_source_files(fragment_source_files_);
         return false;
     }
 
     // Link the shaders together and verify the link status
     program_ = glCreateProgram();
+    glProgramParameteri(program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glAttachShader(program_, vertex_shader);
     glAttachShader(program_, fragment_shader);
     glLinkProgram(program_);
@@ -123,6 +546,202 @@ bool Shader::load_from_file(const std::filesystem::path& vertex_file_path,
     // Delete the temporary shaders
     glDeleteShader(vertex_shader);
     glDeleteShader(fragment_shader);
+
+    if (is_program_binary_supported())
+    {
+        save_program_binary(program_, binary_path, source_hash);
+    }
+    return true;
+}
+
+bool Shader::load_compute_from_file(const std::filesystem::path& compute_file_path,
+                                    const std::vector<std::string>& defines)
+{
+    // The compute file takes the place of the vertex file, so it is listed by get_source_files()
+    vertex_file_path_ = compute_file_path;
+    defines_ = defines;
+
+    std::string source;
+    std::vector<std::filesystem::path> files;
+    if (!preprocess_shader(compute_file_path, defines_, files, source))
+    {
+        return false;
+    }
+    vertex_source_files_ = std::move(files);
+
+    auto source_hash = hash_program_sources(source, "");
+    auto binary_path =
+        get_program_binary_path(compute_file_path, "compute", defines_, source_hash);
+    if (is_program_binary_supported())
+    {
+        program_ = load_program_binary(binary_path, source_hash);
+        if (program_)
+        {
+            return true;
+        }
+    }
+
+    std::cout << "Compiling " << compute_file_path << ".\n";
+    auto compute_shader = compile_shader(source.c_str(), GL_COMPUTE_SHADER);
+    if (!compute_shader)
+    {
+        std::cerr << "Failed to compile compute shader file " << compute_file_path << ".\n";
+        print_source_files(vertex_source_files_);
+        return false;
+    }
+
+    program_ = glCreateProgram();
+    glProgramParameteri(program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program_, compute_shader);
+    glLinkProgram(program_);
+    glDeleteShader(compute_shader);
+    if (!verify_shader(program_, GL_LINK_STATUS, "link"))
+    {
+        std::cerr << "Failed to link " << compute_file_path << ".\n";
+        return false;
+    }
+
+    if (is_program_binary_supported())
+    {
+        save_program_binary(program_, binary_path, source_hash);
+    }
+    return true;
+}
+
+bool Shader::begin_reload()
+{
+    std::string vertex_file_source;
+    std::string fragment_file_source;
+    if (!read_sources(vertex_file_source, fragment_file_source))
+    {
+        return false;
+    }
+
+    // Replace a reload that is still in progress
+    glDeleteProgram(pending_program_);
+    glDeleteShader(pending_vertex_shader_);
+    glDeleteShader(pending_fragment_shader_);
+
+    // Nothing is checked here, as that would wait for the driver to finish compiling
+    pending_vertex_shader_ = create_shader(vertex_file_source.c_str(), GL_VERTEX_SHADER);
+    pending_fragment_shader_ = create_shader(fragment_file_source.c_str(), GL_FRAGMENT_SHADER);
+
+    pending_source_hash_ = hash_program_sources(vertex_file_source, fragment_file_source);
+    pending_program_ = glCreateProgram();
+    glProgramParameteri(pending_program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(pending_program_, pending_vertex_shader_);
+    glAttachShader(pending_program_, pending_fragment_shader_);
+    glLinkProgram(pending_program_);
+    return true;
+}
+
+Shader::ReloadStatus Shader::update_reload()
+{
+    if (!pending_program_)
+    {
+        return ReloadStatus::Idle;
+    }
+
+    if (is_parallel_compile_supported())
+    {
+        GLint complete = GL_FALSE;
+        glGetProgramiv(pending_program_, GL_COMPLETION_STATUS_ARB, &complete);
+        if (!complete)
+        {
+            return ReloadStatus::Compiling;
+        }
+    }
+
+    // A failed compile also fails the link, so check the shaders first for the better error
+    bool success = true;
+    if (!verify_shader(pending_vertex_shader_, GL_COMPILE_STATUS, "compile"))
+    {
+        print_source_files(vertex_source_files_);
+        success = false;
+    }
+    else if (!verify_shader(pending_fragment_shader_, GL_COMPILE_STATUS, "compile"))
+    {
+        print_source_files(fragment_source_files_);
+        success = false;
+    }
+    else
+    {
+        success = verify_shader(pending_program_, GL_LINK_STATUS, "link");
+    }
+
+    glDeleteShader(pending_vertex_shader_);
+    glDeleteShader(pending_fragment_shader_);
+    pending_vertex_shader_ = 0;
+    pending_fragment_shader_ = 0;
+
+    if (!success)
+    {
+        std::cerr << "Failed to reload " << vertex_file_path_ << " and " << fragment_file_path_
+                  << ", keeping the previous version.\n";
+        glDeleteProgram(pending_program_);
+        pending_program_ = 0;
+        return ReloadStatus::Failed;
+    }
+
+    // Uniforms such as the texture units are only set once, so must be carried over
+    copy_uniforms(program_, pending_program_);
+    copy_block_bindings(program_, pending_program_, GL_UNIFORM_BLOCK);
+    copy_block_bindings(program_, pending_program_, GL_SHADER_STORAGE_BLOCK);
+
+    glDeleteProgram(program_);
+    program_ = pending_program_;
+    pending_program_ = 0;
+    uniform_locations_.clear();
+
+    if (is_program_binary_supported())
+    {
+        save_program_binary(program_,
+                            get_program_binary_path(vertex_file_path_, fragment_file_path_,
+                                                    defines_, pending_source_hash_),
+                            pending_source_hash_);
+    }
+    return ReloadStatus::Reloaded;
+}
+
+std::vector<std::filesystem::path> Shader::get_source_files() const
+{
+    auto files = vertex_source_files_;
+    for (auto& file : fragment_source_files_)
+    {
+        if (std::find(files.begin(), files.end(), file) == files.end())
+        {
+            files.push_back(file);
+        }
+    }
+    return files;
+}
+
+const std::vector<std::string>& Shader::get_defines() const
+{
+    return defines_;
+}
+
+const std::filesystem::path& Shader::get_vertex_file_path() const
+{
+    return vertex_file_path_;
+}
+
+const std::filesystem::path& Shader::get_fragment_file_path() const
+{
+    return fragment_file_path_;
+}
+
+bool Shader::read_sources(std::string& out_vertex_source, std::string& out_fragment_source)
+{
+    std::vector<std::filesystem::path> vertex_files;
+    std::vector<std::filesystem::path> fragment_files;
+    if (!preprocess_shader(vertex_file_path_, defines_, vertex_files, out_vertex_source) ||
+        !preprocess_shader(fragment_file_path_, defines_, fragment_files, out_fragment_source))
+    {
+        return false;
+    }
+    vertex_source_files_ = std::move(vertex_files);
+    fragment_source_files_ = std::move(fragment_files);
     return true;
 }
 
@@ -131,6 +750,12 @@ void Shader::bind() const
     glUseProgram(program_);
 }
 
+void Shader::dispatch(GLuint groups_x, GLuint groups_y, GLuint groups_z) const
+{
+    glUseProgram(program_);
+    glDispatchCompute(groups_x, groups_y, groups_z);
+}
+
 void Shader::set_uniform(const std::string& name, int value)
 {
     glProgramUniform1i(program_, get_uniform_location(name), value);
@@ -141,6 +766,11 @@ void Shader::set_uniform(const std::string& name, float value)
     glProgramUniform1f(program_, get_uniform_location(name), value);
 }
 
+void Shader::set_uniform(const std::string& name, const glm::vec2& vect)
+{
+    glProgramUniform2fv(program_, get_uniform_location(name), 1, glm::value_ptr(vect));
+}
+
 void Shader::set_uniform(const std::string& name, const glm::vec3& vect)
 {
     glProgramUniform3fv(program_, get_uniform_location(name), 1, glm::value_ptr(vect));
@@ -162,6 +792,13 @@ void Shader::bind_uniform_block_index(const std::string& name, GLuint index)
     glUniformBlockBinding(program_, glGetUniformBlockIndex(program_, name.c_str()), index);
 }
 
+void Shader::bind_shader_storage_block_index(const std::string& name, GLuint index)
+{
+    glShaderStorageBlockBinding(
+        program_, glGetProgramResourceIndex(program_, GL_SHADER_STORAGE_BLOCK, name.c_str()),
+        index);
+}
+
 
 GLint Shader::get_uniform_location(const std::string& name)
 {
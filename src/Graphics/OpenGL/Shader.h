@@ -5,6 +5,7 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <filesystem>
 #include <iostream>
 #include <string_view>
@@ -14,6 +15,14 @@
 class Shader
 {
   public:
+    enum class ReloadStatus
+    {
+        Idle,
+        Compiling,
+        Reloaded,
+        Failed,
+    };
+
     Shader() = default;
     Shader(Shader&& other) noexcept = delete;
     Shader(const Shader& other) = delete;
@@ -21,25 +30,77 @@ class Shader
     Shader& operator=(const Shader& other) = delete;
     ~Shader();
 
+    /**
+     * @brief Loads the program binary cached under cache/shaders if the sources and driver have not
+     * changed since it was saved, otherwise compiles the sources and caches the binary
+     *
+     * The files can #include "file" relative to themselves. Each define is added after the
+     * #version directive as "#define <define>", eg "IS_LIGHT" or "MAX_LIGHTS 8", so features can
+     * be compiled out of a variant rather than branched on with a uniform.
+     */
     bool load_from_file(const std::filesystem::path& vertex_file_path,
-                        const std::filesystem::path& fragment_file_path);
+                        const std::filesystem::path& fragment_file_path,
+                        const std::vector<std::string>& defines = {});
+
+    /// Loads a compute shader in the same way, with the same includes, defines and program binary
+    /// cache. Compute shaders are not hot reloaded.
+    bool load_compute_from_file(const std::filesystem::path& compute_file_path,
+                                const std::vector<std::string>& defines = {});
+
+    /// Starts compiling the shader files again without waiting for the driver to finish, returns
+    /// false if the files could not be read
+    bool begin_reload();
+
+    /**
+     * @brief Swaps in the reloaded program once it has compiled and linked, copying across the
+     * uniform values and block bindings of the current program. If it fails to compile or link
+     * then the current program is kept.
+     */
+    ReloadStatus update_reload();
+
+    /// Every file the shader was built from, including the files they #include
+    std::vector<std::filesystem::path> get_source_files() const;
+    const std::vector<std::string>& get_defines() const;
+
+    const std::filesystem::path& get_vertex_file_path() const;
+    const std::filesystem::path& get_fragment_file_path() const;
 
     void bind() const;
 
+    /// Binds the compute shader and runs the given number of work groups
+    void dispatch(GLuint groups_x, GLuint groups_y, GLuint groups_z = 1) const;
+
     void set_uniform(const std::string& name, int value);
     void set_uniform(const std::string& name, float value);
+    void set_uniform(const std::string& name, const glm::vec2& vect);
     void set_uniform(const std::string& name, const glm::vec3& vect);
     void set_uniform(const std::string& name, const glm::vec4& vect);
     void set_uniform(const std::string& name, const glm::mat4& matrix);
 
     void bind_uniform_block_index(const std::string& name, GLuint index);
+    void bind_shader_storage_block_index(const std::string& name, GLuint index);
 
 
 
   private:
     GLint get_uniform_location(const std::string& name);
 
+    /// Preprocesses the vertex and fragment files, and updates the list of source files
+    bool read_sources(std::string& out_vertex_source, std::string& out_fragment_source);
+
   private:
     std::unordered_map<std::string, GLint> uniform_locations_;
     GLuint program_ = 0;
+
+    std::filesystem::path vertex_file_path_;
+    std::filesystem::path fragment_file_path_;
+    std::vector<std::string> defines_;
+    std::vector<std::filesystem::path> vertex_source_files_;
+    std::vector<std::filesystem::path> fragment_source_files_;
+
+    // Program being reloaded, along with its shaders which are needed for the compile logs
+    GLuint pending_program_ = 0;
+    GLuint pending_vertex_shader_ = 0;
+    GLuint pending_fragment_shader_ = 0;
+    std::uint64_t pending_source_hash_ = 0;
 };
\ No newline at end of file
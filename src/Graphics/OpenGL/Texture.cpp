@@ -1,9 +1,20 @@
 #include "Texture.h"
 
 #include <SFML/Graphics/Image.hpp>
+#include <algorithm>
 #include <array>
 #include <iostream>
 
+#include "../../Utils/TextureCompression.h"
+
+// Not part of core OpenGL, but supported by every desktop driver
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
 //=======================
 // == Helper functions ==
 //=======================
@@ -12,6 +23,37 @@ namespace
     const std::array<std::string, 6> CUBE_TEXTURE_NAMES = {"right.png",  "left.png",  "top.png",
                                                            "bottom.png", "back.png", "front.png"};
 
+    GLsizeiptr get_bytes_per_pixel(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TextureFormat::RGB8:
+                return 3;
+            case TextureFormat::RGBA8:
+                return 4;
+            case TextureFormat::RGBA16F:
+                return 8;
+            case TextureFormat::RGBA32F:
+                return 16;
+            case TextureFormat::R32F:
+            case TextureFormat::Depth32F:
+                return 4;
+        }
+        return 4;
+    }
+
+    GLsizeiptr get_storage_size(GLsizei width, GLsizei height, GLsizei levels,
+                                TextureFormat format)
+    {
+        GLsizeiptr size = 0;
+        for (GLsizei level = 0; level < levels; level++)
+        {
+            size += static_cast<GLsizeiptr>(std::max(width >> level, 1)) *
+                    std::max(height >> level, 1) * get_bytes_per_pixel(format);
+        }
+        return size;
+    }
+
     bool load_image_from_file(const std::filesystem::path& path, bool flip_vertically,
                               bool flip_horizontally, sf::Image& out_image)
     {
@@ -31,6 +73,22 @@ namespace
 
         return true;
     }
+
+    GLenum to_gl_format(BlockFormat format)
+    {
+        switch (format)
+        {
+            case BlockFormat::BC1:
+                return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            case BlockFormat::BC3:
+                return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case BlockFormat::BC5:
+                return GL_COMPRESSED_RG_RGTC2;
+            case BlockFormat::BC7:
+                return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        }
+        return 0;
+    }
 } // namespace
 
 //=======================================
@@ -71,6 +129,7 @@ Texture2D::Texture2D()
 GLuint Texture2D::create(GLsizei width, GLsizei height, GLsizei levels, TextureFormat format)
 {
     glTextureStorage2D(id, levels, static_cast<GLenum>(format), width, height);
+    memory_size_ = get_storage_size(width, height, levels, format);
 
     set_min_filter(TextureMinFilter::Linear);
     set_mag_filter(TextureMagFilter::Linear);
@@ -82,20 +141,38 @@ bool Texture2D::load_from_file(const std::filesystem::path& path, GLsizei levels
                                bool flip_vertically, bool flip_horizontally,
                                TextureInternalFormat internal_format, TextureFormat format)
 {
+    if (path.extension() == ".dds")
+    {
+        CompressedTexture texture;
+        if (!load_dds(path, texture))
+        {
+            std::cerr << "Failed to load DDS texture " << path << '\n';
+            return false;
+        }
+        load_compressed(texture);
+        return true;
+    }
+
     sf::Image image;
     if (!load_image_from_file(path, flip_vertically, flip_horizontally, image))
         return false;
 
-    const auto w = image.getSize().x;
-    const auto h = image.getSize().y;
-    const auto data = image.getPixelsPtr();
+    load_from_pixels(image.getSize().x, image.getSize().y, levels, image.getPixelsPtr(),
+                     internal_format, format);
+    return true;
+}
 
+void Texture2D::load_from_pixels(GLsizei width, GLsizei height, GLsizei levels,
+                                 const void* pixels, TextureInternalFormat internal_format,
+                                 TextureFormat format)
+{
     // Allocate the storage
-    glTextureStorage2D(id, levels, static_cast<GLenum>(format), w, h);
+    glTextureStorage2D(id, levels, static_cast<GLenum>(format), width, height);
+    memory_size_ = get_storage_size(width, height, levels, format);
 
     // Uplodad the pixels
-    glTextureSubImage2D(id, 0, 0, 0, w, h, static_cast<GLenum>(internal_format), GL_UNSIGNED_BYTE,
-                        data);
+    glTextureSubImage2D(id, 0, 0, 0, width, height, static_cast<GLenum>(internal_format),
+                        GL_UNSIGNED_BYTE, pixels);
     glGenerateTextureMipmap(id);
 
     // Set some default wrapping
@@ -104,7 +181,29 @@ bool Texture2D::load_from_file(const std::filesystem::path& path, GLsizei levels
     set_wrap_s(TextureWrap::Repeat);
     set_wrap_t(TextureWrap::Repeat);
     is_loaded_ = true;
-    return true;
+}
+
+void Texture2D::load_compressed(const CompressedTexture& texture)
+{
+    auto& base = texture.mips.front();
+    auto levels = static_cast<GLsizei>(texture.mips.size());
+    auto format = to_gl_format(texture.format);
+    glTextureStorage2D(id, levels, format, base.width, base.height);
+
+    memory_size_ = 0;
+    for (GLint level = 0; level < levels; level++)
+    {
+        auto& mip = texture.mips[level];
+        glCompressedTextureSubImage2D(id, level, 0, 0, mip.width, mip.height, format,
+                                      static_cast<GLsizei>(mip.data.size()), mip.data.data());
+        memory_size_ += static_cast<GLsizeiptr>(mip.data.size());
+    }
+
+    set_min_filter(levels > 1 ? TextureMinFilter::LinearMipmapLinear : TextureMinFilter::Linear);
+    set_mag_filter(TextureMagFilter::Linear);
+    set_wrap_s(TextureWrap::Repeat);
+    set_wrap_t(TextureWrap::Repeat);
+    is_loaded_ = true;
 }
 
 bool Texture2D::is_loaded() const
@@ -112,6 +211,94 @@ bool Texture2D::is_loaded() const
     return is_loaded_;
 }
 
+GLsizeiptr Texture2D::get_memory_size() const
+{
+    return memory_size_;
+}
+
+//====================================
+// == Texture2DArray Implementation ==
+//====================================
+Texture2DArray::Texture2DArray()
+    : GLTextureResource(GL_TEXTURE_2D_ARRAY)
+{
+}
+
+void Texture2DArray::create(GLsizei width, GLsizei height, GLsizei layers, GLsizei levels,
+                            TextureFormat format)
+{
+    width_ = width;
+    height_ = height;
+    levels_ = levels;
+    glTextureStorage3D(id, levels, static_cast<GLenum>(format), width, height, layers);
+
+    set_min_filter(levels > 1 ? TextureMinFilter::LinearMipmapLinear : TextureMinFilter::Linear);
+    set_mag_filter(TextureMagFilter::Linear);
+    set_wrap_s(TextureWrap::Repeat);
+    set_wrap_t(TextureWrap::Repeat);
+}
+
+void Texture2DArray::upload_layer(GLsizei layer, const void* pixels)
+{
+    glTextureSubImage3D(id, 0, 0, 0, layer, width_, height_, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                        pixels);
+    is_loaded_ = true;
+}
+
+void Texture2DArray::generate_mipmaps()
+{
+    if (levels_ > 1)
+    {
+        glGenerateTextureMipmap(id);
+    }
+}
+
+bool Texture2DArray::load_from_files(std::span<const std::filesystem::path> paths, GLsizei levels,
+                                     bool flip_vertically, bool flip_horizontally)
+{
+    std::vector<sf::Image> images(paths.size());
+    std::vector<const void*> layer_pixels;
+    for (std::size_t i = 0; i < paths.size(); i++)
+    {
+        if (!load_image_from_file(paths[i], flip_vertically, flip_horizontally, images[i]))
+        {
+            return false;
+        }
+
+        auto size = images.front().getSize();
+        if (images[i].getSize() != size)
+        {
+            images[i] = resize_image(images[i], size.x, size.y);
+        }
+        layer_pixels.push_back(images[i].getPixelsPtr());
+    }
+
+    load_from_pixels(images.front().getSize().x, images.front().getSize().y, levels,
+                     layer_pixels);
+    return true;
+}
+
+void Texture2DArray::load_from_pixels(GLsizei width, GLsizei height, GLsizei levels,
+                                      std::span<const void* const> layer_pixels)
+{
+    create(width, height, static_cast<GLsizei>(layer_pixels.size()), levels);
+    for (std::size_t i = 0; i < layer_pixels.size(); i++)
+    {
+        glTextureSubImage3D(id, 0, 0, 0, static_cast<GLint>(i), width, height, 1, GL_RGBA,
+                            GL_UNSIGNED_BYTE, layer_pixels[i]);
+    }
+    glGenerateTextureMipmap(id);
+    is_loaded_ = true;
+}
+
+bool Texture2DArray::is_loaded() const
+{
+    return is_loaded_;
+}
+
+//====================================
+// == CubeMapTexture Implementation ==
+//====================================
 CubeMapTexture::CubeMapTexture()
     : GLTextureResource(GL_TEXTURE_CUBE_MAP)
 {
@@ -127,36 +314,80 @@ bool CubeMapTexture::load_from_file(const std::filesystem::path& folder)
     // 5 FRONT
     // 6 BACK
 
-    bool created = false;
-
-
-
+    std::array<sf::Image, 6> images;
+    std::array<const void*, 6> face_pixels;
     for (int i = 0; i < 6; i++)
     {
-        sf::Image image;
-        if (!load_image_from_file(folder / CUBE_TEXTURE_NAMES[i], false, false, image))
+        if (!load_image_from_file(folder / CUBE_TEXTURE_NAMES[i], false, false, images[i]))
             return false;
+        face_pixels[i] = images[i].getPixelsPtr();
+    }
 
-        const auto w = image.getSize().x;
-        const auto h = image.getSize().y;
-        const auto data = image.getPixelsPtr();
-
-        if (!created)
-        {
-            glTextureStorage2D(id, 1, GL_RGBA8, w, h);
-            created = true;     
-        }
+    load_from_pixels(images[0].getSize().x, images[0].getSize().y, face_pixels);
+    return true;
+}
 
-        glTextureSubImage3D(id, 0, 0, 0, i, w, h, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+void CubeMapTexture::load_from_pixels(GLsizei width, GLsizei height,
+                                      const std::array<const void*, 6>& face_pixels)
+{
+    glTextureStorage2D(id, 1, GL_RGBA8, width, height);
+    for (int i = 0; i < 6; i++)
+    {
+        glTextureSubImage3D(id, 0, 0, 0, i, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                            face_pixels[i]);
     }
 
     set_min_filter(TextureMinFilter::Linear);
     set_mag_filter(TextureMagFilter::Linear);
     set_wrap_s(TextureWrap::ClampToEdge);
     set_wrap_t(TextureWrap::ClampToEdge);
+    is_loaded_ = true;
+}
+
+const std::array<std::string, 6>& CubeMapTexture::face_names()
+{
+    return CUBE_TEXTURE_NAMES;
 }
 
 bool CubeMapTexture::is_loaded() const
 {
-    return false;
+    return is_loaded_;
+}
+
+sf::Image resize_image(const sf::Image& image, unsigned width, unsigned height)
+{
+    auto source_size = image.getSize();
+    const std::uint8_t* source = image.getPixelsPtr();
+    std::vector<std::uint8_t> pixels(static_cast<std::size_t>(width) * height * 4);
+
+    // Pixel centres are lined up, so the corners of both images cover the same area
+    float scale_x = static_cast<float>(source_size.x) / width;
+    float scale_y = static_cast<float>(source_size.y) / height;
+    for (unsigned y = 0; y < height; y++)
+    {
+        float sy = std::clamp((y + 0.5f) * scale_y - 0.5f, 0.0f, source_size.y - 1.0f);
+        auto y0 = static_cast<unsigned>(sy);
+        auto y1 = std::min(y0 + 1, source_size.y - 1);
+        float fy = sy - y0;
+        for (unsigned x = 0; x < width; x++)
+        {
+            float sx = std::clamp((x + 0.5f) * scale_x - 0.5f, 0.0f, source_size.x - 1.0f);
+            auto x0 = static_cast<unsigned>(sx);
+            auto x1 = std::min(x0 + 1, source_size.x - 1);
+            float fx = sx - x0;
+            for (unsigned c = 0; c < 4; c++)
+            {
+                auto sample = [&](unsigned px, unsigned py)
+                { return static_cast<float>(source[(py * source_size.x + px) * 4 + c]); };
+                float top = sample(x0, y0) + (sample(x1, y0) - sample(x0, y0)) * fx;
+                float bottom = sample(x0, y1) + (sample(x1, y1) - sample(x0, y1)) * fx;
+                pixels[(y * width + x) * 4 + c] =
+                    static_cast<std::uint8_t>(top + (bottom - top) * fy + 0.5f);
+            }
+        }
+    }
+
+    sf::Image result;
+    result.create(width, height, pixels.data());
+    return result;
 }
@@ -1,13 +1,18 @@
 #pragma once
 
+#include <array>
 #include <filesystem>
+#include <span>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #include <SFML/Graphics/Image.hpp>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+struct CompressedTexture;
+
 enum class TextureInternalFormat
 {
     RGB = GL_RGB,
@@ -18,7 +23,10 @@ enum class TextureFormat
 {
     RGB8 = GL_RGB8,
     RGBA8 = GL_RGBA8,
-    RGBA16F = GL_RGBA16F
+    RGBA16F = GL_RGBA16F,
+    RGBA32F = GL_RGBA32F,
+    R32F = GL_R32F,
+    Depth32F = GL_DEPTH_COMPONENT32F,
 };
 
 enum class TextureMinFilter
@@ -57,7 +65,7 @@ struct GLTextureResource
     GLTextureResource           (const GLTextureResource& other) = delete;  
     GLTextureResource& operator=(const GLTextureResource& other) = delete;  
 
-    GLTextureResource& operator=(GLTextureResource&& other) noexcept { id = other.id;  other.id = 0; return *this; }   
+    GLTextureResource& operator=(GLTextureResource&& other) noexcept { std::swap(id, other.id); return *this; }   
     GLTextureResource (GLTextureResource&& other) noexcept : id  (other.id){ other.id = 0; }   
 
     void bind(GLuint unit) const { assert(id); glBindTextureUnit(unit, id); }
@@ -76,14 +84,66 @@ struct Texture2D : public GLTextureResource
     GLuint create(GLsizei width, GLsizei height, GLsizei levels = 1,
                   TextureFormat format = TextureFormat::RGB8);
 
+    /// DDS files are loaded with their own mips, ignoring levels and the flip and format options
     bool load_from_file(const std::filesystem::path& path, GLsizei levels, bool flip_vertically,
                         bool flip_horizontally,
                         TextureInternalFormat internal_format = TextureInternalFormat::RGBA,
                         TextureFormat format = TextureFormat::RGBA8);
 
+    /// Creates the storage, uploads the pixels and generates the mipmaps. If a pixel unpack buffer
+    /// is bound then pixels is an offset into it.
+    void load_from_pixels(GLsizei width, GLsizei height, GLsizei levels, const void* pixels,
+                          TextureInternalFormat internal_format = TextureInternalFormat::RGBA,
+                          TextureFormat format = TextureFormat::RGBA8);
+
+    /// Creates the storage and uploads every mip of the block compressed texture, so no mips are
+    /// generated at runtime
+    void load_compressed(const CompressedTexture& texture);
+
     bool is_loaded() const;
 
+    /// Estimated size of the texture's storage in bytes, including the mips
+    GLsizeiptr get_memory_size() const;
+
   private:
+    GLsizeiptr memory_size_ = 0;
+    bool is_loaded_ = false;
+};
+
+/**
+ * @brief Array of same sized 2D layers, sampled in shaders with a sampler2DArray where the third
+ * texture coordinate is the layer. Lets many textures be bound to a single texture unit.
+ */
+struct Texture2DArray : public GLTextureResource
+{
+    Texture2DArray();
+
+    /// Creates the storage for the layers without uploading anything
+    void create(GLsizei width, GLsizei height, GLsizei layers, GLsizei levels = 1,
+                TextureFormat format = TextureFormat::RGBA8);
+
+    /// Uploads the RGBA8 pixels of one layer, which must match the size given to create. The
+    /// mipmaps are not updated, so generate_mipmaps() must be called once the layers are uploaded.
+    void upload_layer(GLsizei layer, const void* pixels);
+
+    /// Generates the mipmaps of every layer from their first level, if there are any
+    void generate_mipmaps();
+
+    /// Loads each image into the next layer. Images are resized to match the first image.
+    bool load_from_files(std::span<const std::filesystem::path> paths, GLsizei levels,
+                         bool flip_vertically, bool flip_horizontally);
+
+    /// Creates the storage and uploads the RGBA8 pixels of every layer, generating the mipmaps. If
+    /// a pixel unpack buffer is bound then the pixels are offsets into it.
+    void load_from_pixels(GLsizei width, GLsizei height, GLsizei levels,
+                          std::span<const void* const> layer_pixels);
+
+    bool is_loaded() const;
+
+  private:
+    GLsizei width_ = 0;
+    GLsizei height_ = 0;
+    GLsizei levels_ = 0;
     bool is_loaded_ = false;
 };
 
@@ -93,8 +153,19 @@ struct CubeMapTexture : public GLTextureResource
 
     bool load_from_file(const std::filesystem::path& folder);
 
+    /// Creates the storage and uploads the RGBA pixels of each face, in the order right, left,
+    /// top, bottom, back, front
+    void load_from_pixels(GLsizei width, GLsizei height,
+                          const std::array<const void*, 6>& face_pixels);
+
+    /// File names of the faces in the order they are uploaded
+    static const std::array<std::string, 6>& face_names();
+
     bool is_loaded() const;
 
   private:
     bool is_loaded_ = false;
-};
\ No newline at end of file
+};
+
+/// Resizes the image with bilinear filtering, used to make texture array layers the same size
+sf::Image resize_image(const sf::Image& image, unsigned width, unsigned height);
\ No newline at end of file
@@ -43,3 +43,8 @@ void BufferObject::create_store(GLsizeiptr size)
 {
     glNamedBufferStorage(id, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
 }
+
+void BufferObject::create_store(std::span<const std::byte> data, GLbitfield flags)
+{
+    glNamedBufferStorage(id, static_cast<GLsizeiptr>(data.size()), data.data(), flags);
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
+#include <span>
 #include <vector>
 
 // #include "../Mesh.h"
@@ -48,6 +50,11 @@ struct BufferObject : public GLResource<glCreateBuffers, glDeleteBuffers>
     }
 
     void create_store(GLsizeiptr size);
+
+    /// Creates immutable storage initialised directly from the given memory, such as a region of
+    /// a MappedFile, without copying it into an intermediate buffer first
+    void create_store(std::span<const std::byte> data, GLbitfield flags = 0);
+
     void bind_buffer_base(BindBufferTarget target, GLuint index);
     void bind_buffer_range(BindBufferTarget target, GLuint index, GLsizeiptr bytes);
 };
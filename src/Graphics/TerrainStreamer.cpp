@@ -0,0 +1,262 @@
+#include "TerrainStreamer.h"
+
+#include <algorithm>
+
+#include <SFML/System/Clock.hpp>
+
+#include "Frustum.h"
+
+namespace
+{
+    // Points shared with the neighbouring pages on each side, used for the normals
+    constexpr int PAGE_BORDER = 1;
+
+    // Pages share their edge vertices with their neighbours
+    constexpr int PAGE_VERTICES = TerrainStreamer::PAGE_SIZE + 1;
+
+    std::uint64_t get_page_key(const glm::ivec2& coord)
+    {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(coord.x)) << 32 |
+               static_cast<std::uint32_t>(coord.y);
+    }
+
+    glm::ivec2 get_page_coord(float x, float z)
+    {
+        auto page_size = static_cast<float>(TerrainStreamer::PAGE_SIZE);
+        return glm::ivec2{glm::floor(glm::vec2{x, z} / page_size)};
+    }
+
+    int distance_squared(const glm::ivec2& a, const glm::ivec2& b)
+    {
+        auto offset = a - b;
+        return offset.x * offset.x + offset.y * offset.y;
+    }
+} // namespace
+
+TerrainStreamer::Page::Page(const glm::ivec2& coord, HeightMap&& height_map)
+    : coord(coord)
+    , height_map(std::move(height_map))
+{
+}
+
+glm::vec3 TerrainStreamer::Page::get_position() const
+{
+    return glm::vec3(coord.x, 0, coord.y) * static_cast<float>(PAGE_SIZE);
+}
+
+TerrainStreamer::TerrainStreamer(int view_distance, std::size_t memory_budget,
+                                 unsigned thread_count)
+    : view_distance_(view_distance)
+    , memory_budget_(memory_budget)
+    , pool_(thread_count)
+{
+    std::vector<GLuint> indices;
+    generate_terrain_indices(PAGE_VERTICES, indices);
+    page_indices_.create_store(std::as_bytes(std::span{indices}));
+    page_index_count_ = static_cast<GLuint>(indices.size());
+}
+
+void TerrainStreamer::reset(const TerrainGenerationOptions& options)
+{
+    options_ = options;
+    options_.generate_island = false;
+
+    // Jobs that are still being generated are discarded once they finish
+    generation_++;
+    pending_.clear();
+    pages_.clear();
+    stats_.resident = 0;
+    stats_.pending = 0;
+    stats_.memory = 0;
+}
+
+void TerrainStreamer::update(const glm::vec3& position, sf::Time budget)
+{
+    frame_++;
+    centre_ = get_page_coord(position.x, position.z);
+
+    // Pages in view distance are marked as used, and the missing ones are requested nearest first
+    std::vector<glm::ivec2> missing;
+    for (int z = -view_distance_; z <= view_distance_; z++)
+    {
+        for (int x = -view_distance_; x <= view_distance_; x++)
+        {
+            glm::ivec2 coord = centre_ + glm::ivec2{x, z};
+            if (distance_squared(coord, centre_) > view_distance_ * view_distance_)
+            {
+                continue;
+            }
+
+            auto key = get_page_key(coord);
+            if (auto page = pages_.find(key); page != pages_.end())
+            {
+                page->second->last_used = frame_;
+            }
+            else if (!pending_.contains(key))
+            {
+                missing.push_back(coord);
+            }
+        }
+    }
+    std::ranges::sort(missing, {}, [&](auto& coord) { return distance_squared(coord, centre_); });
+
+    // Only a few pages are queued at once so the order keeps up with the camera
+    auto max_pending = pool_.size() * 2;
+    for (auto& coord : missing)
+    {
+        if (pending_.size() >= max_pending)
+        {
+            break;
+        }
+        pending_.insert(get_page_key(coord));
+
+        auto job = std::make_unique<Job>();
+        job->coord = coord;
+        job->generation = generation_;
+        job->options = options_;
+        pool_.enqueue(
+            [this, job = std::move(job)]() mutable
+            {
+                generate(*job);
+
+                std::lock_guard lock(mutex_);
+                generated_.push_back(std::move(job));
+            });
+    }
+
+    sf::Clock clock;
+    while (clock.getElapsedTime() < budget)
+    {
+        std::unique_ptr<Job> job;
+        {
+            std::lock_guard lock(mutex_);
+            if (generated_.empty())
+            {
+                break;
+            }
+            job = std::move(generated_.front());
+            generated_.pop_front();
+        }
+
+        // Pages from before a reset are thrown away, as are pages the camera has moved away from
+        if (job->generation != generation_)
+        {
+            stats_.discarded++;
+            continue;
+        }
+        pending_.erase(get_page_key(job->coord));
+
+        auto max_distance = view_distance_ + 1;
+        if (distance_squared(job->coord, centre_) > max_distance * max_distance)
+        {
+            stats_.discarded++;
+            continue;
+        }
+        upload(*job);
+    }
+
+    evict_unused();
+    stats_.pending = static_cast<int>(pending_.size());
+    stats_.resident = static_cast<int>(pages_.size());
+}
+
+void TerrainStreamer::cull(const Frustum& frustum, std::vector<const Page*>& visible_pages) const
+{
+    visible_pages.clear();
+    for (auto& [key, page] : pages_)
+    {
+        if (frustum.is_visible(page->bounds))
+        {
+            visible_pages.push_back(page.get());
+        }
+    }
+}
+
+float TerrainStreamer::get_height(float x, float z) const
+{
+    auto coord = get_page_coord(x, z);
+    auto page = pages_.find(get_page_key(coord));
+    if (page == pages_.end())
+    {
+        return 0.0f;
+    }
+
+    // Position on the page's height map, which starts with the border
+    auto local = glm::vec2{x, z} - glm::vec2{coord * PAGE_SIZE} + glm::vec2{PAGE_BORDER};
+    return page->second->height_map.sample(local.x, local.y);
+}
+
+const TerrainStreamer::Stats& TerrainStreamer::get_stats() const
+{
+    return stats_;
+}
+
+void TerrainStreamer::generate(Job& job)
+{
+    HeightMap height_map{PAGE_VERTICES + PAGE_BORDER * 2};
+    height_map.generate_terrain(job.options, job.coord.x * PAGE_SIZE - PAGE_BORDER,
+                                job.coord.y * PAGE_SIZE - PAGE_BORDER);
+
+    generate_terrain_vertices(height_map, job.vertices, PAGE_BORDER);
+    for (auto& vertex : job.vertices)
+    {
+        job.bounds.expand(vertex.position);
+    }
+
+    // Snow is placed relative to the amplitude, as each page only knows about its own peaks
+    job.splat_map = generate_terrain_splat_map(height_map, PAGE_BORDER, job.options.amplitude);
+    job.height_map.emplace(std::move(height_map));
+}
+
+void TerrainStreamer::upload(Job& job)
+{
+    auto page = std::make_unique<Page>(job.coord, std::move(*job.height_map));
+    page->mesh.buffer(std::as_bytes(std::span{job.vertices}), page_indices_, page_index_count_,
+                      job.bounds);
+    page->bounds = {job.bounds.min + page->get_position(), job.bounds.max + page->get_position()};
+
+    page->splat_map.create(PAGE_VERTICES, PAGE_VERTICES, TERRAIN_SPLAT_MAP_LAYERS);
+    page->splat_map.set_wrap_s(TextureWrap::ClampToEdge);
+    page->splat_map.set_wrap_t(TextureWrap::ClampToEdge);
+    for (int i = 0; i < TERRAIN_SPLAT_MAP_LAYERS; i++)
+    {
+        page->splat_map.upload_layer(i, job.splat_map[i].data());
+    }
+    page->splat_map.generate_mipmaps();
+
+    // The shared indices are not counted, as evicting pages would never free them
+    page->memory_size = page->height_map.heights.size() * sizeof(float) +
+                        job.vertices.size() * sizeof(BasicVertex) +
+                        job.splat_map.size() * job.splat_map.front().size();
+    page->last_used = frame_;
+
+    stats_.generated++;
+    stats_.memory += page->memory_size;
+    pages_[get_page_key(job.coord)] = std::move(page);
+}
+
+void TerrainStreamer::evict_unused()
+{
+    while (stats_.memory > memory_budget_)
+    {
+        // Pages used this frame are never evicted, so the budget can be exceeded if it is too
+        // small for the view distance
+        auto oldest = pages_.end();
+        for (auto itr = pages_.begin(); itr != pages_.end(); itr++)
+        {
+            if (itr->second->last_used != frame_ &&
+                (oldest == pages_.end() || itr->second->last_used < oldest->second->last_used))
+            {
+                oldest = itr;
+            }
+        }
+        if (oldest == pages_.end())
+        {
+            return;
+        }
+
+        stats_.memory -= oldest->second->memory_size;
+        stats_.evicted++;
+        pages_.erase(oldest);
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <SFML/System/Time.hpp>
+
+#include "../Utils/HeightMap.h"
+#include "../Utils/Maths.h"
+#include "../Utils/ThreadPool.h"
+#include "Mesh.h"
+#include "OpenGL/Texture.h"
+
+struct Frustum;
+
+/**
+ * @brief Endless terrain made of square pages, which are generated around the camera by worker
+ * threads and evicted once the memory budget is used up, least recently used first.
+ *
+ * Each page has its own height map, mesh and splat map, and is placed at its page coordinate
+ * times PAGE_SIZE. The workers generate the heights, vertices and splat map, and update()
+ * uploads finished pages until its time budget is used up so moving into new terrain never
+ * stalls a frame. Missing pages closest to the camera are requested first.
+ *
+ * The height map of a page has a border of points from its neighbours, so the normals and
+ * heights are continuous across page edges.
+ */
+class TerrainStreamer
+{
+  public:
+    /// Number of quads along each side of a page
+    constexpr static int PAGE_SIZE = 128;
+
+    struct Page
+    {
+        Page(const glm::ivec2& coord, HeightMap&& height_map);
+
+        glm::ivec2 coord{0};
+        HeightMap height_map;
+        BasicMesh mesh;
+        Texture2DArray splat_map;
+
+        // World space bounds of the mesh
+        AABB bounds;
+        std::size_t memory_size = 0;
+        std::uint64_t last_used = 0;
+
+        glm::vec3 get_position() const;
+    };
+
+    struct Stats
+    {
+        int resident = 0;
+        int pending = 0;
+        int generated = 0;
+        int discarded = 0;
+        int evicted = 0;
+        std::size_t memory = 0;
+    };
+
+    /**
+     * @param view_distance Pages within this many pages of the camera are generated
+     * @param memory_budget Bytes used by pages before the least recently used are evicted
+     * @param thread_count Number of worker threads, 0 picks based on the hardware
+     */
+    explicit TerrainStreamer(int view_distance = 6,
+                             std::size_t memory_budget = 256 * 1024 * 1024,
+                             unsigned thread_count = 0);
+
+    TerrainStreamer(const TerrainStreamer& other) = delete;
+    TerrainStreamer& operator=(const TerrainStreamer& other) = delete;
+
+    /// Discards every page so they are generated again with the new options. Islands are never
+    /// generated as the terrain has no edges.
+    void reset(const TerrainGenerationOptions& options);
+
+    /// Requests the pages around the position, uploads finished pages until the budget is used
+    /// up, then evicts pages over the memory budget. Must be called on the GL thread.
+    void update(const glm::vec3& position, sf::Time budget);
+
+    /// Finds the resident pages that are inside the frustum. The pages are only valid until the
+    /// next update() or reset(), which can evict them.
+    void cull(const Frustum& frustum, std::vector<const Page*>& visible_pages) const;
+
+    /// Height at the world position, interpolated between the points around it. Returns 0 if the
+    /// page it is in is not resident.
+    float get_height(float x, float z) const;
+
+    const Stats& get_stats() const;
+
+  private:
+    struct Job
+    {
+        glm::ivec2 coord{0};
+        std::uint64_t generation = 0;
+        TerrainGenerationOptions options;
+
+        // Filled in by the worker thread
+        std::optional<HeightMap> height_map;
+        std::vector<BasicVertex> vertices;
+        std::vector<std::vector<std::uint8_t>> splat_map;
+        AABB bounds;
+    };
+
+    /// Generates the page's heights, vertices and splat map, runs on a worker thread
+    static void generate(Job& job);
+    void upload(Job& job);
+    void evict_unused();
+
+    std::unordered_map<std::uint64_t, std::unique_ptr<Page>> pages_;
+
+    // Pages that have been requested with the current options but not uploaded yet
+    std::unordered_set<std::uint64_t> pending_;
+
+    // Every page has the same grid of vertices, so they all share the same index buffer
+    BufferObject page_indices_;
+    GLuint page_index_count_ = 0;
+
+    TerrainGenerationOptions options_;
+    std::uint64_t generation_ = 0;
+    std::uint64_t frame_ = 0;
+    glm::ivec2 centre_{0};
+
+    int view_distance_ = 0;
+    std::size_t memory_budget_ = 0;
+    Stats stats_;
+
+    // Jobs are moved here by the worker threads once they are generated
+    std::mutex mutex_;
+    std::deque<std::unique_ptr<Job>> generated_;
+
+    ThreadPool pool_;
+};
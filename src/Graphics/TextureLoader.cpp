@@ -0,0 +1,364 @@
+#include "TextureLoader.h"
+
+#include <cstring>
+#include <iostream>
+
+#include <SFML/System/Clock.hpp>
+
+#include "../Utils/Util.h"
+
+namespace
+{
+    constexpr GLbitfield STAGING_FLAGS =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    /// Shown until the real texture has been uploaded
+    constexpr std::uint8_t PLACEHOLDER_PIXEL[4] = {128, 128, 128, 255};
+
+    const std::filesystem::path COOKED_TEXTURE_DIRECTORY = "cache/textures";
+
+    /// The cooked texture depends on the load options as well as the source
+    std::filesystem::path get_cooked_path(const std::filesystem::path& source, GLsizei levels,
+                                          bool flip_vertically, bool flip_horizontally)
+    {
+        auto key = source.lexically_normal().generic_string() + ":" + std::to_string(levels) +
+                   ":" + std::to_string(flip_vertically) + std::to_string(flip_horizontally);
+        auto hash = hash_bytes(key.data(), key.size());
+        return COOKED_TEXTURE_DIRECTORY /
+               (source.stem().string() + "_" + std::to_string(hash) + ".dds");
+    }
+
+    bool is_cooked_up_to_date(const std::filesystem::path& source,
+                              const std::filesystem::path& cooked)
+    {
+        std::error_code error;
+        auto cooked_time = std::filesystem::last_write_time(cooked, error);
+        if (error)
+        {
+            return false;
+        }
+        auto source_time = std::filesystem::last_write_time(source, error);
+        return error || source_time <= cooked_time;
+    }
+} // namespace
+
+TextureLoader::TextureLoader(unsigned thread_count, int slot_count, GLsizeiptr slot_size)
+    : slot_fences_(slot_count, nullptr)
+    , slot_size_(slot_size)
+    , pool_(thread_count)
+{
+    GLsizeiptr size = slot_size * slot_count;
+    glNamedBufferStorage(staging_buffer_.id, size, nullptr, STAGING_FLAGS);
+    staging_memory_ =
+        static_cast<std::byte*>(glMapNamedBufferRange(staging_buffer_.id, 0, size, STAGING_FLAGS));
+}
+
+TextureLoader::~TextureLoader()
+{
+    for (auto fence : slot_fences_)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+        }
+    }
+    glUnmapNamedBuffer(staging_buffer_.id);
+}
+
+void TextureLoader::load(Texture2D& texture, const std::filesystem::path& path, GLsizei levels,
+                         bool flip_vertically, bool flip_horizontally)
+{
+    // Storage is immutable, so start from a fresh texture in case it was already loaded
+    texture = Texture2D{};
+    texture.load_from_pixels(1, 1, 1, PLACEHOLDER_PIXEL);
+    reload(texture, path, levels, flip_vertically, flip_horizontally);
+}
+
+void TextureLoader::reload(Texture2D& texture, const std::filesystem::path& path,
+                           GLsizei levels, bool flip_vertically, bool flip_horizontally)
+{
+    auto job = std::make_unique<Job>();
+    job->texture = &texture;
+    job->paths.push_back(path);
+    job->levels = levels;
+    job->flip_vertically = flip_vertically;
+    job->flip_horizontally = flip_horizontally;
+    job->compress = compress_;
+    enqueue(std::move(job));
+}
+
+void TextureLoader::load(Texture2DArray& texture, std::span<const std::filesystem::path> paths,
+                         GLsizei levels, bool flip_vertically, bool flip_horizontally)
+{
+    texture = Texture2DArray{};
+    std::vector<const void*> layers(paths.size(), PLACEHOLDER_PIXEL);
+    texture.load_from_pixels(1, 1, 1, layers);
+
+    auto job = std::make_unique<Job>();
+    job->array = &texture;
+    job->paths.assign(paths.begin(), paths.end());
+    job->levels = levels;
+    job->flip_vertically = flip_vertically;
+    job->flip_horizontally = flip_horizontally;
+    enqueue(std::move(job));
+}
+
+void TextureLoader::load(CubeMapTexture& texture, const std::filesystem::path& folder)
+{
+    texture = CubeMapTexture{};
+    std::array<const void*, 6> faces;
+    faces.fill(PLACEHOLDER_PIXEL);
+    texture.load_from_pixels(1, 1, faces);
+
+    auto job = std::make_unique<Job>();
+    job->cube_map = &texture;
+    for (auto& name : CubeMapTexture::face_names())
+    {
+        job->paths.push_back(folder / name);
+    }
+    enqueue(std::move(job));
+}
+
+void TextureLoader::update(sf::Time budget)
+{
+    sf::Clock clock;
+    while (clock.getElapsedTime() < budget)
+    {
+        std::unique_ptr<Job> job;
+        {
+            std::lock_guard lock(mutex_);
+            if (decoded_.empty())
+            {
+                return;
+            }
+            job = std::move(decoded_.front());
+            decoded_.pop_front();
+        }
+
+        // The staging slots are still in use, so try again next frame
+        if (!upload(*job))
+        {
+            std::lock_guard lock(mutex_);
+            decoded_.push_front(std::move(job));
+            return;
+        }
+    }
+}
+
+void TextureLoader::set_compression(bool compress)
+{
+    compress_ = compress;
+}
+
+const TextureLoader::Stats& TextureLoader::get_stats() const
+{
+    return stats_;
+}
+
+void TextureLoader::enqueue(std::unique_ptr<Job> job)
+{
+    stats_.pending++;
+    pool_.enqueue(
+        [this, job = std::move(job)]() mutable
+        {
+            decode(*job);
+
+            std::lock_guard lock(mutex_);
+            decoded_.push_back(std::move(job));
+        });
+}
+
+void TextureLoader::decode(Job& job)
+{
+    auto& source = job.paths.front();
+    if (job.texture && source.extension() == ".dds")
+    {
+        job.failed = !load_dds(source, job.compressed);
+        job.is_compressed = !job.failed;
+        if (job.failed)
+        {
+            std::cerr << "Failed to load DDS texture " << source << '\n';
+        }
+        return;
+    }
+
+    // Compressing is slow, so the result is cached until the source changes
+    bool cook = job.texture && job.compress;
+    std::filesystem::path cooked_path;
+    if (cook)
+    {
+        cooked_path =
+            get_cooked_path(source, job.levels, job.flip_vertically, job.flip_horizontally);
+        if (is_cooked_up_to_date(source, cooked_path) && load_dds(cooked_path, job.compressed))
+        {
+            job.is_compressed = true;
+            return;
+        }
+    }
+
+    for (auto& path : job.paths)
+    {
+        auto& image = job.images.emplace_back();
+        if (!image.loadFromFile(path.string()))
+        {
+            std::cerr << "Failed to load texture " << path << '\n';
+            job.failed = true;
+            return;
+        }
+
+        // Array layers are resized to match, but cube map faces must already be the same size
+        auto size = job.images.front().getSize();
+        if (image.getSize() != size)
+        {
+            if (!job.array)
+            {
+                std::cerr << "Cube map face " << path << " is the wrong size\n";
+                job.failed = true;
+                return;
+            }
+            image = resize_image(image, size.x, size.y);
+        }
+
+        if (job.flip_vertically)
+        {
+            image.flipVertically();
+        }
+        if (job.flip_horizontally)
+        {
+            image.flipHorizontally();
+        }
+    }
+
+    if (cook)
+    {
+        auto& image = job.images.front();
+        auto width = static_cast<int>(image.getSize().x);
+        auto height = static_cast<int>(image.getSize().y);
+        auto pixels = image.getPixelsPtr();
+        job.compressed = compress_texture(pixels, width, height,
+                                          choose_block_format(pixels, width, height), job.levels);
+        job.is_compressed = true;
+        job.images.clear();
+
+        // Written to a temporary file first as the same texture can be cooked by two jobs at once
+        std::error_code error;
+        std::filesystem::create_directories(cooked_path.parent_path(), error);
+        auto temporary_path = cooked_path;
+        temporary_path += "." + std::to_string(reinterpret_cast<std::uintptr_t>(&job));
+        if (save_dds(temporary_path, job.compressed))
+        {
+            std::filesystem::rename(temporary_path, cooked_path, error);
+        }
+        if (error || !std::filesystem::exists(cooked_path))
+        {
+            std::cerr << "Failed to write cooked texture " << cooked_path << '\n';
+            std::filesystem::remove(temporary_path, error);
+        }
+    }
+}
+
+bool TextureLoader::upload(Job& job)
+{
+    if (job.failed)
+    {
+        stats_.pending--;
+        stats_.failed++;
+        return true;
+    }
+
+    // Compressed textures are a fraction of the size, so are uploaded without staging
+    if (job.is_compressed)
+    {
+        Texture2D texture;
+        texture.load_compressed(job.compressed);
+        *job.texture = std::move(texture);
+
+        stats_.pending--;
+        stats_.loaded++;
+        return true;
+    }
+
+    auto width = static_cast<GLsizei>(job.images.front().getSize().x);
+    auto height = static_cast<GLsizei>(job.images.front().getSize().y);
+    auto image_size = static_cast<GLsizeiptr>(width) * height * 4;
+    auto slots = static_cast<int>(job.images.size());
+
+    // Images too big for the slots are uploaded straight from the decoded image instead
+    bool staged = image_size <= slot_size_ && slots <= static_cast<int>(slot_fences_.size());
+    if (staged && !reserve_slots(slots))
+    {
+        return false;
+    }
+
+    std::vector<int> used_slots;
+    std::vector<const void*> pixels(slots);
+    for (int i = 0; i < slots; i++)
+    {
+        pixels[i] = job.images[i].getPixelsPtr();
+        if (staged)
+        {
+            GLsizeiptr offset = next_slot_ * slot_size_;
+            std::memcpy(staging_memory_ + offset, pixels[i], image_size);
+            pixels[i] = reinterpret_cast<const void*>(offset);
+
+            used_slots.push_back(next_slot_);
+            next_slot_ = (next_slot_ + 1) % static_cast<int>(slot_fences_.size());
+        }
+    }
+
+    if (staged)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging_buffer_.id);
+    }
+    if (job.texture)
+    {
+        Texture2D texture;
+        texture.load_from_pixels(width, height, job.levels, pixels[0]);
+        *job.texture = std::move(texture);
+    }
+    else if (job.array)
+    {
+        Texture2DArray texture;
+        texture.load_from_pixels(width, height, job.levels, pixels);
+        *job.array = std::move(texture);
+    }
+    else
+    {
+        CubeMapTexture texture;
+        std::array<const void*, 6> faces;
+        std::copy(pixels.begin(), pixels.end(), faces.begin());
+        texture.load_from_pixels(width, height, faces);
+        *job.cube_map = std::move(texture);
+    }
+    if (staged)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        for (int slot : used_slots)
+        {
+            slot_fences_[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    }
+
+    stats_.pending--;
+    stats_.loaded++;
+    return true;
+}
+
+bool TextureLoader::reserve_slots(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        auto& fence = slot_fences_[(next_slot_ + i) % slot_fences_.size()];
+        if (fence)
+        {
+            auto result = glClientWaitSync(fence, 0, 0);
+            if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            {
+                return false;
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    return true;
+}
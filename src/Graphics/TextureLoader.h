@@ -0,0 +1,116 @@
+#pragma once
+
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/System/Time.hpp>
+
+#include "../Utils/TextureCompression.h"
+#include "../Utils/ThreadPool.h"
+#include "OpenGL/Texture.h"
+#include "OpenGL/VertexArray.h"
+
+/**
+ * @brief Loads textures in the background so the first frame is not held up by image decoding.
+ *
+ * Requested textures are given a 1x1 placeholder straight away, and their images are decoded on a
+ * pool of worker threads. Each frame, update() uploads decoded images until the time budget is
+ * used up. The pixels are staged in a ring of persistently mapped pixel buffer slots, each guarded
+ * by a fence, so the driver can copy them to the texture without stalling the main thread.
+ *
+ * When compression is enabled, 2D textures are block compressed with their mips generated
+ * offline, and cached as DDS files under cache/textures so this only happens once. DDS files are
+ * always loaded as they are.
+ *
+ * Textures must outlive the loader, or at least stay in the same place in memory until they have
+ * finished loading. Textures are swapped for the loaded version, so their id changes once.
+ */
+class TextureLoader
+{
+  public:
+    struct Stats
+    {
+        int pending = 0;
+        int loaded = 0;
+        int failed = 0;
+    };
+
+    /**
+     * @param thread_count Number of decode threads, 0 picks based on the hardware
+     * @param slot_count Number of pixel buffer slots in the staging ring
+     * @param slot_size Size of each slot in bytes, larger images are uploaded without staging
+     */
+    TextureLoader(unsigned thread_count = 0, int slot_count = 8,
+                  GLsizeiptr slot_size = 1024 * 1024 * 4);
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader& other) = delete;
+    TextureLoader& operator=(const TextureLoader& other) = delete;
+
+    void load(Texture2D& texture, const std::filesystem::path& path, GLsizei levels,
+              bool flip_vertically, bool flip_horizontally);
+
+    /// Loads the texture again without a placeholder, so the current texture is shown until the
+    /// new one is uploaded, and is kept if the new one fails to load
+    void reload(Texture2D& texture, const std::filesystem::path& path, GLsizei levels,
+                bool flip_vertically, bool flip_horizontally);
+    void load(Texture2DArray& texture, std::span<const std::filesystem::path> paths,
+              GLsizei levels, bool flip_vertically, bool flip_horizontally);
+    void load(CubeMapTexture& texture, const std::filesystem::path& folder);
+
+    /// Uploads decoded textures until the budget is used up, must be called on the GL thread
+    void update(sf::Time budget);
+
+    /// Whether textures loaded after this are block compressed, which is the default
+    void set_compression(bool compress);
+
+    const Stats& get_stats() const;
+
+  private:
+    struct Job
+    {
+        Texture2D* texture = nullptr;
+        Texture2DArray* array = nullptr;
+        CubeMapTexture* cube_map = nullptr;
+        std::vector<std::filesystem::path> paths;
+
+        GLsizei levels = 1;
+        bool flip_vertically = false;
+        bool flip_horizontally = false;
+        bool compress = false;
+
+        // Filled in by the worker thread
+        std::vector<sf::Image> images;
+        CompressedTexture compressed;
+        bool is_compressed = false;
+        bool failed = false;
+    };
+
+    void enqueue(std::unique_ptr<Job> job);
+
+    /// Decodes the images or loads the compressed texture, runs on a worker thread
+    void decode(Job& job);
+    bool upload(Job& job);
+
+    /// Returns true if the next count slots are no longer being read by the GPU
+    bool reserve_slots(int count);
+
+    BufferObject staging_buffer_;
+    std::byte* staging_memory_ = nullptr;
+    std::vector<GLsync> slot_fences_;
+    GLsizeiptr slot_size_ = 0;
+    int next_slot_ = 0;
+
+    // Jobs are moved here by the worker threads once they are decoded
+    std::mutex mutex_;
+    std::deque<std::unique_ptr<Job>> decoded_;
+
+    Stats stats_;
+    bool compress_ = true;
+
+    ThreadPool pool_;
+};
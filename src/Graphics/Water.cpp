@@ -0,0 +1,239 @@
+#include "Water.h"
+
+#include <algorithm>
+
+#include <imgui.h>
+
+#include "../Utils/Profiler.h"
+
+namespace
+{
+    // The grid goes past the edges of the screen so the waves never pull its edge into view
+    constexpr float GRID_EXTENT = 1.2f;
+    constexpr int GRID_RESOLUTION = 192;
+
+    // The resolution scale moves by a step at a time, once there are enough frames of timings
+    // at the current resolution
+    constexpr float RESOLUTION_STEP = 0.125f;
+    constexpr int FRAMES_PER_STEP = 30;
+
+    // Each step up is about 1.5x the pixels, so it is only taken when well under the budget
+    constexpr float STEP_UP_FRACTION = 0.5f;
+
+    // Geometry is kept a little past the water so there are no gaps where the waves dip
+    constexpr float CLIP_PLANE_OFFSET = 0.5f;
+
+    void generate_projected_grid_mesh(BasicMesh& mesh)
+    {
+        for (int y = 0; y <= GRID_RESOLUTION; y++)
+        {
+            for (int x = 0; x <= GRID_RESOLUTION; x++)
+            {
+                glm::vec2 point = glm::vec2{x, y} / static_cast<float>(GRID_RESOLUTION);
+                BasicVertex vertex;
+                vertex.position = {(point * 2.0f - 1.0f) * GRID_EXTENT, 0.0f};
+                vertex.texture_coord = point;
+                mesh.vertices.push_back(vertex);
+            }
+        }
+
+        GLuint row = GRID_RESOLUTION + 1;
+        for (GLuint y = 0; y < GRID_RESOLUTION; y++)
+        {
+            for (GLuint x = 0; x < GRID_RESOLUTION; x++)
+            {
+                GLuint i = y * row + x;
+                mesh.indices.insert(mesh.indices.end(),
+                                    {i, i + 1, i + row, i + row, i + 1, i + row + 1});
+            }
+        }
+        mesh.buffer();
+    }
+} // namespace
+
+Water::Water(GLuint screen_width, GLuint screen_height)
+    : screen_width_(screen_width)
+    , screen_height_(screen_height)
+{
+    generate_projected_grid_mesh(grid_mesh_);
+
+    reflection_.resolution_scale = options.max_resolution_scale;
+    refraction_.resolution_scale = options.max_resolution_scale;
+    resize(Pass::Reflection);
+    resize(Pass::Refraction);
+}
+
+glm::mat4 Water::get_reflection_view(const glm::mat4& view) const
+{
+    // Mirrors the world in the water before viewing it
+    glm::mat4 mirror{1.0f};
+    mirror[1][1] = -1.0f;
+    mirror[3][1] = 2.0f * height;
+    return view * mirror;
+}
+
+glm::vec4 Water::get_clip_plane(Pass pass) const
+{
+    return pass == Pass::Reflection ? glm::vec4{0.0f, 1.0f, 0.0f, CLIP_PLANE_OFFSET - height}
+                                    : glm::vec4{0.0f, -1.0f, 0.0f, CLIP_PLANE_OFFSET + height};
+}
+
+void Water::begin_pass(Pass pass)
+{
+    auto& target = get_target(pass);
+    target.timer.begin();
+    target.framebuffer->bind();
+
+    glEnable(GL_CLIP_DISTANCE0);
+    if (pass == Pass::Reflection)
+    {
+        glFrontFace(GL_CW);
+    }
+}
+
+void Water::end_pass(Pass pass)
+{
+    glFrontFace(GL_CCW);
+    glDisable(GL_CLIP_DISTANCE0);
+    get_target(pass).timer.end();
+}
+
+void Water::render(Shader& shader, const glm::mat4& view, const glm::mat4& projection,
+                   const glm::vec3& eye_position, float time)
+{
+    surface_timer_.begin();
+    reflection_.framebuffer->bind_colour_attachment(0, 0);
+    refraction_.framebuffer->bind_colour_attachment(0, 1);
+    refraction_.framebuffer->bind_depth_attachment(2);
+
+    shader.bind();
+    shader.set_uniform("inverse_view_projection", glm::inverse(projection * view));
+    shader.set_uniform("eye_position", eye_position);
+    shader.set_uniform("water_height", height);
+    shader.set_uniform("time", time);
+    shader.set_uniform("screen_size", glm::vec2(screen_width_, screen_height_));
+    shader.set_uniform("wave_height", options.wave_height);
+    shader.set_uniform("distortion", options.distortion);
+    shader.set_uniform("shore_depth", options.shore_depth);
+    shader.set_uniform("deep_depth", options.deep_depth);
+    shader.set_uniform("deep_colour", options.deep_colour);
+
+    // The grid is seen from above and below the water, and blends into the scene at the shore
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    grid_mesh_.bind();
+    grid_mesh_.draw();
+    glDisable(GL_BLEND);
+    glEnable(GL_CULL_FACE);
+    surface_timer_.end();
+}
+
+void Water::update(Profiler& profiler)
+{
+    if (auto time = surface_timer_.poll())
+    {
+        surface_time_ = *time;
+        profiler.add_time("WaterSurface (GPU)", *time);
+    }
+
+    for (auto pass : {Pass::Reflection, Pass::Refraction})
+    {
+        auto& target = get_target(pass);
+        if (auto time = target.timer.poll())
+        {
+            target.last_time = *time;
+            target.total_time += *time;
+            target.timed_frames++;
+            profiler.add_time(pass == Pass::Reflection ? "WaterReflection (GPU)"
+                                                       : "WaterRefraction (GPU)",
+                              *time);
+        }
+
+        if (!options.adapt_resolution || target.timed_frames < FRAMES_PER_STEP)
+        {
+            continue;
+        }
+
+        auto average_ms = target.total_time.asSeconds() * 1000.0f / target.timed_frames;
+        auto scale = target.resolution_scale;
+        if (average_ms > options.pass_budget_ms)
+        {
+            scale -= RESOLUTION_STEP;
+        }
+        else if (average_ms < options.pass_budget_ms * STEP_UP_FRACTION)
+        {
+            scale += RESOLUTION_STEP;
+        }
+        scale = std::clamp(scale, options.min_resolution_scale, options.max_resolution_scale);
+
+        target.total_time = sf::Time::Zero;
+        target.timed_frames = 0;
+        if (scale != target.resolution_scale)
+        {
+            target.resolution_scale = scale;
+            resize(pass);
+        }
+    }
+}
+
+void Water::gui()
+{
+    if (ImGui::Begin("Water"))
+    {
+        ImGui::Text("Height: %.1f", height);
+        for (auto pass : {Pass::Reflection, Pass::Refraction})
+        {
+            auto& target = get_target(pass);
+            ImGui::Text("%s: %dx%d, %.2fms",
+                        pass == Pass::Reflection ? "Reflection" : "Refraction",
+                        static_cast<int>(screen_width_ * target.resolution_scale),
+                        static_cast<int>(screen_height_ * target.resolution_scale),
+                        target.last_time.asSeconds() * 1000.0f);
+        }
+        ImGui::Text("Surface: %.2fms", surface_time_.asSeconds() * 1000.0f);
+
+        // clang-format off
+        ImGui::Separator();
+        ImGui::SliderFloat("Wave Height",  &options.wave_height,    0.0f, 4.0f);
+        ImGui::SliderFloat("Distortion",   &options.distortion,     0.0f, 0.1f);
+        ImGui::SliderFloat("Shore Depth",  &options.shore_depth,    0.1f, 16.0f);
+        ImGui::SliderFloat("Deep Depth",   &options.deep_depth,     1.0f, 200.0f);
+        ImGui::ColorEdit3 ("Deep Colour",  &options.deep_colour[0]);
+
+        ImGui::Separator();
+        ImGui::Checkbox   ("Adapt Resolution",      &options.adapt_resolution);
+        ImGui::SliderFloat("Pass Budget (ms)",      &options.pass_budget_ms,       0.1f,  8.0f);
+        ImGui::SliderFloat("Min Resolution Scale",  &options.min_resolution_scale, 0.125f, 1.0f);
+        ImGui::SliderFloat("Max Resolution Scale",  &options.max_resolution_scale, 0.125f, 1.0f);
+        // clang-format on
+        options.max_resolution_scale =
+            std::max(options.max_resolution_scale, options.min_resolution_scale);
+    }
+    ImGui::End();
+}
+
+Water::PassTarget& Water::get_target(Pass pass)
+{
+    return pass == Pass::Reflection ? reflection_ : refraction_;
+}
+
+void Water::resize(Pass pass)
+{
+    auto& target = get_target(pass);
+    auto pass_width = static_cast<GLuint>(screen_width_ * target.resolution_scale);
+    auto pass_height = static_cast<GLuint>(screen_height_ * target.resolution_scale);
+
+    // The refraction's depth is sampled to find how deep the water is
+    target.framebuffer.emplace(std::max(pass_width, 1u), std::max(pass_height, 1u));
+    target.framebuffer->attach_colour(TextureFormat::RGB8);
+    if (pass == Pass::Reflection)
+    {
+        target.framebuffer->attach_renderbuffer();
+    }
+    else
+    {
+        target.framebuffer->attach_depth_texture();
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <optional>
+
+#include <SFML/System/Time.hpp>
+
+#include "../Utils/Maths.h"
+#include "Mesh.h"
+#include "OpenGL/Framebuffer.h"
+#include "OpenGL/GpuTimer.h"
+#include "OpenGL/Shader.h"
+
+class Profiler;
+
+/**
+ * @brief Water at a single height, drawn as a projected grid that reflects and refracts the scene.
+ *
+ * Before the main pass the scene is rendered twice more: mirrored in the water for the
+ * reflection, and clipped to what is under the water for the refraction, whose depth also gives
+ * how deep the water is so it can be blended into the shore. Both passes are rendered at a
+ * fraction of the screen's resolution. Each is timed on the GPU, and its resolution is lowered
+ * while it is over its budget and raised again once it has time to spare.
+ *
+ * The passes use the WATER_PASS variants of the scene shaders, which clip the geometry on the
+ * other side of the water using the "water_clip_plane" uniform.
+ */
+class Water
+{
+  public:
+    enum class Pass
+    {
+        Reflection,
+        Refraction,
+    };
+
+    struct Options
+    {
+        float wave_height = 0.4f;
+        float distortion = 0.02f;
+        float shore_depth = 2.0f;
+        float deep_depth = 40.0f;
+        glm::vec3 deep_colour{0.02f, 0.12f, 0.2f};
+
+        // Budget for each pass on the GPU, and the range their resolution scale is kept within
+        float pass_budget_ms = 1.0f;
+        float min_resolution_scale = 0.25f;
+        float max_resolution_scale = 0.5f;
+        bool adapt_resolution = true;
+    };
+
+    Water(GLuint screen_width, GLuint screen_height);
+
+    /// The camera's view mirrored in the water, which flips the winding of the triangles
+    glm::mat4 get_reflection_view(const glm::mat4& view) const;
+
+    /// Plane that keeps the geometry on the side of the water that the pass sees
+    glm::vec4 get_clip_plane(Pass pass) const;
+
+    /// Binds the pass's framebuffer, and sets up clipping and the winding for it
+    void begin_pass(Pass pass);
+    void end_pass(Pass pass);
+
+    /// Draws the surface into the bound framebuffer, which must have the scene's depth in it
+    void render(Shader& shader, const glm::mat4& view, const glm::mat4& projection,
+                const glm::vec3& eye_position, float time);
+
+    /// Adds the GPU times of the passes to the profiler, and moves their resolution towards what
+    /// fits in the budget
+    void update(Profiler& profiler);
+
+    void gui();
+
+    float height = 0.0f;
+    Options options;
+
+  private:
+    struct PassTarget
+    {
+        std::optional<Framebuffer> framebuffer;
+        GpuTimer timer;
+        float resolution_scale = 0.5f;
+
+        // GPU times since the resolution last changed
+        sf::Time total_time;
+        int timed_frames = 0;
+        sf::Time last_time;
+    };
+
+    PassTarget& get_target(Pass pass);
+
+    /// Creates the pass's framebuffer at its resolution scale
+    void resize(Pass pass);
+
+    BasicMesh grid_mesh_;
+
+    PassTarget reflection_;
+    PassTarget refraction_;
+    GpuTimer surface_timer_;
+    sf::Time surface_time_;
+
+    GLuint screen_width_ = 0;
+    GLuint screen_height_ = 0;
+};
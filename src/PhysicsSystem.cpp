@@ -27,4 +27,12 @@ void PhysicsObject::setup(std::unique_ptr<btCollisionShape> collision_shape, flo
     rb_info.m_friction = 0.9f;
     body = std::make_unique<btRigidBody>(rb_info);
     body->setUserPointer(this);
+}
+
+AABB PhysicsObject::get_aabb() const
+{
+    btVector3 min;
+    btVector3 max;
+    body->getAabb(min, max);
+    return {{min.x(), min.y(), min.z()}, {max.x(), max.y(), max.z()}};
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 
 #include <bullet/btBulletDynamicsCommon.h>
 
+#include "Utils/Maths.h"
+
 struct PhysicsObject
 {
     int id = -1;
@@ -12,6 +14,9 @@ struct PhysicsObject
     std::unique_ptr<btDefaultMotionState> motion_state;
     std::unique_ptr<btRigidBody> body;
     void setup(std::unique_ptr<btCollisionShape> collision_shape, float mass, btVector3 position);
+
+    /// World space bounding box of the body
+    AABB get_aabb() const;
 };
 
 class PhysicsSystem
@@ -33,9 +33,47 @@ struct Settings
         SpotLight spot_light;
     } lights;
 
+    // Cascaded shadow maps for the directional light, see CascadedShadowMap.h
+    struct Shadows
+    {
+        bool enabled = true;
+        int cascade_count = 3;
+        int resolution = 2048;
+
+        // Shadows are drawn out to this distance from the camera. The splits between the cascades
+        // mix logarithmic (1) and even (0) spacing
+        float distance = 500.0f;
+        float split_lambda = 0.8f;
+
+        // Casters up to this far towards the light from a cascade still cast shadows into it
+        float caster_distance = 400.0f;
+
+        // Slope scaled depth bias of the shadow pass, and how far surfaces are moved along their
+        // normal before they are looked up in the shadow map, in texels
+        float depth_bias = 2.0f;
+        float normal_offset = 1.5f;
+
+        // Tints each cascade a different colour
+        bool show_cascades = false;
+    } shadows;
+
     float material_shine = 32.0f;
 
     bool grass = true;
+    bool occlusion_culling = true;
+    bool deferred_rendering = false;
+
+    // Draw endless terrain generated around the camera instead of the island
+    bool stream_terrain = false;
+
+    // Generate the island's heights with a compute shader, which the terrain vertex shader reads
+    bool gpu_terrain = false;
+
+    // Reload shaders, textures and models when their files change
+    bool hot_reload = true;
+
+    // The first point light follows the floating light, the rest are scattered over the terrain
+    int point_light_count = 5;
 
     float throw_force = 40.0f;
     float throw_mass = 1.0f;
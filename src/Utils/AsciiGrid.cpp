@@ -0,0 +1,265 @@
+#include "AsciiGrid.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <iostream>
+#include <thread>
+
+#include "MappedFile.h"
+
+namespace
+{
+    // Below this many bytes of values the threads cost more than they save
+    constexpr std::size_t MIN_BYTES_PER_THREAD = 1024 * 1024;
+
+    bool is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    bool is_number_start(char c)
+    {
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.';
+    }
+
+    bool equals_ignore_case(std::string_view a, std::string_view b)
+    {
+        return std::ranges::equal(a, b,
+                                  [](char l, char r)
+                                  { return std::tolower(l) == std::tolower(r); });
+    }
+
+    std::size_t skip_space(std::string_view text, std::size_t pos)
+    {
+        while (pos < text.size() && is_space(text[pos]))
+        {
+            pos++;
+        }
+        return pos;
+    }
+
+    std::string_view next_token(std::string_view text, std::size_t& pos)
+    {
+        pos = skip_space(text, pos);
+        auto begin = pos;
+        while (pos < text.size() && !is_space(text[pos]))
+        {
+            pos++;
+        }
+        return text.substr(begin, pos - begin);
+    }
+
+    template <typename T>
+    bool parse_number(std::string_view token, T& out)
+    {
+        // from_chars does not accept a leading '+'
+        if (!token.empty() && token.front() == '+')
+        {
+            token.remove_prefix(1);
+        }
+        auto end = token.data() + token.size();
+        auto [ptr, ec] = std::from_chars(token.data(), end, out);
+        return ec == std::errc{} && ptr == end;
+    }
+
+    std::size_t count_values(std::string_view block)
+    {
+        std::size_t count = 0;
+        bool in_token = false;
+        for (char c : block)
+        {
+            bool space = is_space(c);
+            count += !space && !in_token;
+            in_token = !space;
+        }
+        return count;
+    }
+
+    /// Parses every value in the block into out, returning false if any of them are malformed
+    bool parse_values(std::string_view block, float* out)
+    {
+        const char* ptr = block.data();
+        const char* end = ptr + block.size();
+        while (true)
+        {
+            while (ptr < end && is_space(*ptr))
+            {
+                ptr++;
+            }
+            if (ptr == end)
+            {
+                return true;
+            }
+            if (*ptr == '+')
+            {
+                ptr++;
+            }
+
+            auto result = std::from_chars(ptr, end, *out++);
+            if (result.ec != std::errc{} || (result.ptr < end && !is_space(*result.ptr)))
+            {
+                return false;
+            }
+            ptr = result.ptr;
+        }
+    }
+} // namespace
+
+bool parse_ascii_grid(std::string_view text, AsciiGrid& out_grid, unsigned thread_count)
+{
+    out_grid = {};
+
+    // The header is a list of "key value" pairs, which ends at the first number in the file
+    bool x_is_center = false;
+    bool y_is_center = false;
+    std::size_t pos = 0;
+    while ((pos = skip_space(text, pos)) < text.size() && !is_number_start(text[pos]))
+    {
+        auto key = next_token(text, pos);
+        auto value = next_token(text, pos);
+
+        bool valid = true;
+        if (equals_ignore_case(key, "ncols"))
+        {
+            valid = parse_number(value, out_grid.columns);
+        }
+        else if (equals_ignore_case(key, "nrows"))
+        {
+            valid = parse_number(value, out_grid.rows);
+        }
+        else if (equals_ignore_case(key, "xllcorner") || equals_ignore_case(key, "xllcenter"))
+        {
+            valid = parse_number(value, out_grid.x_corner);
+            x_is_center = equals_ignore_case(key, "xllcenter");
+        }
+        else if (equals_ignore_case(key, "yllcorner") || equals_ignore_case(key, "yllcenter"))
+        {
+            valid = parse_number(value, out_grid.y_corner);
+            y_is_center = equals_ignore_case(key, "yllcenter");
+        }
+        else if (equals_ignore_case(key, "cellsize"))
+        {
+            valid = parse_number(value, out_grid.cell_size);
+        }
+        else if (equals_ignore_case(key, "nodata_value"))
+        {
+            valid = parse_number(value, out_grid.no_data_value);
+        }
+        else
+        {
+            std::cerr << "Unknown ASCII grid header '" << key << "'\n";
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Invalid value '" << value << "' for ASCII grid header '" << key
+                      << "'\n";
+            return false;
+        }
+    }
+
+    if (out_grid.columns <= 0 || out_grid.rows <= 0)
+    {
+        std::cerr << "ASCII grid is missing the ncols or nrows header\n";
+        return false;
+    }
+
+    if (x_is_center)
+    {
+        out_grid.x_corner -= out_grid.cell_size / 2.0;
+    }
+    if (y_is_center)
+    {
+        out_grid.y_corner -= out_grid.cell_size / 2.0;
+    }
+
+    // Split the values into one block per thread, with the splits moved forward to the next
+    // whitespace so no number is cut in half
+    auto values = text.substr(pos);
+    if (thread_count == 0)
+    {
+        thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    thread_count = static_cast<unsigned>(std::clamp<std::size_t>(
+        values.size() / MIN_BYTES_PER_THREAD, 1, thread_count));
+
+    std::vector<std::string_view> blocks;
+    std::size_t block_begin = 0;
+    for (unsigned i = 1; i <= thread_count; i++)
+    {
+        auto block_end = values.size() * i / thread_count;
+        while (block_end < values.size() && !is_space(values[block_end]))
+        {
+            block_end++;
+        }
+        block_end = std::max(block_end, block_begin);
+        blocks.push_back(values.substr(block_begin, block_end - block_begin));
+        block_begin = block_end;
+    }
+
+    auto for_each_block = [&](auto&& function)
+    {
+        std::vector<std::jthread> threads;
+        for (std::size_t i = 1; i < blocks.size(); i++)
+        {
+            threads.emplace_back(function, i);
+        }
+        function(0);
+    };
+
+    // First count the values in each block to know where each one writes to, then parse them
+    // straight into the grid
+    std::vector<std::size_t> offsets(blocks.size() + 1, 0);
+    for_each_block([&](std::size_t i) { offsets[i + 1] = count_values(blocks[i]); });
+    for (std::size_t i = 1; i < offsets.size(); i++)
+    {
+        offsets[i] += offsets[i - 1];
+    }
+
+    auto expected = static_cast<std::size_t>(out_grid.columns) * out_grid.rows;
+    if (offsets.back() != expected)
+    {
+        std::cerr << "ASCII grid should have " << expected << " values but has "
+                  << offsets.back() << '\n';
+        return false;
+    }
+
+    out_grid.values.resize(expected);
+    std::atomic_bool valid = true;
+    for_each_block(
+        [&](std::size_t i)
+        {
+            if (!parse_values(blocks[i], out_grid.values.data() + offsets[i]))
+            {
+                valid = false;
+            }
+        });
+
+    if (!valid)
+    {
+        std::cerr << "ASCII grid contains values that are not numbers\n";
+        out_grid.values.clear();
+        return false;
+    }
+    return true;
+}
+
+bool load_ascii_grid(const std::filesystem::path& path, AsciiGrid& out_grid,
+                     unsigned thread_count)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        return false;
+    }
+
+    std::string_view text(reinterpret_cast<const char*>(file.data()), file.size());
+    if (!parse_ascii_grid(text, out_grid, thread_count))
+    {
+        std::cerr << "Failed to parse ASCII grid " << path << '\n';
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+/// An ESRI ASCII grid, the plain text raster format most GIS software exports elevation data as
+struct AsciiGrid
+{
+    int columns = 0;
+    int rows = 0;
+
+    // Position of the lower left corner of the grid and the size of each cell, in map units
+    double x_corner = 0.0;
+    double y_corner = 0.0;
+    double cell_size = 1.0;
+
+    // Cells without any data have this value
+    float no_data_value = -9999.0f;
+
+    // Row major, starting from the top (north) row
+    std::vector<float> values;
+};
+
+/**
+ * @brief Parses the text of an ESRI ASCII grid.
+ *
+ * The ncols, nrows, xllcorner/xllcenter, yllcorner/yllcenter, cellsize and NODATA_value headers
+ * can be in any order and case. The values are split into blocks that are parsed in parallel
+ * with std::from_chars, so nothing is allocated other than the values themselves.
+ *
+ * @param thread_count Number of threads to parse with, 0 picks based on the hardware
+ */
+bool parse_ascii_grid(std::string_view text, AsciiGrid& out_grid, unsigned thread_count = 0);
+
+/// Memory maps the file and parses it in place
+bool load_ascii_grid(const std::filesystem::path& path, AsciiGrid& out_grid,
+                     unsigned thread_count = 0);
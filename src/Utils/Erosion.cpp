@@ -0,0 +1,409 @@
+#include "Erosion.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+#include <SFML/System/Clock.hpp>
+#include <imgui.h>
+
+#include "HeightMap.h"
+#include "Random.h"
+#include "Simd.h"
+
+namespace
+{
+    // A droplet density of 1 is split into this many steps
+    constexpr int DROPLET_STEPS_PER_DENSITY = 64;
+
+    // Below this many rows the threads cost more than they save
+    constexpr int MIN_ROWS_PER_THREAD = 64;
+
+    struct QuadSample
+    {
+        float height;
+        float slope_x;
+        float slope_z;
+    };
+
+    /// Bilinear height and slope within the quad whose first point is at quad[0]
+    QuadSample sample_quad(const float* quad, int size, float u, float v)
+    {
+        float h00 = quad[0];
+        float h10 = quad[1];
+        float h01 = quad[size];
+        float h11 = quad[size + 1];
+        return {
+            .height = h00 * (1 - u) * (1 - v) + h10 * u * (1 - v) + h01 * (1 - u) * v +
+                      h11 * u * v,
+            .slope_x = (h10 - h00) * (1 - v) + (h11 - h01) * v,
+            .slope_z = (h01 - h00) * (1 - u) + (h11 - h10) * u,
+        };
+    }
+
+    /// Spreads the amount over the four points of the quad, weighted by how close they are
+    void add_to_quad(float* quad, int size, float u, float v, float amount)
+    {
+        quad[0] += amount * (1 - u) * (1 - v);
+        quad[1] += amount * u * (1 - v);
+        quad[size] += amount * (1 - u) * v;
+        quad[size + 1] += amount * u * v;
+    }
+
+    /// Runs one droplet from the position until it evaporates, stops or leaves the map. It moves
+    /// one unit per step, so it never touches points more than max_lifetime + 1 away.
+    void run_droplet(float* heights, int size, float x, float z, const ErosionOptions& options)
+    {
+        float direction_x = 0.0f;
+        float direction_z = 0.0f;
+        float speed = 1.0f;
+        float water = 1.0f;
+        float sediment = 0.0f;
+        for (int lifetime = 0; lifetime < options.max_lifetime; lifetime++)
+        {
+            // Positions are never negative, so truncating is the same as flooring
+            int quad_x = static_cast<int>(x);
+            int quad_z = static_cast<int>(z);
+            float u = x - static_cast<float>(quad_x);
+            float v = z - static_cast<float>(quad_z);
+            float* quad = heights + static_cast<std::size_t>(quad_z) * size + quad_x;
+            auto point = sample_quad(quad, size, u, v);
+
+            // Turns downhill, keeping some of the direction it was already going in
+            direction_x = direction_x * options.inertia - point.slope_x * (1 - options.inertia);
+            direction_z = direction_z * options.inertia - point.slope_z * (1 - options.inertia);
+            float length = std::sqrt(direction_x * direction_x + direction_z * direction_z);
+            if (length < 1e-6f)
+            {
+                break;
+            }
+            x += direction_x / length;
+            z += direction_z / length;
+            if (x < 0 || z < 0 || x >= size - 1 || z >= size - 1)
+            {
+                break;
+            }
+
+            auto new_quad = heights + static_cast<std::size_t>(z) * size + static_cast<int>(x);
+            float height_difference =
+                sample_quad(new_quad, size, x - std::floor(x), z - std::floor(z)).height -
+                point.height;
+
+            // Faster droplets with more water down steeper slopes can carry more sediment
+            float capacity =
+                std::max(-height_difference * speed * water * options.sediment_capacity,
+                         options.min_sediment_capacity);
+            if (sediment > capacity || height_difference > 0)
+            {
+                // Going uphill fills in the pit behind it, otherwise some of the extra is dropped
+                float amount = height_difference > 0
+                                   ? std::min(height_difference, sediment)
+                                   : (sediment - capacity) * options.deposit_speed;
+                sediment -= amount;
+                add_to_quad(quad, size, u, v, amount);
+            }
+            else
+            {
+                // Never takes more than the height difference, so it never digs a hole
+                float amount =
+                    std::min((capacity - sediment) * options.erode_speed, -height_difference);
+                sediment += amount;
+                add_to_quad(quad, size, u, v, -amount);
+            }
+
+            speed = std::sqrt(std::max(speed * speed - height_difference * options.gravity, 0.0f));
+            water *= 1 - options.evaporate_speed;
+        }
+    }
+
+    /// Material moved from a neighbour which is the height difference higher, or to it if
+    /// negative, which is however much steeper than the talus slope it is
+    float talus_flow(float difference, float talus)
+    {
+        return difference - std::clamp(difference, -talus, talus);
+    }
+
+    /// Weathers one row of points from the heights before this step. Points with all four
+    /// neighbours read them straight from the rows above and below, four at a time when SSE2 is
+    /// available.
+    void weather_row(const float* in, float* out, int size, int z, float talus, float rate)
+    {
+        const float* row = in + static_cast<std::size_t>(z) * size;
+        const float* down = z > 0 ? row - size : nullptr;
+        const float* up = z < size - 1 ? row + size : nullptr;
+        out += static_cast<std::size_t>(z) * size;
+
+        // The flows are always added in the same order, so each point gives the same result
+        // however it is weathered
+        auto weather_point = [&](int x)
+        {
+            float total = 0.0f;
+            if (x > 0)
+            {
+                total += talus_flow(row[x - 1] - row[x], talus);
+            }
+            if (x < size - 1)
+            {
+                total += talus_flow(row[x + 1] - row[x], talus);
+            }
+            if (down)
+            {
+                total += talus_flow(down[x] - row[x], talus);
+            }
+            if (up)
+            {
+                total += talus_flow(up[x] - row[x], talus);
+            }
+            out[x] = row[x] + total * rate;
+        };
+
+        if (!down || !up || size < 3)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                weather_point(x);
+            }
+            return;
+        }
+
+        weather_point(0);
+        weather_point(size - 1);
+        int x = 1;
+#ifdef SPOOKY_USE_SSE
+        const __m128 talus4 = _mm_set1_ps(talus);
+        const __m128 negative_talus4 = _mm_set1_ps(-talus);
+        const __m128 rate4 = _mm_set1_ps(rate);
+        auto flow4 = [&](__m128 neighbour, __m128 height)
+        {
+            __m128 difference = _mm_sub_ps(neighbour, height);
+            return _mm_sub_ps(difference,
+                              _mm_min_ps(_mm_max_ps(difference, negative_talus4), talus4));
+        };
+        for (; x + 4 <= size - 1; x += 4)
+        {
+            __m128 height = _mm_loadu_ps(row + x);
+            __m128 total = _mm_add_ps(flow4(_mm_loadu_ps(row + x - 1), height),
+                                      flow4(_mm_loadu_ps(row + x + 1), height));
+            total = _mm_add_ps(total, flow4(_mm_loadu_ps(down + x), height));
+            total = _mm_add_ps(total, flow4(_mm_loadu_ps(up + x), height));
+            _mm_storeu_ps(out + x, _mm_add_ps(height, _mm_mul_ps(total, rate4)));
+        }
+#endif
+        for (; x < size - 1; x++)
+        {
+            weather_point(x);
+        }
+    }
+
+    /// Runs the function with each index from 0 to count spread over the threads
+    template <typename F>
+    void parallel_for(int count, unsigned thread_count, F function)
+    {
+        std::atomic_int next = 0;
+        auto run = [&]
+        {
+            for (int i = next++; i < count; i = next++)
+            {
+                function(i);
+            }
+        };
+
+        std::vector<std::jthread> threads;
+        for (unsigned i = 1; i < std::min(thread_count, static_cast<unsigned>(count)); i++)
+        {
+            threads.emplace_back(run);
+        }
+        run();
+    }
+} // namespace
+
+bool ErosionOptions::gui()
+{
+    bool erode = false;
+    if (ImGui::Begin("Erosion"))
+    {
+        // clang-format off
+        ImGui::SliderInt  ("Seed",                  &seed,                  1,      1000000);
+        ImGui::Separator();
+        ImGui::Text("Hydraulic");
+        ImGui::SliderFloat("Droplet Density",       &droplet_density,       0.0f,   8.0f);
+        ImGui::SliderInt  ("Max Lifetime",          &max_lifetime,          1,      100);
+        ImGui::SliderFloat("Inertia",               &inertia,               0.0f,   1.0f);
+        ImGui::SliderFloat("Sediment Capacity",     &sediment_capacity,     0.1f,   16.0f);
+        ImGui::SliderFloat("Min Sediment Capacity", &min_sediment_capacity, 0.0f,   1.0f);
+        ImGui::SliderFloat("Erode Speed",           &erode_speed,           0.0f,   1.0f);
+        ImGui::SliderFloat("Deposit Speed",         &deposit_speed,         0.0f,   1.0f);
+        ImGui::SliderFloat("Evaporate Speed",       &evaporate_speed,       0.0f,   0.5f);
+        ImGui::SliderFloat("Gravity",               &gravity,               0.1f,   16.0f);
+        ImGui::Separator();
+        ImGui::Text("Thermal");
+        ImGui::SliderInt  ("Iterations",            &thermal_iterations,    0,      500);
+        ImGui::SliderFloat("Talus Slope",           &talus,                 0.1f,   8.0f);
+        ImGui::SliderFloat("Rate",                  &thermal_rate,          0.0f,   1.0f);
+        // clang-format on
+        ImGui::Separator();
+
+        ImGui::Checkbox("Erode Generated Terrain", &erode_generated);
+        erode = ImGui::Button("Erode");
+    }
+    ImGui::End();
+    return erode;
+}
+
+TerrainEroder::TerrainEroder(unsigned thread_count)
+    : thread_count_(thread_count > 0 ? thread_count
+                                     : std::max(std::thread::hardware_concurrency(), 1u))
+{
+}
+
+void TerrainEroder::start(int size, const ErosionOptions& options)
+{
+    options_ = options;
+    stats_ = {};
+    size_ = size;
+    step_ = 0;
+
+    // Droplets start in [0, size - 1), and same coloured tiles are a tile apart, so droplets
+    // from two of them can never reach the same points
+    tile_size_ = (options_.max_lifetime + 2) * 2;
+    tiles_ = size_ > 1 ? (size_ - 1 + tile_size_ - 1) / tile_size_ : 0;
+
+    droplet_steps_ = 0;
+    if (tiles_ > 0 && options_.droplet_density > 0.0f)
+    {
+        droplet_steps_ = std::max(
+            static_cast<int>(std::ceil(options_.droplet_density * DROPLET_STEPS_PER_DENSITY)), 1);
+    }
+    total_steps_ = droplet_steps_ + (size_ > 1 ? std::max(options_.thermal_iterations, 0) : 0);
+}
+
+void TerrainEroder::stop()
+{
+    step_ = total_steps_;
+}
+
+bool TerrainEroder::update(HeightMap& height_map, sf::Time budget)
+{
+    if (!is_running())
+    {
+        return true;
+    }
+
+    sf::Clock clock;
+    do
+    {
+        run_step(height_map);
+    } while (is_running() && clock.getElapsedTime() < budget);
+
+    height_map.update_min_max();
+    return !is_running();
+}
+
+void TerrainEroder::finish(HeightMap& height_map)
+{
+    while (is_running())
+    {
+        run_step(height_map);
+    }
+    height_map.update_min_max();
+}
+
+bool TerrainEroder::is_running() const
+{
+    return step_ < total_steps_;
+}
+
+float TerrainEroder::get_progress() const
+{
+    return total_steps_ > 0 ? static_cast<float>(step_) / static_cast<float>(total_steps_) : 1.0f;
+}
+
+const TerrainEroder::Stats& TerrainEroder::get_stats() const
+{
+    return stats_;
+}
+
+void TerrainEroder::run_step(HeightMap& height_map)
+{
+    assert(height_map.size == size_);
+    if (step_ < droplet_steps_)
+    {
+        run_droplets_step(height_map);
+    }
+    else
+    {
+        run_thermal_step(height_map);
+    }
+    step_++;
+}
+
+void TerrainEroder::run_droplets_step(HeightMap& height_map)
+{
+    float density = options_.droplet_density / static_cast<float>(droplet_steps_);
+    int start_size = size_ - 1;
+
+    // Tiles are coloured in a 2x2 pattern, and all of the tiles of one colour are run at once
+    std::atomic<std::int64_t> droplets = 0;
+    std::vector<int> tiles;
+    for (int colour = 0; colour < 4; colour++)
+    {
+        tiles.clear();
+        for (int tile_z = colour / 2; tile_z < tiles_; tile_z += 2)
+        {
+            for (int tile_x = colour % 2; tile_x < tiles_; tile_x += 2)
+            {
+                tiles.push_back(tile_z * tiles_ + tile_x);
+            }
+        }
+
+        parallel_for(
+            static_cast<int>(tiles.size()), thread_count_,
+            [&](int i)
+            {
+                int tile = tiles[i];
+                int begin_x = tile % tiles_ * tile_size_;
+                int begin_z = tile / tiles_ * tile_size_;
+                int width = std::min(tile_size_, start_size - begin_x);
+                int depth = std::min(tile_size_, start_size - begin_z);
+                auto count = static_cast<int>(static_cast<float>(width * depth) * density + 0.5f);
+
+                CounterRandom random{static_cast<std::uint64_t>(options_.seed),
+                                     static_cast<std::uint64_t>(step_) << 32 |
+                                         static_cast<std::uint64_t>(tile)};
+                for (int j = 0; j < count; j++)
+                {
+                    float x = static_cast<float>(begin_x) + random.next_float() * width;
+                    float z = static_cast<float>(begin_z) + random.next_float() * depth;
+                    run_droplet(height_map.heights.data(), size_, std::min(x, start_size - 1e-3f),
+                                std::min(z, start_size - 1e-3f), options_);
+                }
+                droplets += count;
+            });
+    }
+    stats_.droplets += droplets;
+}
+
+void TerrainEroder::run_thermal_step(HeightMap& height_map)
+{
+    previous_heights_ = height_map.heights;
+
+    // Each point has four neighbours, so it can lose at most a quarter of its extra to each
+    float rate = std::clamp(options_.thermal_rate, 0.0f, 1.0f) * 0.25f;
+    auto thread_count = static_cast<unsigned>(
+        std::clamp<int>(size_ / MIN_ROWS_PER_THREAD, 1, static_cast<int>(thread_count_)));
+
+    // Each thread weathers its own block of rows
+    auto weather_rows = [&](int i)
+    {
+        int end = size_ * (i + 1) / static_cast<int>(thread_count);
+        for (int z = size_ * i / static_cast<int>(thread_count); z < end; z++)
+        {
+            weather_row(previous_heights_.data(), height_map.heights.data(), size_, z,
+                        options_.talus, rate);
+        }
+    };
+    parallel_for(static_cast<int>(thread_count), thread_count, weather_rows);
+    stats_.thermal_iterations++;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <SFML/System/Time.hpp>
+
+struct HeightMap;
+
+struct ErosionOptions
+{
+    int seed = 1337;
+
+    // Hydraulic erosion, where droplets of water run down the slopes carrying sediment
+    float droplet_density = 1.0f;
+    int max_lifetime = 30;
+    float inertia = 0.05f;
+    float sediment_capacity = 4.0f;
+    float min_sediment_capacity = 0.01f;
+    float erode_speed = 0.3f;
+    float deposit_speed = 0.3f;
+    float evaporate_speed = 0.01f;
+    float gravity = 4.0f;
+
+    // Thermal weathering, where slopes steeper than the talus slope crumble onto their neighbours
+    int thermal_iterations = 50;
+    float talus = 1.0f;
+    float thermal_rate = 0.5f;
+
+    /// Erode the terrain every time it is generated
+    bool erode_generated = false;
+
+    /// Returns true if the erosion should be run on the current terrain
+    bool gui();
+};
+
+/**
+ * @brief Erodes a height map after it has been generated, first with particle based hydraulic
+ * erosion and then with thermal weathering.
+ *
+ * The work is split into steps that are run by update() until its time budget is used up, so
+ * eroding a large map can be spread across many frames.
+ *
+ * Droplets are started from each square tile of the map in turn, with random numbers from the
+ * seed and a stream for the step and tile. Every other tile in both directions is run in
+ * parallel, and the tiles are big enough that droplets from two tiles never touch the same
+ * points, so the result only depends on the seed and not on the thread count or how the steps
+ * were spread over the frames. Thermal weathering reads from a copy of the heights, so it is the
+ * same either way.
+ */
+class TerrainEroder
+{
+  public:
+    struct Stats
+    {
+        std::int64_t droplets = 0;
+        int thermal_iterations = 0;
+    };
+
+    /// @param thread_count Number of threads to erode with, 0 picks based on the hardware
+    explicit TerrainEroder(unsigned thread_count = 0);
+
+    /// Starts eroding a height map of the given size, throwing away any erosion in progress
+    void start(int size, const ErosionOptions& options);
+    void stop();
+
+    /// Runs erosion steps on the height map until the budget is used up, always running at least
+    /// one. Returns true once the erosion is finished.
+    bool update(HeightMap& height_map, sf::Time budget);
+
+    /// Runs every remaining step
+    void finish(HeightMap& height_map);
+
+    bool is_running() const;
+
+    /// Fraction of the steps that have been run
+    float get_progress() const;
+
+    const Stats& get_stats() const;
+
+  private:
+    void run_step(HeightMap& height_map);
+    void run_droplets_step(HeightMap& height_map);
+    void run_thermal_step(HeightMap& height_map);
+
+    ErosionOptions options_;
+    Stats stats_;
+    unsigned thread_count_ = 0;
+
+    int size_ = 0;
+    int tile_size_ = 0;
+    int tiles_ = 0;
+
+    int step_ = 0;
+    int droplet_steps_ = 0;
+    int total_steps_ = 0;
+
+    // Heights from before each thermal weathering step
+    std::vector<float> previous_heights_;
+};
@@ -0,0 +1,135 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifndef __linux__
+namespace
+{
+    constexpr auto POLL_INTERVAL = std::chrono::milliseconds(250);
+} // namespace
+#endif
+
+FileWatcher::FileWatcher()
+{
+#ifdef __linux__
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ == -1)
+    {
+        std::cerr << "Failed to create inotify instance, files will not be watched.\n";
+    }
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (inotify_fd_ != -1)
+    {
+        ::close(inotify_fd_);
+    }
+#endif
+}
+
+void FileWatcher::watch(const std::filesystem::path& path)
+{
+    auto canonical = get_canonical_path(path);
+    if (!files_.insert(canonical.generic_string()).second)
+    {
+        return;
+    }
+
+#ifdef __linux__
+    if (inotify_fd_ == -1)
+    {
+        return;
+    }
+
+    // Watching the same directory again returns the same descriptor
+    auto directory = canonical.parent_path();
+    int descriptor = inotify_add_watch(inotify_fd_, directory.c_str(),
+                                       IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (descriptor == -1)
+    {
+        std::cerr << "Failed to watch " << directory << '\n';
+        return;
+    }
+    directories_[descriptor] = directory;
+#else
+    std::error_code error;
+    write_times_[canonical.generic_string()] = std::filesystem::last_write_time(canonical, error);
+#endif
+}
+
+std::vector<std::filesystem::path> FileWatcher::poll()
+{
+    std::vector<std::filesystem::path> changed;
+
+#ifdef __linux__
+    if (inotify_fd_ == -1)
+    {
+        return changed;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (true)
+    {
+        auto length = ::read(inotify_fd_, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            break;
+        }
+
+        for (auto offset = 0; offset < length;)
+        {
+            auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += static_cast<int>(sizeof(inotify_event) + event->len);
+
+            auto directory = directories_.find(event->wd);
+            if (event->len == 0 || directory == directories_.end())
+            {
+                continue;
+            }
+
+            auto path = directory->second / event->name;
+            if (files_.contains(path.generic_string()) &&
+                std::find(changed.begin(), changed.end(), path) == changed.end())
+            {
+                changed.push_back(path);
+            }
+        }
+    }
+#else
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_poll_ < POLL_INTERVAL)
+    {
+        return changed;
+    }
+    last_poll_ = now;
+
+    for (auto& [file, write_time] : write_times_)
+    {
+        std::error_code error;
+        auto current = std::filesystem::last_write_time(file, error);
+        if (!error && current != write_time)
+        {
+            write_time = current;
+            changed.push_back(file);
+        }
+    }
+#endif
+
+    return changed;
+}
+
+std::filesystem::path FileWatcher::get_canonical_path(const std::filesystem::path& path)
+{
+    std::error_code error;
+    auto canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? std::filesystem::absolute(path, error).lexically_normal() : canonical;
+}
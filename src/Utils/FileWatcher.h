@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Reports watched files that have changed on disk, without blocking.
+ *
+ * On Linux this uses inotify on the directories of the files, so editors that save by writing a
+ * new file and renaming it over the old one are still seen. Elsewhere the modification times of
+ * the files are polled a few times a second instead.
+ */
+class FileWatcher
+{
+  public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher& other) = delete;
+    FileWatcher& operator=(const FileWatcher& other) = delete;
+
+    void watch(const std::filesystem::path& path);
+
+    /// Returns the canonical paths of the watched files that have changed since the last call
+    std::vector<std::filesystem::path> poll();
+
+    /// The path that poll() returns for the file
+    static std::filesystem::path get_canonical_path(const std::filesystem::path& path);
+
+  private:
+    std::unordered_set<std::string> files_;
+
+#ifdef __linux__
+    int inotify_fd_ = -1;
+
+    // Watched directories, by their watch descriptor
+    std::unordered_map<int, std::filesystem::path> directories_;
+#else
+    std::unordered_map<std::string, std::filesystem::file_time_type> write_times_;
+    std::chrono::steady_clock::time_point last_poll_;
+#endif
+};
@@ -1,15 +1,24 @@
 #include "HeightMap.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
 #include <fstream>
 #include <imgui.h>
 #include <iostream>
+#include <limits>
+#include <ranges>
 #include <unordered_map>
 
 #include <SFML/Graphics/Image.hpp>
+#include <SFML/System/Clock.hpp>
 #include <imgui.h>
+#include <lodepng.h>
 
 #include "../GUI.h"
+#include "AsciiGrid.h"
+#include "Simd.h"
 #include "Util.h"
 
 namespace
@@ -37,6 +46,112 @@ namespace
         {"Value", FastNoiseLite::NoiseType::NoiseType_Value},
     };
 
+    /// The quad of points a position is in, and how far across it the position is
+    struct SamplePoint
+    {
+        std::size_t index = 0;
+        glm::vec2 t{0.0f};
+    };
+
+    SamplePoint find_sample_point(int size, float x, float z)
+    {
+        // The last quad is used for positions on the far edges, so its far points are in bounds
+        auto max_coord = static_cast<float>(size - 1);
+        auto max_quad = static_cast<float>(size - 2);
+        x = std::clamp(x, 0.0f, max_coord);
+        z = std::clamp(z, 0.0f, max_coord);
+        float quad_x = std::min(std::floor(x), max_quad);
+        float quad_z = std::min(std::floor(z), max_quad);
+
+        return {static_cast<std::size_t>(quad_z) * size + static_cast<std::size_t>(quad_x),
+                {x - quad_x, z - quad_z}};
+    }
+
+    float lerp(float a, float b, float t)
+    {
+        return a + (b - a) * t;
+    }
+
+    // Number of rows converted at a time when streaming raw heightmaps to and from files
+    constexpr std::size_t RAW_CHUNK_ROWS = 64;
+
+    std::uint16_t to_unorm16(float height, float min_height, float max_height)
+    {
+        auto range = max_height - min_height;
+        auto t = range > 0.0f ? (height - min_height) / range : 0.0f;
+        return static_cast<std::uint16_t>(std::clamp(t, 0.0f, 1.0f) * 65535.0f + 0.5f);
+    }
+
+    float from_unorm16(std::uint16_t value, float min_height, float max_height)
+    {
+        return min_height + static_cast<float>(value) / 65535.0f * (max_height - min_height);
+    }
+
+    /// Raw heightmaps are always little endian, so this swaps the bytes on big endian machines
+    template <typename T>
+    T to_little_endian(T value)
+    {
+        if constexpr (std::endian::native == std::endian::big)
+        {
+            return std::byteswap(value);
+        }
+        return value;
+    }
+
+    /// Streams the heights to the file a chunk of rows at a time, converting each to a sample
+    template <typename Sample, typename F>
+    bool write_samples(const std::filesystem::path& path, const std::vector<float>& heights,
+                       int size, F to_sample)
+    {
+        std::ofstream file(path, std::ios::binary);
+        std::vector<Sample> chunk(static_cast<std::size_t>(size) * RAW_CHUNK_ROWS);
+        for (std::size_t begin = 0; begin < heights.size() && file; begin += chunk.size())
+        {
+            auto count = std::min(chunk.size(), heights.size() - begin);
+            for (std::size_t i = 0; i < count; i++)
+            {
+                chunk[i] = to_little_endian(to_sample(heights[begin + i]));
+            }
+            file.write(reinterpret_cast<const char*>(chunk.data()), count * sizeof(Sample));
+        }
+        return file.good();
+    }
+
+    /// Streams the samples from the file a chunk of rows at a time, converting each to a height
+    template <typename Sample, typename F>
+    bool read_samples(const std::filesystem::path& path, std::vector<float>& heights, int size,
+                      F to_height)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<Sample> chunk(static_cast<std::size_t>(size) * RAW_CHUNK_ROWS);
+        for (std::size_t begin = 0; begin < heights.size() && file; begin += chunk.size())
+        {
+            auto count = std::min(chunk.size(), heights.size() - begin);
+            file.read(reinterpret_cast<char*>(chunk.data()), count * sizeof(Sample));
+            for (std::size_t i = 0; i < count; i++)
+            {
+                heights[begin + i] = to_height(to_little_endian(chunk[i]));
+            }
+        }
+        return file.good();
+    }
+
+    /// Copies row major samples into a square height map, padding it out with the fill height
+    template <typename F>
+    HeightMap to_square_height_map(unsigned width, unsigned height, float fill, F get_height)
+    {
+        HeightMap height_map{static_cast<int>(std::max(width, height))};
+        std::ranges::fill(height_map.heights, fill);
+        for (unsigned z = 0; z < height; z++)
+        {
+            for (unsigned x = 0; x < width; x++)
+            {
+                height_map.heights[z * height_map.size + x] = get_height(z * width + x);
+            }
+        }
+        height_map.update_min_max();
+        return height_map;
+    }
 } // namespace
 
 HeightMap::HeightMap(int size)
@@ -46,6 +161,7 @@ HeightMap::HeightMap(int size)
     std::fill(heights.begin(), heights.end(), 0.0f);
     noise_gen_.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
     noise_gen_.SetFractalType(FastNoiseLite::FractalType::FractalType_FBm);
+    update_min_max();
 }
 
 float HeightMap::get_height(int x, int z) const
@@ -63,7 +179,136 @@ void HeightMap::set_height(int x, int z, float height)
 {
     assert(x >= 0 && z >= 0 && x < size && z < size);
     heights[z * size + x] = height;
+
+    // The point is a corner of up to four quads, and only the cells above them can change
+    int min_x = x - 1;
+    int min_z = z - 1;
+    int max_x = x;
+    int max_z = z;
+    for (int level = 0; level < static_cast<int>(min_max_levels_.size()); level++)
+    {
+        int level_size = min_max_levels_[level].size;
+        for (int cell_z = std::max(min_z, 0); cell_z <= std::min(max_z, level_size - 1); cell_z++)
+        {
+            for (int cell_x = std::max(min_x, 0); cell_x <= std::min(max_x, level_size - 1);
+                 cell_x++)
+            {
+                update_min_max_cell(level, cell_x, cell_z);
+            }
+        }
+        min_x = std::max(min_x, 0) / 2;
+        min_z = std::max(min_z, 0) / 2;
+        max_x /= 2;
+        max_z /= 2;
+    }
+}
+
+float HeightMap::sample(float x, float z) const
+{
+    if (size < 2)
+    {
+        return heights.front();
+    }
+
+    auto [index, t] = find_sample_point(size, x, z);
+    float top = lerp(heights[index], heights[index + 1], t.x);
+    float bottom = lerp(heights[index + size], heights[index + size + 1], t.x);
+    return lerp(top, bottom, t.y);
+}
+
+glm::vec3 HeightMap::sample_normal(float x, float z) const
+{
+    if (size < 2)
+    {
+        return {0.0f, 1.0f, 0.0f};
+    }
+
+    auto [index, t] = find_sample_point(size, x, z);
+    float h00 = heights[index];
+    float h10 = heights[index + 1];
+    float h01 = heights[index + size];
+    float h11 = heights[index + size + 1];
+
+    // Partial derivatives of the bilinear interpolation along x and z
+    float slope_x = lerp(h10 - h00, h11 - h01, t.y);
+    float slope_z = lerp(h01 - h00, h11 - h10, t.x);
+    return glm::normalize(glm::vec3{-slope_x, 1.0f, -slope_z});
+}
+
+#ifdef SPOOKY_USE_SSE
+void HeightMap::sample_many(std::span<const glm::vec2> positions,
+                            std::span<float> out_heights) const
+{
+    assert(out_heights.size() >= positions.size());
+    if (size < 2)
+    {
+        std::fill_n(out_heights.begin(), positions.size(), heights.front());
+        return;
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 max_coord = _mm_set1_ps(static_cast<float>(size - 1));
+    const __m128 max_quad = _mm_set1_ps(static_cast<float>(size - 2));
+
+    std::size_t i = 0;
+    for (; i + 4 <= positions.size(); i += 4)
+    {
+        // Two loads of interleaved (x, z) pairs are split into 4 x's and 4 z's
+        __m128 xz01 = _mm_loadu_ps(&positions[i].x);
+        __m128 xz23 = _mm_loadu_ps(&positions[i + 2].x);
+        __m128 x = _mm_shuffle_ps(xz01, xz23, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 z = _mm_shuffle_ps(xz01, xz23, _MM_SHUFFLE(3, 1, 3, 1));
+
+        x = _mm_min_ps(_mm_max_ps(x, zero), max_coord);
+        z = _mm_min_ps(_mm_max_ps(z, zero), max_coord);
+
+        // Truncating is the same as flooring as the positions are never negative here
+        __m128i quad_x = _mm_cvttps_epi32(_mm_min_ps(x, max_quad));
+        __m128i quad_z = _mm_cvttps_epi32(_mm_min_ps(z, max_quad));
+        __m128 tx = _mm_sub_ps(x, _mm_cvtepi32_ps(quad_x));
+        __m128 tz = _mm_sub_ps(z, _mm_cvtepi32_ps(quad_z));
+
+        // SSE2 has no gather, so the four points around each position are loaded one by one
+        alignas(16) std::int32_t xs[4];
+        alignas(16) std::int32_t zs[4];
+        alignas(16) float h00[4];
+        alignas(16) float h10[4];
+        alignas(16) float h01[4];
+        alignas(16) float h11[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(xs), quad_x);
+        _mm_store_si128(reinterpret_cast<__m128i*>(zs), quad_z);
+        for (int j = 0; j < 4; j++)
+        {
+            auto index = static_cast<std::size_t>(zs[j]) * size + xs[j];
+            h00[j] = heights[index];
+            h10[j] = heights[index + 1];
+            h01[j] = heights[index + size];
+            h11[j] = heights[index + size + 1];
+        }
+
+        auto lerp4 = [](__m128 a, __m128 b, __m128 t)
+        { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)); };
+        __m128 top = lerp4(_mm_load_ps(h00), _mm_load_ps(h10), tx);
+        __m128 bottom = lerp4(_mm_load_ps(h01), _mm_load_ps(h11), tx);
+        _mm_storeu_ps(&out_heights[i], lerp4(top, bottom, tz));
+    }
+
+    for (; i < positions.size(); i++)
+    {
+        out_heights[i] = sample(positions[i].x, positions[i].y);
+    }
+}
+#else
+void HeightMap::sample_many(std::span<const glm::vec2> positions,
+                            std::span<float> out_heights) const
+{
+    assert(out_heights.size() >= positions.size());
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        out_heights[i] = sample(positions[i].x, positions[i].y);
+    }
 }
+#endif
 
 float HeightMap::set_base_height()
 {
@@ -76,20 +321,257 @@ float HeightMap::set_base_height()
         h -= min_diff;
     }
 
+    // Every height moved by the same amount, so the pyramid can be moved rather than rebuilt
+    for (auto& level : min_max_levels_)
+    {
+        for (auto& cell : level.cells)
+        {
+            cell -= min_diff;
+        }
+    }
+
     return min_diff;
 }
 
 float HeightMap::min_height() const
 {
-    return *std::min_element(heights.begin(), heights.end());
+    return min_max_levels_.empty() ? heights.front() : min_max_levels_.back().cells.front().x;
 }
 
 float HeightMap::max_height() const
 {
-    return *std::max_element(heights.begin(), heights.end());
+    return min_max_levels_.empty() ? heights.front() : min_max_levels_.back().cells.front().y;
+}
+
+glm::vec2 HeightMap::get_min_max(int x, int z, int width, int depth) const
+{
+    if (min_max_levels_.empty())
+    {
+        return {heights.front(), heights.front()};
+    }
+
+    glm::vec2 min_max{std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()};
+    int end_x = x + width;
+    int end_z = z + depth;
+
+    // Cells entirely inside the range are used as they are, and cells that are partly inside are
+    // split into the cells below them
+    auto visit = [&](auto& self, int level, int cell_x, int cell_z) -> void
+    {
+        int cell_size = 1 << level;
+        int begin_x = cell_x * cell_size;
+        int begin_z = cell_z * cell_size;
+        if (begin_x >= end_x || begin_z >= end_z || begin_x + cell_size <= x ||
+            begin_z + cell_size <= z)
+        {
+            return;
+        }
+
+        auto& cells = min_max_levels_[level];
+        if (level == 0 || (begin_x >= x && begin_z >= z && begin_x + cell_size <= end_x &&
+                           begin_z + cell_size <= end_z))
+        {
+            auto cell = cells.cells[cell_z * cells.size + cell_x];
+            min_max = glm::vec2{std::min(min_max.x, cell.x), std::max(min_max.y, cell.y)};
+            return;
+        }
+
+        int child_size = min_max_levels_[level - 1].size;
+        for (int child_z = cell_z * 2; child_z < std::min(cell_z * 2 + 2, child_size); child_z++)
+        {
+            for (int child_x = cell_x * 2; child_x < std::min(cell_x * 2 + 2, child_size);
+                 child_x++)
+            {
+                self(self, level - 1, child_x, child_z);
+            }
+        }
+    };
+    visit(visit, static_cast<int>(min_max_levels_.size()) - 1, 0, 0);
+    return min_max;
+}
+
+void HeightMap::update_min_max()
+{
+    min_max_levels_.clear();
+    for (int level_size = size - 1; level_size > 0; level_size = (level_size + 1) / 2)
+    {
+        auto& level = min_max_levels_.emplace_back();
+        level.size = level_size;
+        level.cells.resize(static_cast<std::size_t>(level_size) * level_size);
+
+        int level_index = static_cast<int>(min_max_levels_.size()) - 1;
+        for (int z = 0; z < level_size; z++)
+        {
+            for (int x = 0; x < level_size; x++)
+            {
+                update_min_max_cell(level_index, x, z);
+            }
+        }
+
+        if (level_size == 1)
+        {
+            break;
+        }
+    }
+}
+
+void HeightMap::update_min_max_cell(int level, int x, int z)
+{
+    glm::vec2 min_max{std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()};
+    auto include = [&](glm::vec2 other)
+    { min_max = glm::vec2{std::min(min_max.x, other.x), std::max(min_max.y, other.y)}; };
+
+    if (level == 0)
+    {
+        // The four corners of the quad
+        for (int corner = 0; corner < 4; corner++)
+        {
+            float height = heights[(z + corner / 2) * size + x + corner % 2];
+            include({height, height});
+        }
+    }
+    else
+    {
+        auto& children = min_max_levels_[level - 1];
+        for (int child_z = z * 2; child_z < std::min(z * 2 + 2, children.size); child_z++)
+        {
+            for (int child_x = x * 2; child_x < std::min(x * 2 + 2, children.size); child_x++)
+            {
+                include(children.cells[child_z * children.size + child_x]);
+            }
+        }
+    }
+
+    auto& cells = min_max_levels_[level];
+    cells.cells[z * cells.size + x] = min_max;
+}
+
+std::optional<float> HeightMap::raycast(const glm::vec3& origin, const glm::vec3& direction,
+                                        float max_distance) const
+{
+    if (min_max_levels_.empty())
+    {
+        return {};
+    }
+
+    float closest = max_distance;
+    bool hit = false;
+
+    // Distance the ray enters the cell's bounding box, if it does so before the closest hit
+    auto enter_cell = [&](int level, int x, int z) -> std::optional<float>
+    {
+        int cell_size = 1 << level;
+        auto& cells = min_max_levels_[level];
+        auto min_max = cells.cells[z * cells.size + x];
+        glm::vec3 box_min{x * cell_size, min_max.x, z * cell_size};
+        glm::vec3 box_max{std::min((x + 1) * cell_size, size - 1), min_max.y,
+                          std::min((z + 1) * cell_size, size - 1)};
+
+        float enter = 0.0f;
+        float exit = closest;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (std::abs(direction[axis]) < 1e-8f)
+            {
+                if (origin[axis] < box_min[axis] || origin[axis] > box_max[axis])
+                {
+                    return {};
+                }
+                continue;
+            }
+            float t0 = (box_min[axis] - origin[axis]) / direction[axis];
+            float t1 = (box_max[axis] - origin[axis]) / direction[axis];
+            enter = std::max(enter, std::min(t0, t1));
+            exit = std::min(exit, std::max(t0, t1));
+        }
+        return enter <= exit ? std::optional{enter} : std::nullopt;
+    };
+
+    // Moller-Trumbore, with the triangles wound the same way as the terrain mesh. The edges are
+    // slightly widened so rays through the shared edges and corners cannot slip between triangles
+    constexpr float EDGE_EPSILON = 1e-5f;
+    auto intersect_triangle = [&](const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        auto edge_ab = b - a;
+        auto edge_ac = c - a;
+        auto p = glm::cross(direction, edge_ac);
+        float determinant = glm::dot(edge_ab, p);
+        if (std::abs(determinant) < 1e-8f)
+        {
+            return;
+        }
+
+        auto to_origin = origin - a;
+        float u = glm::dot(to_origin, p) / determinant;
+        auto q = glm::cross(to_origin, edge_ab);
+        float v = glm::dot(direction, q) / determinant;
+        float t = glm::dot(edge_ac, q) / determinant;
+        if (u >= -EDGE_EPSILON && v >= -EDGE_EPSILON && u + v <= 1.0f + EDGE_EPSILON &&
+            t >= 0.0f && t <= closest)
+        {
+            closest = t;
+            hit = true;
+        }
+    };
+
+    struct Cell
+    {
+        int level = 0;
+        int x = 0;
+        int z = 0;
+        float enter = 0.0f;
+    };
+    std::vector<Cell> stack;
+    int top = static_cast<int>(min_max_levels_.size()) - 1;
+    if (auto enter = enter_cell(top, 0, 0))
+    {
+        stack.push_back({top, 0, 0, *enter});
+    }
+
+    while (!stack.empty())
+    {
+        auto cell = stack.back();
+        stack.pop_back();
+        if (cell.enter > closest)
+        {
+            continue;
+        }
+
+        if (cell.level == 0)
+        {
+            auto point = [&](int x, int z)
+            { return glm::vec3{x, heights[z * size + x], z}; };
+            int x = cell.x;
+            int z = cell.z;
+            intersect_triangle(point(x, z), point(x, z + 1), point(x + 1, z));
+            intersect_triangle(point(x + 1, z), point(x, z + 1), point(x + 1, z + 1));
+            continue;
+        }
+
+        // The children are pushed furthest first, so the nearest is tested next
+        std::array<Cell, 4> children;
+        int child_count = 0;
+        int child_size = min_max_levels_[cell.level - 1].size;
+        for (int z = cell.z * 2; z < std::min(cell.z * 2 + 2, child_size); z++)
+        {
+            for (int x = cell.x * 2; x < std::min(cell.x * 2 + 2, child_size); x++)
+            {
+                if (auto enter = enter_cell(cell.level - 1, x, z))
+                {
+                    children[child_count++] = {cell.level - 1, x, z, *enter};
+                }
+            }
+        }
+        std::sort(children.begin(), children.begin() + child_count,
+                  [](auto& a, auto& b) { return a.enter > b.enter; });
+        stack.insert(stack.end(), children.begin(), children.begin() + child_count);
+    }
+
+    return hit ? std::optional{closest} : std::nullopt;
 }
 
-void HeightMap::generate_terrain(const TerrainGenerationOptions& options)
+void HeightMap::generate_terrain(const TerrainGenerationOptions& options, int offset_x,
+                                 int offset_z)
 {
     noise_gen_.SetFrequency(options.frequency);
     noise_gen_.SetFractalOctaves(options.octaves);
@@ -100,12 +582,15 @@ void HeightMap::generate_terrain(const TerrainGenerationOptions& options)
     {
         for (int x = 0; x < size; x++)
         {
-            float noise = noise_gen_.GetNoise(x * 0.01f, z * 0.01f);
+            float world_x = static_cast<float>(x + offset_x);
+            float world_z = static_cast<float>(z + offset_z);
+
+            float noise = noise_gen_.GetNoise(world_x * 0.01f, world_z * 0.01f);
             noise = (noise + 1.0f) / 2.0f;
             float height =
                 noise * options.amplitude - (options.amplitude / options.amplitude_dampen);
 
-            float noise2 = noise_gen_.GetNoise(x * 0.06f, z * 0.06f);
+            float noise2 = noise_gen_.GetNoise(world_x * 0.06f, world_z * 0.06f);
             noise2 = (noise2 + 1.0f) / 2.0f;
             height += noise2 * options.amplitude / options.amplitude_dampen;
 
@@ -135,116 +620,172 @@ void HeightMap::generate_terrain(const TerrainGenerationOptions& options)
                 height *= bump;
             }
 
-            set_height(x, z, height);
+            heights[z * size + x] = height;
         }
     }
+    update_min_max();
 }
 
-HeightMap HeightMap::from_image(const std::filesystem::path& path)
+bool HeightMap::uses_default_noise() const
 {
-    sf::Image img;
-    img.loadFromFile(path.string());
-
-    assert(img.getSize().x == img.getSize().y);
-
-    HeightMap height_map{static_cast<int>(img.getSize().x)};
+    return noise_type_ == FastNoiseLite::NoiseType_OpenSimplex2 &&
+           fractal_type_ == FastNoiseLite::FractalType_FBm;
+}
 
-    for (int z = 0; z < height_map.size; z++)
+HeightMap HeightMap::from_image(const std::filesystem::path& path, float min_height,
+                                float max_height)
+{
+    // SFML only loads 8 bits per channel, so 16-bit PNGs are decoded with lodepng instead
+    std::vector<unsigned char> png;
+    unsigned width = 0;
+    unsigned height = 0;
+    lodepng::State state;
+    if (path.extension() == ".png" && lodepng::load_file(png, path.string()) == 0 &&
+        lodepng_inspect(&width, &height, &state, png.data(), png.size()) == 0 &&
+        state.info_png.color.bitdepth == 16)
     {
-        for (int x = 0; x < height_map.size; x++)
+        std::vector<unsigned char> pixels;
+        if (auto error = lodepng::decode(pixels, width, height, png, LCT_GREY, 16))
         {
-            auto height = static_cast<float>(img.getPixel(x, z).r);
-            height_map.set_height(x, z, height);
+            std::cerr << "Failed to load " << path << ": " << lodepng_error_text(error) << '\n';
+            return HeightMap{1};
         }
+
+        // 16-bit PNG samples are big endian
+        return to_square_height_map(
+            width, height, min_height,
+            [&](std::size_t i)
+            {
+                auto value = static_cast<std::uint16_t>(pixels[i * 2] << 8 | pixels[i * 2 + 1]);
+                return from_unorm16(value, min_height, max_height);
+            });
     }
-    return height_map;
+
+    sf::Image img;
+    if (!img.loadFromFile(path.string()))
+    {
+        return HeightMap{1};
+    }
+
+    // Only the red channel is used
+    const auto* pixels = img.getPixelsPtr();
+    return to_square_height_map(
+        img.getSize().x, img.getSize().y, min_height,
+        [&](std::size_t i)
+        {
+            auto t = static_cast<float>(pixels[i * 4]) / 255.0f;
+            return min_height + t * (max_height - min_height);
+        });
 }
 
 HeightMap HeightMap::from_ascii(const std::filesystem::path& path, float scale)
 {
-    const static std::string numbers = "-0123456789";
-    std::ifstream ascii_file(path);
-    std::string line;
-
-    enum class State
+    AsciiGrid grid;
+    if (!load_ascii_grid(path, grid))
     {
-        GetColumn,
-        GetRows,
-        InitMap,
-        SkipMeta,
-        GetData,
-    };
-    auto read_state = State::GetColumn;
+        return HeightMap{1};
+    }
 
-    int rows = 0;
-    int columns = 0;
+    // Cells without data (usually the sea) are set to the lowest point of the map
+    auto is_data = [&](float height) { return height != grid.no_data_value; };
+    auto valid_heights = grid.values | std::views::filter(is_data);
+    auto base_height = valid_heights.empty() ? 0.0f : std::ranges::min(valid_heights);
 
-    while (std::getline(ascii_file, line))
+    // The terrain must be square, so grids that are not are padded out with the base height
+    HeightMap height_map{std::max(grid.columns, grid.rows)};
+    std::ranges::fill(height_map.heights, base_height / scale);
+    for (int y = 0; y < grid.rows; y++)
     {
-        switch (read_state)
-        {
-            case State::GetColumn:
-            {
-                columns = std::stoi(line.substr(line.find_first_of(numbers), line.length() - 1));
-                read_state = State::GetRows;
-                break;
-            }
-
-            case State::GetRows:
-            {
-                rows = std::stoi(line.substr(line.find_first_of(numbers), line.length() - 1));
-                read_state = State::InitMap;
-                break;
-            }
-        }
-
-        if (read_state == State::InitMap)
+        for (int x = 0; x < grid.columns; x++)
         {
-            break;
+            auto height = grid.values[static_cast<std::size_t>(y) * grid.columns + x];
+            height_map.heights[y * height_map.size + x] =
+                (is_data(height) ? height : base_height) / scale;
         }
     }
+    height_map.update_min_max();
+    return height_map;
+}
 
-    assert(rows == columns);
-    HeightMap height_map{rows};
-    read_state = State::SkipMeta;
+std::optional<HeightMap> HeightMap::from_raw(const std::filesystem::path& path,
+                                             float min_height, float max_height)
+{
+    auto extension = path.extension();
+    if (extension != ".r16" && extension != ".r32")
+    {
+        std::cerr << "Unknown raw heightmap format " << path << '\n';
+        return {};
+    }
+    std::size_t sample_size = extension == ".r16" ? 2 : 4;
 
-    int x = 0;
-    int y = 0;
-    while (std::getline(ascii_file, line))
+    std::error_code error;
+    auto file_size = std::filesystem::file_size(path, error);
+    auto size = static_cast<int>(std::sqrt(static_cast<double>(file_size / sample_size)));
+    if (error || size == 0 ||
+        static_cast<std::size_t>(size) * size * sample_size != static_cast<std::size_t>(file_size))
     {
-        switch (read_state)
-        {
-            case State::SkipMeta:
-            {
-                if (line.find_first_of(numbers) == 1)
-                {
-                    read_state = State::GetData;
-                }
-                break;
-            }
+        std::cerr << "Failed to load " << path << ", it is not a square raw heightmap\n";
+        return {};
+    }
 
-            case State::GetData:
-            {
-                if (line[0] == ' ')
-                {
-                    line.erase(0, 1);
-                }
+    HeightMap height_map{size};
+    bool loaded =
+        sample_size == 2
+            ? read_samples<std::uint16_t>(path, height_map.heights, size,
+                                          [&](std::uint16_t value)
+                                          { return from_unorm16(value, min_height, max_height); })
+            : read_samples<std::uint32_t>(path, height_map.heights, size,
+                                          [](std::uint32_t value)
+                                          { return std::bit_cast<float>(value); });
+    if (!loaded)
+    {
+        std::cerr << "Failed to read " << path << '\n';
+        return {};
+    }
+    height_map.update_min_max();
+    return height_map;
+}
 
-                auto heights = split_string(line);
-                for (auto& height : heights)
-                {
-                    height_map.set_height(x, y, std::stof(height) / scale);
-                    x++;
-                }
-                y++;
-                x = 0;
-            }
-        }
+bool HeightMap::save_raw(const std::filesystem::path& path, float min_height,
+                         float max_height) const
+{
+    bool saved = false;
+    if (path.extension() == ".r16")
+    {
+        saved = write_samples<std::uint16_t>(
+            path, heights, size,
+            [&](float height) { return to_unorm16(height, min_height, max_height); });
+    }
+    else if (path.extension() == ".r32")
+    {
+        saved = write_samples<std::uint32_t>(path, heights, size, [](float height)
+                                             { return std::bit_cast<std::uint32_t>(height); });
     }
 
+    if (!saved)
+    {
+        std::cerr << "Failed to save raw heightmap " << path << '\n';
+    }
+    return saved;
+}
 
+bool HeightMap::save_png(const std::filesystem::path& path, float min_height,
+                         float max_height) const
+{
+    std::vector<unsigned char> pixels(heights.size() * 2);
+    for (std::size_t i = 0; i < heights.size(); i++)
+    {
+        auto value = to_unorm16(heights[i], min_height, max_height);
+        pixels[i * 2] = static_cast<unsigned char>(value >> 8);
+        pixels[i * 2 + 1] = static_cast<unsigned char>(value & 0xFF);
+    }
 
-    return height_map;
+    if (auto error = lodepng::encode(path.string(), pixels, size, size, LCT_GREY, 16))
+    {
+        std::cerr << "Failed to save " << path << ": " << lodepng_error_text(error) << '\n';
+        return false;
+    }
+    return true;
 }
 
 bool HeightMap::gui()
@@ -258,6 +799,7 @@ bool HeightMap::gui()
                             [&](auto value)
                             {
                                 noise_gen_.SetFractalType(value);
+                                fractal_type_ = value;
                                 update = true;
                             });
 
@@ -267,12 +809,68 @@ bool HeightMap::gui()
         [&](auto value)
         {
             noise_gen_.SetNoiseType(value);
+            noise_type_ = value;
             update = true;
         },
         3);
     return update;
 }
 
+bool HeightMap::file_gui()
+{
+    static char path[256] = "cache/heightmaps/terrain.r32";
+    static float range[2] = {0.0f, 512.0f};
+    static std::string status;
+    bool imported = false;
+
+    ImGui::Text("Import/Export (.r32, .r16, .png)");
+    ImGui::InputText("Path", path, sizeof(path));
+    ImGui::DragFloat2("16-bit Range", range);
+
+    std::filesystem::path file = path;
+    bool is_png = file.extension() == ".png";
+    if (ImGui::Button("Fit Range"))
+    {
+        range[0] = min_height();
+        range[1] = max_height();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export"))
+    {
+        sf::Clock clock;
+        std::error_code error;
+        std::filesystem::create_directories(file.parent_path(), error);
+
+        bool saved = is_png ? save_png(file, range[0], range[1])
+                            : save_raw(file, range[0], range[1]);
+        status = saved ? "Exported in " +
+                             std::to_string(clock.getElapsedTime().asMilliseconds()) + "ms"
+                       : "Failed to export";
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Import"))
+    {
+        sf::Clock clock;
+        auto loaded = is_png ? std::optional{from_image(file, range[0], range[1])}
+                             : from_raw(file, range[0], range[1]);
+        if (loaded && loaded->size == size)
+        {
+            heights = std::move(loaded->heights);
+            update_min_max();
+            imported = true;
+            status =
+                "Imported in " + std::to_string(clock.getElapsedTime().asMilliseconds()) + "ms";
+        }
+        else
+        {
+            status = "Failed to import, the heightmap must be " + std::to_string(size) + "x" +
+                     std::to_string(size);
+        }
+    }
+    ImGui::Text("%s", status.c_str());
+    return imported;
+}
+
 bool TerrainGenerationOptions::gui(HeightMap& heightmap)
 {
     static int terrain_fill;
@@ -2,6 +2,9 @@
 
 #include <FastNoiseLite/FastNoiseLite.h>
 #include <filesystem>
+#include <glm/glm.hpp>
+#include <optional>
+#include <span>
 #include <vector>
 
 struct HeightMap;
@@ -27,6 +30,13 @@ struct TerrainGenerationOptions
     bool gui(HeightMap& heightmap);
 };
 
+/**
+ * @brief Square grid of heights, one unit apart.
+ *
+ * Alongside the heights is a pyramid of the lowest and highest heights within each quad, each
+ * 2x2 quads, each 4x4 quads and so on up to the whole map. It is kept up to date by set_height,
+ * but must be rebuilt with update_min_max() after writing to the heights directly.
+ */
 struct HeightMap
 {
     std::vector<float> heights;
@@ -38,18 +48,90 @@ struct HeightMap
     float get_height(int x, int z) const;
     void set_height(int x, int z, float height);
 
+    /// Height at the position, interpolated between the four points around it. Positions outside
+    /// of the map are clamped to its edges.
+    float sample(float x, float z) const;
+
+    /// Normal of the interpolated surface at the position, from the slope of the interpolation
+    glm::vec3 sample_normal(float x, float z) const;
+
+    /// Samples each of the (x, z) positions in one go using SIMD, giving the same results as
+    /// sample(). The output must be at least as large as the input.
+    void sample_many(std::span<const glm::vec2> positions, std::span<float> out_heights) const;
+
     float set_base_height();
 
     float min_height() const;
     float max_height() const;
 
-    void generate_terrain(const TerrainGenerationOptions& options);
-
-    static HeightMap from_image(const std::filesystem::path& path);
+    /// Lowest (x) and highest (y) height of the quads from (x, z) to (x + width, z + depth),
+    /// including the points on their far edges
+    glm::vec2 get_min_max(int x, int z, int width, int depth) const;
+
+    /// Rebuilds the min/max pyramid from the heights
+    void update_min_max();
+
+    /**
+     * @brief Finds where the ray first hits the triangles of the terrain mesh, in the height map's
+     * local space.
+     *
+     * Walks down the min/max pyramid nearest first, skipping any cell the ray passes over or
+     * under, so only the quads right next to the ray have their triangles tested.
+     *
+     * @param direction Normalised direction of the ray
+     * @return Distance along the ray to the hit, if there was one within max_distance
+     */
+    std::optional<float> raycast(const glm::vec3& origin, const glm::vec3& direction,
+                                 float max_distance) const;
+
+    /// The offset is the world position of the first point, so height maps generated next to each
+    /// other with the same options line up
+    void generate_terrain(const TerrainGenerationOptions& options, int offset_x = 0,
+                          int offset_z = 0);
+
+    /// True if the noise is OpenSimplex2 with FBm, the only noise the GPU terrain generator has
+    bool uses_default_noise() const;
+
+    /// Maps the darkest to lightest values of the image onto the given range, loading 16-bit
+    /// PNGs at their full precision
+    static HeightMap from_image(const std::filesystem::path& path, float min_height = 0.0f,
+                                float max_height = 255.0f);
     static HeightMap from_ascii(const std::filesystem::path& path, float scale);
 
+    /**
+     * @brief Loads a raw heightmap, which is just rows of little endian samples with the size
+     * worked out from the length of the file.
+     *
+     * .r32 files are 32-bit floats which are loaded as is, and .r16 files are unsigned 16-bit
+     * integers which are mapped onto the given range.
+     */
+    static std::optional<HeightMap> from_raw(const std::filesystem::path& path,
+                                             float min_height = 0.0f, float max_height = 255.0f);
+
+    /// Saves as .r32 or .r16 depending on the extension, with the range only used for .r16
+    bool save_raw(const std::filesystem::path& path, float min_height, float max_height) const;
+
+    /// Saves as a 16-bit greyscale PNG, with the range mapped onto black to white
+    bool save_png(const std::filesystem::path& path, float min_height, float max_height) const;
+
     bool gui();
 
+    /// Import/export of the heights to files, returns true if new heights were imported
+    bool file_gui();
+
   private:
+    /// Lowest (x) and highest (y) height of each cell in one level of the min/max pyramid. Cells
+    /// on level 0 are single quads, and each level up has cells twice as wide.
+    struct MinMaxLevel
+    {
+        int size = 0;
+        std::vector<glm::vec2> cells;
+    };
+
+    void update_min_max_cell(int level, int x, int z);
+
+    std::vector<MinMaxLevel> min_max_levels_;
     FastNoiseLite noise_gen_;
+    FastNoiseLite::NoiseType noise_type_ = FastNoiseLite::NoiseType_OpenSimplex2;
+    FastNoiseLite::FractalType fractal_type_ = FastNoiseLite::FractalType_FBm;
 };
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "MappedFile.h"
+
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    close();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    is_open_ = std::exchange(other.is_open_, false);
+#ifdef _WIN32
+    file_ = std::exchange(other.file_, nullptr);
+    mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::filesystem::path& path)
+{
+    close();
+
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        std::cerr << "Failed to open file for mapping " << path << '\n';
+        return false;
+    }
+    file_ = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        std::cerr << "Failed to read file size " << path << '\n';
+        close();
+        return false;
+    }
+
+    // Empty files cannot be mapped, but are still valid
+    is_open_ = true;
+    if (size.QuadPart == 0)
+    {
+        return true;
+    }
+
+    mapping_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_)
+    {
+        std::cerr << "Failed to create file mapping " << path << '\n';
+        close();
+        return false;
+    }
+
+    data_ = static_cast<const std::byte*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_)
+    {
+        std::cerr << "Failed to map file " << path << '\n';
+        close();
+        return false;
+    }
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data_)
+    {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_)
+    {
+        CloseHandle(mapping_);
+    }
+    if (file_)
+    {
+        CloseHandle(file_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    is_open_ = false;
+    mapping_ = nullptr;
+    file_ = nullptr;
+}
+#else
+bool MappedFile::open(const std::filesystem::path& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        std::cerr << "Failed to open file for mapping " << path << '\n';
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) == -1)
+    {
+        std::cerr << "Failed to read file size " << path << '\n';
+        ::close(fd);
+        return false;
+    }
+
+    // Empty files cannot be mapped, but are still valid
+    size_ = static_cast<std::size_t>(status.st_size);
+    if (size_ == 0)
+    {
+        ::close(fd);
+        is_open_ = true;
+        return true;
+    }
+
+    // The mapping keeps the file alive, so the descriptor is not needed after this
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        std::cerr << "Failed to map file " << path << '\n';
+        size_ = 0;
+        return false;
+    }
+    data_ = static_cast<const std::byte*>(data);
+    is_open_ = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data_)
+    {
+        munmap(const_cast<std::byte*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    is_open_ = false;
+}
+#endif
+
+bool MappedFile::is_open() const
+{
+    return is_open_;
+}
+
+const std::byte* MappedFile::data() const
+{
+    return data_;
+}
+
+std::size_t MappedFile::size() const
+{
+    return size_;
+}
+
+std::span<const std::byte> MappedFile::bytes() const
+{
+    return {data_, size_};
+}
+
+std::span<const std::byte> MappedFile::region(std::size_t offset, std::size_t size) const
+{
+    if (offset > size_ || size > size_ - offset)
+    {
+        return {};
+    }
+    return {data_ + offset, size};
+}
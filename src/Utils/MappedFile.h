@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+/**
+ * @brief Read only view of a file mapped into memory, which is unmapped when destroyed.
+ *
+ * The pages are only read from disk as they are touched, so large files can be opened cheaply
+ * and their contents passed directly to functions that take a pointer without an extra copy.
+ */
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+    ~MappedFile();
+
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    bool is_open() const;
+    const std::byte* data() const;
+    std::size_t size() const;
+    std::span<const std::byte> bytes() const;
+
+    /// Returns the given range of the file, or an empty span if it is out of bounds
+    std::span<const std::byte> region(std::size_t offset, std::size_t size) const;
+
+  private:
+    const std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool is_open_ = false;
+
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
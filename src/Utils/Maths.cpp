@@ -1,5 +1,80 @@
 #include "Maths.h"
 
+#include <algorithm>
+
+void AABB::expand(const glm::vec3& point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+void AABB::expand(const AABB& other)
+{
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+}
+
+bool AABB::is_empty() const
+{
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+glm::vec3 AABB::centre() const
+{
+    return (min + max) * 0.5f;
+}
+
+glm::vec3 AABB::extents() const
+{
+    return (max - min) * 0.5f;
+}
+
+AABB AABB::transformed(const glm::mat4& matrix) const
+{
+    // Arvo's method: transforms the centre, and then the extents by the absolute rotation/scale
+    // which avoids having to transform all 8 corners
+    glm::vec3 new_centre{matrix * glm::vec4{centre(), 1.0f}};
+    glm::vec3 e = extents();
+    glm::vec3 new_extents{0.0f};
+    for (int i = 0; i < 3; i++)
+    {
+        new_extents[i] = std::abs(matrix[0][i]) * e.x + std::abs(matrix[1][i]) * e.y +
+                         std::abs(matrix[2][i]) * e.z;
+    }
+    return {new_centre - new_extents, new_centre + new_extents};
+}
+
+float AABB::surface_area() const
+{
+    glm::vec3 size = max - min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+bool intersect_ray_aabb(const Ray& ray, const AABB& aabb, float max_distance, float& out_distance)
+{
+    float t_min = 0.0f;
+    float t_max = max_distance;
+    for (int i = 0; i < 3; i++)
+    {
+        // Division by 0 results in +/- infinity, which the comparisons below handle correctly
+        float inverse_direction = 1.0f / ray.direction[i];
+        float t0 = (aabb.min[i] - ray.origin[i]) * inverse_direction;
+        float t1 = (aabb.max[i] - ray.origin[i]) * inverse_direction;
+        if (inverse_direction < 0.0f)
+        {
+            std::swap(t0, t1);
+        }
+        t_min = std::max(t0, t_min);
+        t_max = std::min(t1, t_max);
+        if (t_max < t_min)
+        {
+            return false;
+        }
+    }
+    out_distance = t_min;
+    return true;
+}
+
 glm::mat4 create_model_matrix(const Transform& transform)
 {
     glm::mat4 matrix{1.0f};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <limits>
 
 #include <glm/common.hpp>
 #include <glm/glm.hpp>
@@ -18,6 +19,45 @@ struct Transform
     bool usequat = false;
 };
 
+/// Axis aligned bounding box. Default constructed boxes are "empty" so can be grown by expand()
+struct AABB
+{
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+    void expand(const glm::vec3& point);
+    void expand(const AABB& other);
+
+    bool is_empty() const;
+    glm::vec3 centre() const;
+    glm::vec3 extents() const;
+
+    /// Returns the box that encloses this box after being transformed by the given matrix
+    AABB transformed(const glm::mat4& matrix) const;
+
+    float surface_area() const;
+};
+
+struct Ray
+{
+    glm::vec3 origin{0.0f};
+    glm::vec3 direction{0.0f, 0.0f, 1.0f};
+};
+
+struct BoundingSphere
+{
+    glm::vec3 centre{0.0f};
+    float radius = 0.0f;
+};
+
+/**
+ * @brief Slab test of a ray against a box
+ *
+ * @param out_distance Distance along the ray the box is entered (0 if the ray starts inside it)
+ * @return true if the ray hits the box within max_distance
+ */
+bool intersect_ray_aabb(const Ray& ray, const AABB& aabb, float max_distance, float& out_distance);
+
 glm::mat4 create_model_matrix(const Transform& transform);
 glm::vec3 forward_vector(const glm::vec3& rotation);
 glm::vec3 backward_vector(const glm::vec3& rotation);
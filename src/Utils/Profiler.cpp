@@ -30,6 +30,11 @@ ProfilerSection& Profiler::begin_section(const std::string& section)
     return itr->second;
 }
 
+void Profiler::add_time(const std::string& section, sf::Time time)
+{
+    profile_sections_[section].times.push_back(time);
+}
+
 void Profiler::end_frame()
 {
     frame_times_.push_back(frame_time_clock_.restart());
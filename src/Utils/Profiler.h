@@ -35,6 +35,9 @@ class Profiler
 {
   public:
     ProfilerSection& begin_section(const std::string& section);
+
+    /// Adds a time measured elsewhere to the section, such as the time taken on the GPU
+    void add_time(const std::string& section, sf::Time time);
     void end_frame();
 
     void gui();
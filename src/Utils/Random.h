@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Counter based random numbers, where each number is a hash of a key and its index.
+ *
+ * Any number in the sequence can be found without generating the ones before it, so each object
+ * gets the same numbers however many there are and whatever order or thread they are made on.
+ * The hash is SplitMix64's, which gives the same numbers on every platform unlike the std engines
+ * and distributions.
+ */
+class CounterRandom
+{
+  public:
+    /// Streams with the same seed give unrelated numbers, so each use of the seed gets its own
+    constexpr explicit CounterRandom(std::uint64_t seed, std::uint64_t stream = 0)
+        : key_(mix(mix(seed) ^ stream))
+    {
+    }
+
+    /// The number at the index, which does not move the counter
+    constexpr std::uint64_t at(std::uint64_t index) const
+    {
+        return mix(key_ + (index + 1) * 0x9E3779B97F4A7C15);
+    }
+
+    constexpr std::uint64_t next()
+    {
+        return at(counter_++);
+    }
+
+    /// Uniform float in [0, 1)
+    constexpr float next_float()
+    {
+        return static_cast<float>(next() >> 40) / 16777216.0f;
+    }
+
+    /// Uniform int in [0, max), with a tiny bias that does not matter for placing things
+    constexpr int next_int(int max)
+    {
+        return static_cast<int>(next() % static_cast<std::uint64_t>(max));
+    }
+
+  private:
+    static constexpr std::uint64_t mix(std::uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+        return z ^ (z >> 31);
+    }
+
+    std::uint64_t key_;
+    std::uint64_t counter_ = 0;
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+/// SSE2 is always there on x64, and on x86 when MSVC is told to use it. Code using the intrinsics
+/// must have a scalar path for when SPOOKY_USE_SSE is not defined.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPOOKY_USE_SSE
+#include <emmintrin.h>
+#endif
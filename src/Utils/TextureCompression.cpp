@@ -0,0 +1,871 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.h"
+
+namespace
+{
+    /// 4x4 block of RGBA pixels in the range 0-255
+    using Block = std::array<glm::vec4, 16>;
+
+    Block read_block(const std::uint8_t* rgba, int width, int height, int block_x, int block_y)
+    {
+        // Blocks hanging over the edge of the image repeat the edge pixels
+        Block block;
+        for (int y = 0; y < 4; y++)
+        {
+            for (int x = 0; x < 4; x++)
+            {
+                int px = std::min(block_x * 4 + x, width - 1);
+                int py = std::min(block_y * 4 + y, height - 1);
+                const std::uint8_t* pixel = rgba + (static_cast<std::size_t>(py) * width + px) * 4;
+                block[y * 4 + x] = {pixel[0], pixel[1], pixel[2], pixel[3]};
+            }
+        }
+        return block;
+    }
+
+    float distance_squared(const glm::vec4& a, const glm::vec4& b)
+    {
+        auto difference = a - b;
+        return glm::dot(difference, difference);
+    }
+
+    /// Index of the palette entry closest to the pixel
+    template <std::size_t N>
+    int find_nearest(const std::array<glm::vec4, N>& palette, const glm::vec4& pixel,
+                     const glm::vec4& mask)
+    {
+        int nearest = 0;
+        float nearest_distance = std::numeric_limits<float>::max();
+        for (int i = 0; i < static_cast<int>(N); i++)
+        {
+            float distance = distance_squared(palette[i] * mask, pixel * mask);
+            if (distance < nearest_distance)
+            {
+                nearest = i;
+                nearest_distance = distance;
+            }
+        }
+        return nearest;
+    }
+
+    /**
+     * @brief Fits a line through the pixels along their principal axis, and returns the points
+     * where the pixels start and end on that line
+     *
+     * @param mask 1 for each channel that is used, 0 for those that are ignored
+     */
+    std::pair<glm::vec4, glm::vec4> fit_endpoints(const Block& block, const glm::vec4& mask)
+    {
+        glm::vec4 mean{0.0f};
+        for (auto& pixel : block)
+        {
+            mean += pixel * mask;
+        }
+        mean /= 16.0f;
+
+        float covariance[4][4] = {};
+        for (auto& pixel : block)
+        {
+            auto offset = pixel * mask - mean;
+            for (int i = 0; i < 4; i++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    covariance[i][j] += offset[i] * offset[j];
+                }
+            }
+        }
+
+        // Power iteration converges on the eigenvector with the largest eigenvalue
+        glm::vec4 axis = mask;
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            glm::vec4 next{0.0f};
+            for (int i = 0; i < 4; i++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    next[i] += covariance[i][j] * axis[j];
+                }
+            }
+            float length = glm::length(next);
+            if (length < 1e-6f)
+            {
+                break;
+            }
+            axis = next / length;
+        }
+
+        float min_t = std::numeric_limits<float>::max();
+        float max_t = std::numeric_limits<float>::lowest();
+        for (auto& pixel : block)
+        {
+            float t = glm::dot(pixel * mask - mean, axis);
+            min_t = std::min(min_t, t);
+            max_t = std::max(max_t, t);
+        }
+
+        auto clamp = [](const glm::vec4& v)
+        { return glm::clamp(v, glm::vec4{0.0f}, glm::vec4{255.0f}); };
+        return {clamp(mean + axis * min_t), clamp(mean + axis * max_t)};
+    }
+
+    // =============
+    // ==== BC1 ====
+    // =============
+    std::uint16_t to_rgb565(const glm::vec4& colour)
+    {
+        auto quantize = [](float value, int max)
+        { return std::clamp(static_cast<int>(value * max / 255.0f + 0.5f), 0, max); };
+        return static_cast<std::uint16_t>((quantize(colour.r, 31) << 11) |
+                                          (quantize(colour.g, 63) << 5) | quantize(colour.b, 31));
+    }
+
+    glm::vec4 from_rgb565(std::uint16_t colour)
+    {
+        int r = (colour >> 11) & 31;
+        int g = (colour >> 5) & 63;
+        int b = colour & 31;
+        return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255};
+    }
+
+    void compress_bc1(const Block& block, std::uint8_t* out)
+    {
+        const glm::vec4 mask{1.0f, 1.0f, 1.0f, 0.0f};
+        auto [low, high] = fit_endpoints(block, mask);
+
+        // The first colour being larger selects the four colour mode
+        std::uint16_t colour0 = to_rgb565(high);
+        std::uint16_t colour1 = to_rgb565(low);
+        if (colour0 < colour1)
+        {
+            std::swap(colour0, colour1);
+        }
+
+        std::array<glm::vec4, 4> palette;
+        palette[0] = from_rgb565(colour0);
+        palette[1] = from_rgb565(colour1);
+        palette[2] = (palette[0] * 2.0f + palette[1]) / 3.0f;
+        palette[3] = (palette[0] + palette[1] * 2.0f) / 3.0f;
+
+        std::uint32_t indices = 0;
+        if (colour0 != colour1)
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                indices |= static_cast<std::uint32_t>(find_nearest(palette, block[i], mask))
+                           << (i * 2);
+            }
+        }
+
+        out[0] = static_cast<std::uint8_t>(colour0);
+        out[1] = static_cast<std::uint8_t>(colour0 >> 8);
+        out[2] = static_cast<std::uint8_t>(colour1);
+        out[3] = static_cast<std::uint8_t>(colour1 >> 8);
+        for (int i = 0; i < 4; i++)
+        {
+            out[4 + i] = static_cast<std::uint8_t>(indices >> (i * 8));
+        }
+    }
+
+    // =============
+    // ==== BC4 ====
+    // =============
+    /// Compresses a single channel, used for the alpha of BC3 and both channels of BC5
+    void compress_bc4(const Block& block, int channel, std::uint8_t* out)
+    {
+        float lowest = 255.0f;
+        float highest = 0.0f;
+        for (auto& pixel : block)
+        {
+            lowest = std::min(lowest, pixel[channel]);
+            highest = std::max(highest, pixel[channel]);
+        }
+
+        // The first value being larger selects the eight value mode
+        auto value0 = static_cast<std::uint8_t>(highest + 0.5f);
+        auto value1 = static_cast<std::uint8_t>(lowest + 0.5f);
+
+        std::array<glm::vec4, 8> palette;
+        palette[0] = glm::vec4{static_cast<float>(value0)};
+        palette[1] = glm::vec4{static_cast<float>(value1)};
+        for (int i = 2; i < 8; i++)
+        {
+            palette[i] = glm::vec4{((8 - i) * value0 + (i - 1) * value1) / 7.0f};
+        }
+
+        glm::vec4 mask{0.0f};
+        mask[channel] = 1.0f;
+
+        std::uint64_t indices = 0;
+        if (value0 != value1)
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                indices |= static_cast<std::uint64_t>(find_nearest(palette, block[i], mask))
+                           << (i * 3);
+            }
+        }
+
+        out[0] = value0;
+        out[1] = value1;
+        for (int i = 0; i < 6; i++)
+        {
+            out[2 + i] = static_cast<std::uint8_t>(indices >> (i * 8));
+        }
+    }
+
+    // =============
+    // ==== BC7 ====
+    // =============
+    constexpr std::array<int, 16> BC7_WEIGHTS = {0,  4,  9,  13, 17, 21, 26, 30,
+                                                 34, 38, 43, 47, 51, 55, 60, 64};
+
+    /// Writes values into a block starting from the least significant bit
+    class BitWriter
+    {
+      public:
+        BitWriter(std::uint8_t* out)
+            : out_(out)
+        {
+            std::memset(out_, 0, 16);
+        }
+
+        void write(std::uint32_t value, int bits)
+        {
+            for (int i = 0; i < bits; i++, position_++)
+            {
+                auto bit = (value >> i) & 1;
+                out_[position_ / 8] |= static_cast<std::uint8_t>(bit << (position_ % 8));
+            }
+        }
+
+      private:
+        std::uint8_t* out_;
+        int position_ = 0;
+    };
+
+    /// Endpoint quantized to 7 bits per channel, plus a p-bit shared by the channels
+    struct BC7Endpoint
+    {
+        std::array<int, 4> channels{};
+        int p_bit = 0;
+
+        glm::vec4 unquantize() const
+        {
+            glm::vec4 colour;
+            for (int i = 0; i < 4; i++)
+            {
+                colour[i] = static_cast<float>((channels[i] << 1) | p_bit);
+            }
+            return colour;
+        }
+    };
+
+    BC7Endpoint quantize_bc7_endpoint(const glm::vec4& colour)
+    {
+        BC7Endpoint best;
+        float best_error = std::numeric_limits<float>::max();
+        for (int p_bit = 0; p_bit < 2; p_bit++)
+        {
+            BC7Endpoint endpoint;
+            endpoint.p_bit = p_bit;
+            for (int i = 0; i < 4; i++)
+            {
+                endpoint.channels[i] =
+                    std::clamp(static_cast<int>((colour[i] - p_bit) / 2.0f + 0.5f), 0, 127);
+            }
+
+            float error = distance_squared(endpoint.unquantize(), colour);
+            if (error < best_error)
+            {
+                best = endpoint;
+                best_error = error;
+            }
+        }
+        return best;
+    }
+
+    /// Only mode 6 is used, which has a single subset and a 4-bit index for each pixel
+    void compress_bc7(const Block& block, std::uint8_t* out)
+    {
+        const glm::vec4 mask{1.0f};
+        auto [low, high] = fit_endpoints(block, mask);
+        std::array<BC7Endpoint, 2> endpoints = {quantize_bc7_endpoint(low),
+                                                quantize_bc7_endpoint(high)};
+
+        auto build_palette = [&]()
+        {
+            auto e0 = endpoints[0].unquantize();
+            auto e1 = endpoints[1].unquantize();
+            std::array<glm::vec4, 16> palette;
+            for (int i = 0; i < 16; i++)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    int weight = BC7_WEIGHTS[i];
+                    int a = static_cast<int>(e0[c]);
+                    int b = static_cast<int>(e1[c]);
+                    palette[i][c] = static_cast<float>(((64 - weight) * a + weight * b + 32) >> 6);
+                }
+            }
+            return palette;
+        };
+
+        auto palette = build_palette();
+        std::array<int, 16> indices;
+        for (int i = 0; i < 16; i++)
+        {
+            indices[i] = find_nearest(palette, block[i], mask);
+        }
+
+        // The most significant bit of the first index is implied to be 0, so the endpoints are
+        // swapped if it would be set
+        if (indices[0] >= 8)
+        {
+            std::swap(endpoints[0], endpoints[1]);
+            for (auto& index : indices)
+            {
+                index = 15 - index;
+            }
+        }
+
+        BitWriter writer(out);
+        writer.write(1 << 6, 7);
+        for (int c = 0; c < 4; c++)
+        {
+            writer.write(endpoints[0].channels[c], 7);
+            writer.write(endpoints[1].channels[c], 7);
+        }
+        writer.write(endpoints[0].p_bit, 1);
+        writer.write(endpoints[1].p_bit, 1);
+        for (int i = 0; i < 16; i++)
+        {
+            writer.write(indices[i], i == 0 ? 3 : 4);
+        }
+    }
+
+    // ==================
+    // ==== Decoding ====
+    // ==================
+    // Integer arithmetic as described by the format specifications, independent of the encoder
+    using DecodedBlock = std::array<std::array<std::uint8_t, 4>, 16>;
+
+    /// BC2/BC3 colour blocks always use the four colour mode, BC1 picks it by the endpoint order
+    void decode_bc1(const std::uint8_t* in, DecodedBlock& out, bool always_four_colours)
+    {
+        auto colour0 = static_cast<std::uint16_t>(in[0] | (in[1] << 8));
+        auto colour1 = static_cast<std::uint16_t>(in[2] | (in[3] << 8));
+        auto expand = [](std::uint16_t colour)
+        {
+            int r = (colour >> 11) & 31;
+            int g = (colour >> 5) & 63;
+            int b = colour & 31;
+            return std::array<int, 4>{(r << 3) | (r >> 2), (g << 2) | (g >> 4),
+                                      (b << 3) | (b >> 2), 255};
+        };
+
+        std::array<std::array<int, 4>, 4> palette;
+        palette[0] = expand(colour0);
+        palette[1] = expand(colour1);
+        bool four_colours = always_four_colours || colour0 > colour1;
+        for (int c = 0; c < 3; c++)
+        {
+            int a = palette[0][c];
+            int b = palette[1][c];
+            palette[2][c] = four_colours ? (2 * a + b) / 3 : (a + b) / 2;
+            palette[3][c] = four_colours ? (a + 2 * b) / 3 : 0;
+        }
+        palette[2][3] = 255;
+        palette[3][3] = four_colours ? 255 : 0;
+
+        std::uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) |
+                                (static_cast<std::uint32_t>(in[7]) << 24);
+        for (int i = 0; i < 16; i++)
+        {
+            auto& colour = palette[(indices >> (i * 2)) & 3];
+            for (int c = 0; c < 4; c++)
+            {
+                out[i][c] = static_cast<std::uint8_t>(colour[c]);
+            }
+        }
+    }
+
+    void decode_bc4(const std::uint8_t* in, DecodedBlock& out, int channel)
+    {
+        std::array<int, 8> palette;
+        palette[0] = in[0];
+        palette[1] = in[1];
+        if (palette[0] > palette[1])
+        {
+            for (int i = 1; i <= 6; i++)
+            {
+                palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+            }
+        }
+        else
+        {
+            for (int i = 1; i <= 4; i++)
+            {
+                palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        std::uint64_t indices = 0;
+        for (int i = 0; i < 6; i++)
+        {
+            indices |= static_cast<std::uint64_t>(in[2 + i]) << (i * 8);
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            out[i][channel] = static_cast<std::uint8_t>(palette[(indices >> (i * 3)) & 7]);
+        }
+    }
+
+    bool decode_bc7(const std::uint8_t* in, DecodedBlock& out)
+    {
+        int position = 0;
+        auto read = [&](int bits)
+        {
+            int value = 0;
+            for (int i = 0; i < bits; i++, position++)
+            {
+                value |= ((in[position / 8] >> (position % 8)) & 1) << i;
+            }
+            return value;
+        };
+
+        // The mode is the number of 0 bits before the first 1
+        int mode = 0;
+        while (mode < 8 && read(1) == 0)
+        {
+            mode++;
+        }
+        if (mode != 6)
+        {
+            return false;
+        }
+
+        std::array<std::array<int, 4>, 2> endpoints;
+        for (int c = 0; c < 4; c++)
+        {
+            endpoints[0][c] = read(7);
+            endpoints[1][c] = read(7);
+        }
+        for (auto& endpoint : endpoints)
+        {
+            int p_bit = read(1);
+            for (auto& channel : endpoint)
+            {
+                channel = (channel << 1) | p_bit;
+            }
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            int weight = BC7_WEIGHTS[read(i == 0 ? 3 : 4)];
+            for (int c = 0; c < 4; c++)
+            {
+                out[i][c] = static_cast<std::uint8_t>(
+                    ((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+            }
+        }
+        return true;
+    }
+
+    // =============
+    // ==== Mips ====
+    // =============
+    std::vector<std::uint8_t> downsample(const std::vector<std::uint8_t>& rgba, int width,
+                                         int height, int new_width, int new_height)
+    {
+        std::vector<std::uint8_t> result(static_cast<std::size_t>(new_width) * new_height * 4);
+        for (int y = 0; y < new_height; y++)
+        {
+            int y0 = std::min(y * 2, height - 1);
+            int y1 = std::min(y * 2 + 1, height - 1);
+            for (int x = 0; x < new_width; x++)
+            {
+                int x0 = std::min(x * 2, width - 1);
+                int x1 = std::min(x * 2 + 1, width - 1);
+                for (int c = 0; c < 4; c++)
+                {
+                    auto sample = [&](int sx, int sy)
+                    { return rgba[(static_cast<std::size_t>(sy) * width + sx) * 4 + c]; };
+                    int sum = sample(x0, y0) + sample(x1, y0) + sample(x0, y1) + sample(x1, y1);
+                    result[(static_cast<std::size_t>(y) * new_width + x) * 4 + c] =
+                        static_cast<std::uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+        return result;
+    }
+
+    // =============
+    // ==== DDS ====
+    // =============
+    constexpr std::uint32_t make_four_cc(char a, char b, char c, char d)
+    {
+        return static_cast<std::uint32_t>(a) | (static_cast<std::uint32_t>(b) << 8) |
+               (static_cast<std::uint32_t>(c) << 16) | (static_cast<std::uint32_t>(d) << 24);
+    }
+
+    constexpr std::uint32_t DDS_MAGIC = make_four_cc('D', 'D', 'S', ' ');
+
+    constexpr std::uint32_t DDSD_CAPS = 0x1;
+    constexpr std::uint32_t DDSD_HEIGHT = 0x2;
+    constexpr std::uint32_t DDSD_WIDTH = 0x4;
+    constexpr std::uint32_t DDSD_PIXELFORMAT = 0x1000;
+    constexpr std::uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+    constexpr std::uint32_t DDSD_LINEARSIZE = 0x80000;
+    constexpr std::uint32_t DDPF_FOURCC = 0x4;
+    constexpr std::uint32_t DDSCAPS_COMPLEX = 0x8;
+    constexpr std::uint32_t DDSCAPS_TEXTURE = 0x1000;
+    constexpr std::uint32_t DDSCAPS_MIPMAP = 0x400000;
+    constexpr std::uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+    struct DDSPixelFormat
+    {
+        std::uint32_t size = sizeof(DDSPixelFormat);
+        std::uint32_t flags = 0;
+        std::uint32_t four_cc = 0;
+        std::uint32_t rgb_bit_count = 0;
+        std::uint32_t r_mask = 0;
+        std::uint32_t g_mask = 0;
+        std::uint32_t b_mask = 0;
+        std::uint32_t a_mask = 0;
+    };
+
+    struct DDSHeader
+    {
+        std::uint32_t size = sizeof(DDSHeader);
+        std::uint32_t flags = 0;
+        std::uint32_t height = 0;
+        std::uint32_t width = 0;
+        std::uint32_t pitch_or_linear_size = 0;
+        std::uint32_t depth = 0;
+        std::uint32_t mip_map_count = 0;
+        std::uint32_t reserved1[11] = {};
+        DDSPixelFormat pixel_format;
+        std::uint32_t caps = 0;
+        std::uint32_t caps2 = 0;
+        std::uint32_t caps3 = 0;
+        std::uint32_t caps4 = 0;
+        std::uint32_t reserved2 = 0;
+    };
+
+    struct DDSHeaderDX10
+    {
+        std::uint32_t dxgi_format = 0;
+        std::uint32_t resource_dimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+        std::uint32_t misc_flag = 0;
+        std::uint32_t array_size = 1;
+        std::uint32_t misc_flags2 = 0;
+    };
+
+    static_assert(sizeof(DDSHeader) == 124);
+    static_assert(sizeof(DDSHeaderDX10) == 20);
+
+    struct FormatCodes
+    {
+        BlockFormat format;
+        std::uint32_t dxgi_format;
+        std::uint32_t four_cc;
+    };
+
+    constexpr std::array<FormatCodes, 4> FORMAT_CODES = {{
+        {BlockFormat::BC1, 71, make_four_cc('D', 'X', 'T', '1')},
+        {BlockFormat::BC3, 77, make_four_cc('D', 'X', 'T', '5')},
+        {BlockFormat::BC5, 83, make_four_cc('A', 'T', 'I', '2')},
+        {BlockFormat::BC7, 98, 0},
+    }};
+} // namespace
+
+int get_block_size(BlockFormat format)
+{
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+std::size_t get_compressed_size(BlockFormat format, int width, int height)
+{
+    std::size_t blocks_x = (std::max(width, 1) + 3) / 4;
+    std::size_t blocks_y = (std::max(height, 1) + 3) / 4;
+    return blocks_x * blocks_y * get_block_size(format);
+}
+
+BlockFormat choose_block_format(const std::uint8_t* rgba, int width, int height)
+{
+    std::size_t pixels = static_cast<std::size_t>(width) * height;
+    for (std::size_t i = 0; i < pixels; i++)
+    {
+        if (rgba[i * 4 + 3] != 255)
+        {
+            return BlockFormat::BC7;
+        }
+    }
+    return BlockFormat::BC1;
+}
+
+std::vector<std::uint8_t> compress_image(const std::uint8_t* rgba, int width, int height,
+                                         BlockFormat format)
+{
+    std::vector<std::uint8_t> compressed(get_compressed_size(format, width, height));
+    int blocks_x = (width + 3) / 4;
+    int blocks_y = (height + 3) / 4;
+    int block_size = get_block_size(format);
+
+    std::uint8_t* out = compressed.data();
+    for (int by = 0; by < blocks_y; by++)
+    {
+        for (int bx = 0; bx < blocks_x; bx++)
+        {
+            auto block = read_block(rgba, width, height, bx, by);
+            switch (format)
+            {
+                case BlockFormat::BC1:
+                    compress_bc1(block, out);
+                    break;
+
+                case BlockFormat::BC3:
+                    compress_bc4(block, 3, out);
+                    compress_bc1(block, out + 8);
+                    break;
+
+                case BlockFormat::BC5:
+                    compress_bc4(block, 0, out);
+                    compress_bc4(block, 1, out + 8);
+                    break;
+
+                case BlockFormat::BC7:
+                    compress_bc7(block, out);
+                    break;
+            }
+            out += block_size;
+        }
+    }
+    return compressed;
+}
+
+bool decompress_image(std::span<const std::uint8_t> data, int width, int height,
+                      BlockFormat format, std::vector<std::uint8_t>& out_rgba)
+{
+    if (data.size() < get_compressed_size(format, width, height))
+    {
+        return false;
+    }
+    out_rgba.assign(static_cast<std::size_t>(width) * height * 4, 0);
+
+    int blocks_x = (width + 3) / 4;
+    int blocks_y = (height + 3) / 4;
+    int block_size = get_block_size(format);
+
+    const std::uint8_t* in = data.data();
+    for (int by = 0; by < blocks_y; by++)
+    {
+        for (int bx = 0; bx < blocks_x; bx++)
+        {
+            DecodedBlock block{};
+            switch (format)
+            {
+                case BlockFormat::BC1:
+                    decode_bc1(in, block, false);
+                    break;
+
+                case BlockFormat::BC3:
+                    decode_bc1(in + 8, block, true);
+                    decode_bc4(in, block, 3);
+                    break;
+
+                case BlockFormat::BC5:
+                    decode_bc4(in, block, 0);
+                    decode_bc4(in + 8, block, 1);
+                    for (auto& pixel : block)
+                    {
+                        pixel[3] = 255;
+                    }
+                    break;
+
+                case BlockFormat::BC7:
+                    if (!decode_bc7(in, block))
+                    {
+                        return false;
+                    }
+                    break;
+            }
+            in += block_size;
+
+            // Pixels of edge blocks that hang over the image are dropped
+            for (int i = 0; i < 16; i++)
+            {
+                int x = bx * 4 + i % 4;
+                int y = by * 4 + i / 4;
+                if (x < width && y < height)
+                {
+                    std::memcpy(&out_rgba[(static_cast<std::size_t>(y) * width + x) * 4],
+                                block[i].data(), 4);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+CompressedTexture compress_texture(const std::uint8_t* rgba, int width, int height,
+                                   BlockFormat format, int max_levels)
+{
+    CompressedTexture texture;
+    texture.format = format;
+
+    std::vector<std::uint8_t> level(rgba, rgba + static_cast<std::size_t>(width) * height * 4);
+    while (static_cast<int>(texture.mips.size()) < max_levels)
+    {
+        auto data = compress_image(level.data(), width, height, format);
+        texture.mips.push_back({width, height, std::move(data)});
+        if (width == 1 && height == 1)
+        {
+            break;
+        }
+
+        int new_width = std::max(width / 2, 1);
+        int new_height = std::max(height / 2, 1);
+        level = downsample(level, width, height, new_width, new_height);
+        width = new_width;
+        height = new_height;
+    }
+    return texture;
+}
+
+bool parse_dds(std::span<const std::byte> bytes, CompressedTexture& out_texture)
+{
+    std::size_t offset = 0;
+    auto read = [&](void* out, std::size_t size)
+    {
+        if (offset + size > bytes.size())
+        {
+            return false;
+        }
+        std::memcpy(out, bytes.data() + offset, size);
+        offset += size;
+        return true;
+    };
+
+    std::uint32_t magic = 0;
+    DDSHeader header;
+    if (!read(&magic, sizeof(magic)) || magic != DDS_MAGIC || !read(&header, sizeof(header)) ||
+        header.size != sizeof(DDSHeader) || header.width == 0 || header.height == 0)
+    {
+        return false;
+    }
+
+    const FormatCodes* codes = nullptr;
+    if (header.pixel_format.four_cc == make_four_cc('D', 'X', '1', '0'))
+    {
+        DDSHeaderDX10 header_dx10;
+        if (!read(&header_dx10, sizeof(header_dx10)))
+        {
+            return false;
+        }
+        for (auto& c : FORMAT_CODES)
+        {
+            codes = c.dxgi_format == header_dx10.dxgi_format ? &c : codes;
+        }
+    }
+    else
+    {
+        for (auto& c : FORMAT_CODES)
+        {
+            codes = c.four_cc == header.pixel_format.four_cc ? &c : codes;
+        }
+        if (header.pixel_format.four_cc == make_four_cc('B', 'C', '5', 'U'))
+        {
+            codes = &FORMAT_CODES[2];
+        }
+    }
+    if (!codes)
+    {
+        return false;
+    }
+
+    out_texture.format = codes->format;
+    out_texture.mips.clear();
+
+    int width = static_cast<int>(header.width);
+    int height = static_cast<int>(header.height);
+    std::uint32_t mip_count =
+        (header.flags & DDSD_MIPMAPCOUNT) ? std::max(header.mip_map_count, 1u) : 1u;
+    for (std::uint32_t i = 0; i < mip_count; i++)
+    {
+        auto& mip = out_texture.mips.emplace_back();
+        mip.width = width;
+        mip.height = height;
+        mip.data.resize(get_compressed_size(codes->format, width, height));
+        if (!read(mip.data.data(), mip.data.size()))
+        {
+            return false;
+        }
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    return true;
+}
+
+bool load_dds(const std::filesystem::path& path, CompressedTexture& out_texture)
+{
+    MappedFile file;
+    return file.open(path) && parse_dds(file.bytes(), out_texture);
+}
+
+bool save_dds(const std::filesystem::path& path, const CompressedTexture& texture)
+{
+    if (texture.mips.empty())
+    {
+        return false;
+    }
+
+    auto& base = texture.mips.front();
+    DDSHeader header;
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT |
+                   DDSD_LINEARSIZE;
+    header.width = static_cast<std::uint32_t>(base.width);
+    header.height = static_cast<std::uint32_t>(base.height);
+    header.pitch_or_linear_size = static_cast<std::uint32_t>(base.data.size());
+    header.mip_map_count = static_cast<std::uint32_t>(texture.mips.size());
+    header.pixel_format.flags = DDPF_FOURCC;
+    header.pixel_format.four_cc = make_four_cc('D', 'X', '1', '0');
+    header.caps = DDSCAPS_TEXTURE;
+    if (texture.mips.size() > 1)
+    {
+        header.caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+    }
+
+    DDSHeaderDX10 header_dx10;
+    for (auto& codes : FORMAT_CODES)
+    {
+        if (codes.format == texture.format)
+        {
+            header_dx10.dxgi_format = codes.dxgi_format;
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&header_dx10), sizeof(header_dx10));
+    for (auto& mip : texture.mips)
+    {
+        file.write(reinterpret_cast<const char*>(mip.data.data()), mip.data.size());
+    }
+    return file.good();
+}
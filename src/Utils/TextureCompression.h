@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+/// Block compressed formats, each compressing 4x4 pixel blocks
+enum class BlockFormat
+{
+    BC1, // RGB, 8 bytes per block
+    BC3, // RGBA, 16 bytes per block
+    BC5, // RG, 16 bytes per block, used for normal maps
+    BC7, // RGBA, 16 bytes per block, higher quality than BC1/BC3
+};
+
+struct CompressedMip
+{
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> data;
+};
+
+/// A block compressed texture with its mip chain, which does not depend on OpenGL
+struct CompressedTexture
+{
+    BlockFormat format = BlockFormat::BC1;
+    std::vector<CompressedMip> mips;
+};
+
+int get_block_size(BlockFormat format);
+
+/// Size in bytes of a single compressed image, blocks on the edges are padded to 4x4
+std::size_t get_compressed_size(BlockFormat format, int width, int height);
+
+/// BC1 if every pixel is opaque, BC7 otherwise
+BlockFormat choose_block_format(const std::uint8_t* rgba, int width, int height);
+
+/// Compresses a single RGBA8 image
+std::vector<std::uint8_t> compress_image(const std::uint8_t* rgba, int width, int height,
+                                         BlockFormat format);
+
+/**
+ * @brief Decodes a single image back to RGBA8. This follows the format specifications rather than
+ * sharing any code with the encoder, so it can be used to check the encoder. BC5 decodes to red
+ * and green, with blue 0 and alpha 255.
+ *
+ * @return False if the data is too small, or a BC7 block uses a mode other than 6, which is the
+ * only mode the encoder writes
+ */
+bool decompress_image(std::span<const std::uint8_t> data, int width, int height,
+                      BlockFormat format, std::vector<std::uint8_t>& out_rgba);
+
+/**
+ * @brief Generates the mip chain of the RGBA8 image with a box filter, and compresses each level
+ *
+ * @param max_levels Maximum number of mips, including the full size image
+ */
+CompressedTexture compress_texture(const std::uint8_t* rgba, int width, int height,
+                                   BlockFormat format, int max_levels);
+
+/// Reads a DDS file, accepting both the DX10 header and the legacy DXT1/DXT5/ATI2 four CCs
+bool parse_dds(std::span<const std::byte> bytes, CompressedTexture& out_texture);
+bool load_dds(const std::filesystem::path& path, CompressedTexture& out_texture);
+
+/// Writes the texture as a DDS file using the DX10 header
+bool save_dds(const std::filesystem::path& path, const CompressedTexture& texture);
@@ -0,0 +1,49 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned thread_count)
+{
+    if (thread_count == 0)
+    {
+        thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    for (unsigned i = 0; i < thread_count; i++)
+    {
+        workers_.emplace_back([this](std::stop_token stop_token) { worker_loop(stop_token); });
+    }
+}
+
+void ThreadPool::enqueue(Task task)
+{
+    {
+        std::lock_guard lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    condition_.notify_one();
+}
+
+std::size_t ThreadPool::size() const
+{
+    return workers_.size();
+}
+
+void ThreadPool::worker_loop(std::stop_token stop_token)
+{
+    while (true)
+    {
+        Task task;
+        {
+            std::unique_lock lock(mutex_);
+            condition_.wait(lock, stop_token, [&] { return !tasks_.empty(); });
+            if (stop_token.stop_requested())
+            {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed set of worker threads that run tasks in the order they were enqueued.
+ *
+ * Tasks that have not started when the pool is destroyed are discarded, so anything they
+ * reference only needs to outlive the pool.
+ */
+class ThreadPool
+{
+  public:
+    using Task = std::move_only_function<void()>;
+
+    /// @param thread_count Number of workers, 0 picks one less than the hardware thread count
+    explicit ThreadPool(unsigned thread_count = 0);
+
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    void enqueue(Task task);
+
+    std::size_t size() const;
+
+  private:
+    void worker_loop(std::stop_token stop_token);
+
+    std::mutex mutex_;
+    std::condition_variable_any condition_;
+    std::deque<Task> tasks_;
+
+    // Declared last so the workers are joined before the queue is destroyed
+    std::vector<std::jthread> workers_;
+};
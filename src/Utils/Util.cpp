@@ -20,6 +20,18 @@ std::string read_file_to_string(const std::filesystem::path& file_path)
     return content;
 }
 
+std::uint64_t hash_bytes(const void* data, std::size_t size, std::uint64_t seed)
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t hash = seed;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
 std::vector<std::string> split_string(const std::string& string, char delim)
 {
     std::vector<std::string> tokens;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <iostream>
 #include <string_view>
@@ -15,6 +16,10 @@ namespace fs = std::filesystem;
 std::string read_file_to_string(const std::filesystem::path& file_path);
 std::vector<std::string> split_string(const std::string& string, char delim = ' ');
 
+/// 64-bit FNV-1a hash of the bytes. Pass a previous hash as the seed to combine hashes.
+std::uint64_t hash_bytes(const void* data, std::size_t size,
+                         std::uint64_t seed = 14695981039346656037ull);
+
 template <typename N, typename T>
 sf::Vector2<N> cast_vector(const sf::Vector2<T>& vec)
 {
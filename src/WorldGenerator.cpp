@@ -0,0 +1,310 @@
+#include "WorldGenerator.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "Utils/MappedFile.h"
+#include "Utils/Random.h"
+#include "Utils/Util.h"
+
+namespace
+{
+    // Cached worlds are a header, followed by the heights, the people's positions and the
+    // collision BVH
+    constexpr std::uint32_t WORLD_MAGIC = 0x44575342; // "SBWD"
+
+    // Must be incremented when the layout or anything about how worlds are generated changes
+    constexpr std::uint32_t WORLD_VERSION = 2;
+
+    const std::filesystem::path WORLD_CACHE_DIRECTORY = "cache/worlds";
+
+    struct WorldHeader
+    {
+        std::uint32_t magic = WORLD_MAGIC;
+        std::uint32_t version = WORLD_VERSION;
+        std::uint64_t key = 0;
+        std::uint64_t content_hash = 0;
+        std::uint64_t collision_hash = 0;
+        std::int32_t size = 0;
+        std::uint32_t people_count = 0;
+        std::uint32_t collision_bvh_size = 0;
+        float water_height = 0.0f;
+    };
+
+    std::uint64_t hash_world_content(const WorldSnapshot& world)
+    {
+        auto& heights = world.height_map.heights;
+        auto hash = hash_bytes(heights.data(), heights.size() * sizeof(float));
+        return hash_bytes(world.people_positions.data(),
+                          world.people_positions.size() * sizeof(glm::vec3), hash);
+    }
+
+    std::uint64_t hash_collision_bvh(const WorldSnapshot& world)
+    {
+        return hash_bytes(world.collision_bvh.data(), world.collision_bvh_size);
+    }
+
+    std::optional<WorldSnapshot> load_world(const std::filesystem::path& path,
+                                            const WorldOptions& options, std::uint64_t key)
+    {
+        MappedFile file;
+        if (!std::filesystem::exists(path) || !file.open(path))
+        {
+            return {};
+        }
+
+        WorldHeader header;
+        auto header_bytes = file.region(0, sizeof(header));
+        if (header_bytes.empty())
+        {
+            return {};
+        }
+        std::memcpy(&header, header_bytes.data(), sizeof(header));
+        if (header.magic != WORLD_MAGIC || header.version != WORLD_VERSION || header.key != key ||
+            header.size != options.size ||
+            header.people_count != static_cast<std::uint32_t>(options.people_count))
+        {
+            return {};
+        }
+
+        auto heights_size = sizeof(float) * header.size * header.size;
+        auto people_size = sizeof(glm::vec3) * header.people_count;
+        auto heights = file.region(sizeof(header), heights_size);
+        auto people = file.region(sizeof(header) + heights_size, people_size);
+        auto bvh =
+            file.region(sizeof(header) + heights_size + people_size, header.collision_bvh_size);
+        if (heights.size() != heights_size || people.size() != people_size ||
+            bvh.size() != header.collision_bvh_size)
+        {
+            return {};
+        }
+
+        WorldSnapshot world{header.size};
+        std::memcpy(world.height_map.heights.data(), heights.data(), heights.size());
+        world.height_map.update_min_max();
+
+        world.people_positions.resize(header.people_count);
+        std::memcpy(world.people_positions.data(), people.data(), people.size());
+
+        world.collision_bvh.resize((bvh.size() + sizeof(WorldSnapshot::BvhBlock) - 1) /
+                                   sizeof(WorldSnapshot::BvhBlock));
+        world.collision_bvh_size = header.collision_bvh_size;
+        std::memcpy(world.collision_bvh.data(), bvh.data(), bvh.size());
+
+        if (hash_world_content(world) != header.content_hash ||
+            hash_collision_bvh(world) != header.collision_hash)
+        {
+            std::cerr << "Cached world " << path << " is damaged, generating it again\n";
+            return {};
+        }
+
+        world.water_height = header.water_height;
+        world.key = key;
+        world.content_hash = header.content_hash;
+        world.loaded_from_cache = true;
+        return world;
+    }
+
+    void save_world(const WorldSnapshot& world, const std::filesystem::path& path)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+
+        WorldHeader header;
+        header.key = world.key;
+        header.content_hash = world.content_hash;
+        header.collision_hash = hash_collision_bvh(world);
+        header.size = world.height_map.size;
+        header.people_count = static_cast<std::uint32_t>(world.people_positions.size());
+        header.collision_bvh_size = world.collision_bvh_size;
+        header.water_height = world.water_height;
+
+        // Written to a temporary file first so a crash or another instance never leaves a partly
+        // written world in the cache
+        auto temporary_path = path;
+        temporary_path += ".tmp";
+        {
+            std::ofstream file(temporary_path, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(world.height_map.heights.data()),
+                       world.height_map.heights.size() * sizeof(float));
+            file.write(reinterpret_cast<const char*>(world.people_positions.data()),
+                       world.people_positions.size() * sizeof(glm::vec3));
+            file.write(reinterpret_cast<const char*>(world.collision_bvh.data()),
+                       world.collision_bvh_size);
+            if (!file)
+            {
+                std::cerr << "Failed to write cached world " << path << '\n';
+                return;
+            }
+        }
+        std::filesystem::rename(temporary_path, path, error);
+    }
+} // namespace
+
+WorldSnapshot::WorldSnapshot(int size)
+    : height_map(size)
+{
+}
+
+void WorldSnapshot::replace(WorldSnapshot&& other)
+{
+    height_map.heights = std::move(other.height_map.heights);
+    height_map.update_min_max();
+    people_positions = std::move(other.people_positions);
+    water_height = other.water_height;
+    collision_bvh = std::move(other.collision_bvh);
+    collision_bvh_size = other.collision_bvh_size;
+    key = other.key;
+    content_hash = other.content_hash;
+    loaded_from_cache = other.loaded_from_cache;
+}
+
+std::uint64_t hash_world_options(const WorldOptions& options)
+{
+    // Each field is hashed on its own, as the padding between them could be anything
+    auto hash = hash_bytes(&WORLD_VERSION, sizeof(WORLD_VERSION));
+    auto add = [&](const auto& value) { hash = hash_bytes(&value, sizeof(value), hash); };
+
+    add(options.size);
+    add(options.people_count);
+
+    auto& terrain = options.terrain;
+    add(terrain.frequency);
+    add(terrain.amplitude);
+    add(terrain.lacunarity);
+    add(terrain.octaves);
+    add(terrain.amplitude_dampen);
+    add(terrain.water_level);
+    add(terrain.seed);
+    add(terrain.water_level_damper);
+    add(terrain.generate_island);
+    add(terrain.bump_power);
+
+    add(options.erosion.has_value());
+    if (auto& erosion = options.erosion)
+    {
+        add(erosion->seed);
+        add(erosion->droplet_density);
+        add(erosion->max_lifetime);
+        add(erosion->inertia);
+        add(erosion->sediment_capacity);
+        add(erosion->min_sediment_capacity);
+        add(erosion->erode_speed);
+        add(erosion->deposit_speed);
+        add(erosion->evaporate_speed);
+        add(erosion->gravity);
+        add(erosion->thermal_iterations);
+        add(erosion->talus);
+        add(erosion->thermal_rate);
+    }
+    return hash;
+}
+
+glm::vec3 get_point_light_position(const WorldOptions& options, const HeightMap& height_map,
+                                   int index)
+{
+    CounterRandom random{static_cast<std::uint64_t>(options.terrain.seed),
+                         static_cast<std::uint64_t>(WorldStream::PointLights)};
+    auto x = static_cast<float>(random.at(index * 2ull) % (height_map.size - 2) + 1);
+    auto z = static_cast<float>(random.at(index * 2ull + 1) % (height_map.size - 2) + 1);
+    return {x, height_map.sample(x, z), z};
+}
+
+WorldSnapshot generate_world(const WorldOptions& options)
+{
+    WorldSnapshot world{options.size};
+    world.key = hash_world_options(options);
+
+    auto& height_map = world.height_map;
+    height_map.generate_terrain(options.terrain);
+    world.water_height = options.terrain.water_level - height_map.set_base_height();
+    if (options.erosion)
+    {
+        TerrainEroder eroder;
+        eroder.start(height_map.size, *options.erosion);
+        eroder.finish(height_map);
+    }
+
+    // People stand on whole points away from the edges
+    CounterRandom random{static_cast<std::uint64_t>(options.terrain.seed),
+                         static_cast<std::uint64_t>(WorldStream::People)};
+    std::vector<glm::vec2> positions(options.people_count);
+    for (auto& position : positions)
+    {
+        position.x = static_cast<float>(random.next_int(height_map.size - 2) + 1);
+        position.y = static_cast<float>(random.next_int(height_map.size - 2) + 1);
+    }
+    std::vector<float> heights(positions.size());
+    height_map.sample_many(positions, heights);
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        world.people_positions.push_back({positions[i].x, heights[i], positions[i].y});
+    }
+
+    // The collision mesh has the same triangles as the terrain mesh, so the BVH built here
+    // matches the one the terrain mesh would build
+    std::vector<BasicVertex> vertices;
+    std::vector<GLuint> indices;
+    generate_terrain_vertices(height_map, vertices);
+    generate_terrain_indices(height_map.size, indices);
+
+    btTriangleMesh collision_mesh;
+    add_terrain_collision_triangles(vertices, indices, collision_mesh);
+    btBvhTriangleMeshShape shape{&collision_mesh, true, true};
+
+    auto bvh = shape.getOptimizedBvh();
+    world.collision_bvh_size = bvh->calculateSerializeBufferSize();
+    world.collision_bvh.resize((world.collision_bvh_size + sizeof(WorldSnapshot::BvhBlock) - 1) /
+                               sizeof(WorldSnapshot::BvhBlock));
+    bvh->serializeInPlace(world.collision_bvh.data(), world.collision_bvh_size, false);
+
+    world.content_hash = hash_world_content(world);
+    return world;
+}
+
+WorldSnapshot load_or_generate_world(const WorldOptions& options)
+{
+    auto key = hash_world_options(options);
+    auto path = WORLD_CACHE_DIRECTORY / ("world_" + std::to_string(key) + ".world");
+    if (auto world = load_world(path, options, key))
+    {
+        return std::move(*world);
+    }
+
+    auto world = generate_world(options);
+    save_world(world, path);
+    return world;
+}
+
+void add_terrain_collision_triangles(std::span<const BasicVertex> vertices,
+                                     std::span<const GLuint> indices,
+                                     btTriangleMesh& collision_mesh)
+{
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        collision_mesh.addTriangle(to_btvec3(vertices[indices[i]].position),
+                                   to_btvec3(vertices[indices[i + 1]].position),
+                                   to_btvec3(vertices[indices[i + 2]].position));
+    }
+}
+
+std::unique_ptr<btBvhTriangleMeshShape> create_terrain_collision_shape(
+    WorldSnapshot& world, btTriangleMesh& collision_mesh)
+{
+    // The BVH is used straight from the world's memory rather than being built again
+    auto bvh = world.collision_bvh.empty()
+                   ? nullptr
+                   : btOptimizedBvh::deSerializeInPlace(world.collision_bvh.data(),
+                                                        world.collision_bvh_size, false);
+    if (!bvh)
+    {
+        return std::make_unique<btBvhTriangleMeshShape>(&collision_mesh, true, true);
+    }
+
+    auto shape = std::make_unique<btBvhTriangleMeshShape>(&collision_mesh, true, false);
+    shape->setOptimizedBvh(bvh);
+    return shape;
+}
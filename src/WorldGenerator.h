@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <bullet/btBulletDynamicsCommon.h>
+#include <glm/glm.hpp>
+
+#include "Graphics/Mesh.h"
+#include "Utils/Erosion.h"
+#include "Utils/HeightMap.h"
+
+/// Each kind of random decision in the world draws from its own stream of the terrain's seed
+enum class WorldStream : std::uint64_t
+{
+    PointLights,
+    People,
+};
+
+struct WorldOptions
+{
+    TerrainGenerationOptions terrain;
+
+    /// The terrain is eroded after it is generated if this is set
+    std::optional<ErosionOptions> erosion;
+
+    int size = 512;
+    int people_count = 128;
+};
+
+/**
+ * @brief Everything generated for the world, which only depends on the options it was generated
+ * with.
+ *
+ * The terrain uses the default noise, and every other random decision uses a CounterRandom
+ * seeded from the terrain's seed, so the same options always give the same world. Worlds are
+ * cached on disk by the hash of their options, so once a world has been generated it is loaded
+ * from the cache without generating anything, including the BVH of its collision mesh.
+ */
+struct WorldSnapshot
+{
+    /// Bullet uses the BVH in place, which needs it to be 16 byte aligned
+    struct alignas(16) BvhBlock
+    {
+        std::byte bytes[16];
+    };
+
+    explicit WorldSnapshot(int size);
+
+    /// Takes everything from the other world, which must be the same size as the height map's
+    /// size can not change
+    void replace(WorldSnapshot&& other);
+
+    HeightMap height_map;
+    std::vector<glm::vec3> people_positions;
+
+    /// The water level moved down with the terrain when its lowest point was moved to 0
+    float water_height = 0.0f;
+
+    // Serialised BVH of the terrain's collision mesh
+    std::vector<BvhBlock> collision_bvh;
+    std::uint32_t collision_bvh_size = 0;
+
+    /// Hash of the options, which the world is cached by
+    std::uint64_t key = 0;
+
+    /// Hash of the heights and placements, which is the same wherever the world was generated
+    std::uint64_t content_hash = 0;
+
+    bool loaded_from_cache = false;
+};
+
+std::uint64_t hash_world_options(const WorldOptions& options);
+
+/// Position of the point light with the index, which is the same however many lights there are
+glm::vec3 get_point_light_position(const WorldOptions& options, const HeightMap& height_map,
+                                   int index);
+
+/// Generates the world without looking in the cache
+WorldSnapshot generate_world(const WorldOptions& options);
+
+/// Loads the world with the options' hash from the cache, or generates and caches it if it is
+/// missing or damaged
+WorldSnapshot load_or_generate_world(const WorldOptions& options);
+
+void add_terrain_collision_triangles(std::span<const BasicVertex> vertices,
+                                     std::span<const GLuint> indices,
+                                     btTriangleMesh& collision_mesh);
+
+/// Creates the terrain's collision shape with the BVH from the world, which can only be done once
+/// per world. The world and collision mesh must outlive the shape.
+std::unique_ptr<btBvhTriangleMeshShape> create_terrain_collision_shape(
+    WorldSnapshot& world, btTriangleMesh& collision_mesh);
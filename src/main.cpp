@@ -12,9 +12,20 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui.h>
 
+#include "Benchmarks.h"
 #include "GUI.h"
+#include "Graphics/AssetCache.h"
+#include "Graphics/BVH.h"
 #include "Graphics/Camera.h"
+#include "Graphics/CascadedShadowMap.h"
 #include "Graphics/DebugRenderer.h"
+#include "Graphics/Frustum.h"
+#include "Graphics/GpuTerrainGenerator.h"
+#include "Graphics/LightClusters.h"
+#include "Graphics/OcclusionCuller.h"
+#include "Graphics/TerrainStreamer.h"
+#include "Graphics/TextureLoader.h"
+#include "Graphics/Water.h"
 #include "Graphics/GBuffer.h"
 #include "Graphics/Lights.h"
 #include "Graphics/Mesh.h"
@@ -26,32 +37,72 @@
 #include "Graphics/OpenGL/Texture.h"
 #include "Graphics/OpenGL/VertexArray.h"
 #include "PhysicsSystem.h"
+#include "Utils/Erosion.h"
 #include "Utils/HeightMap.h"
+#include "Utils/MappedFile.h"
 #include "Utils/Maths.h"
 #include "Utils/Profiler.h"
 #include "Utils/Util.h"
+#include "WorldGenerator.h"
 
 namespace
 {
     struct Material
     {
-        Texture2D colour_texture;
-        Texture2D specular_texture;
+        std::shared_ptr<Texture2D> colour_texture;
+        std::shared_ptr<Texture2D> specular_texture;
 
-        Material(const std::filesystem::path& colour_texture_path,
+        Material(AssetCache& assets, const std::filesystem::path& colour_texture_path,
                  const std::filesystem::path& specular_texture_path)
+            : colour_texture(assets.get_texture(colour_texture_path, 8, true, false))
+            , specular_texture(assets.get_texture(specular_texture_path, 8, true, false))
         {
-            colour_texture.load_from_file(colour_texture_path, 8, true, false);
-            specular_texture.load_from_file(specular_texture_path, 8, true, false);
         }
 
         void bind(GLuint colour_texture_unit = 0, GLuint specular_texture_unit = 1)
         {
-            colour_texture.bind(colour_texture_unit);
-            specular_texture.bind(specular_texture_unit);
+            colour_texture->bind(colour_texture_unit);
+            specular_texture->bind(specular_texture_unit);
         }
     };
 
+    /// Objects that never move, which are culled using the static scene BVH
+    struct StaticObject
+    {
+        enum class Type
+        {
+            TerrainTile,
+            ModelMesh,
+        } type;
+
+        // Index of the terrain tile/model mesh
+        int index = 0;
+    };
+
+    /// Triangles of a model mesh for Bullet, which reads them from where they are stored rather
+    /// than copying them
+    struct ModelCollisionMesh
+    {
+        btTriangleIndexVertexArray triangles;
+
+        // Keeps the vertices and indices alive if the model is reloaded. Cooked meshes point into
+        // the cooked file, imported meshes are copied as the model owns their vectors.
+        std::shared_ptr<const MappedFile> cooked_file;
+        std::vector<BasicVertex> vertices;
+        std::vector<GLuint> indices;
+    };
+
+    /// What is drawn into a cascade of the shadow map, culled against the cascade's frustum
+    struct ShadowCasters
+    {
+        std::vector<int> static_objects;
+        std::vector<int> terrain_tiles;
+        std::vector<int> model_meshes;
+        std::vector<const TerrainStreamer::Page*> terrain_pages;
+        std::vector<std::uint8_t> box_visibility;
+        int count = 0;
+    };
+
     template <int Ticks>
     class TimeStep
     {
@@ -195,7 +246,6 @@ int main()
     {
         return -1;
     }
-    srand(static_cast<unsigned>(time(nullptr)));
 
     // -----------------------------------------------------------
     // ==== Create the Meshes + OpenGL vertex array + GBuffer ====
@@ -209,8 +259,6 @@ int main()
     TerrainGenerationOptions options;
     options.generate_island = false;
 
-    options.seed = rand() % 50000;
-    options.seed = 3339;
     options.seed = 2777;
     options.amplitude = 317;
     options.amplitude_dampen = 19.1f;
@@ -218,38 +266,82 @@ int main()
     options.octaves = 8;
     options.water_level = 138;
 
-    std::cout << "Seed: " << options.seed << "\n";
-    HeightMap height_map{512};
-    height_map.generate_terrain(options);
-    height_map.set_base_height();
+    // Everything random in the world comes from the options, so it is cached by their hash
+    WorldOptions world_options;
+    world_options.terrain = options;
+
+    sf::Clock world_clock;
+    auto world = load_or_generate_world(world_options);
+    std::cout << "Seed: " << options.seed << ", world " << world.key
+              << (world.loaded_from_cache ? " loaded from the cache in " : " generated in ")
+              << world_clock.getElapsedTime().asMilliseconds() << "ms\n";
+    auto& height_map = world.height_map;
 
     auto terrain_mesh = generate_terrain_mesh(height_map);
-    auto water_mesh = generate_plane_mesh(height_map.size, height_map.size);
+    auto terrain_tiles = generate_terrain_tiles(height_map);
     auto light_vertex_mesh = generate_cube_mesh({5.2f, 5.2f, 5.2f}, false);
     auto box_vertex_mesh = generate_cube_mesh({1.0f, 1.0f, 1.0f}, false);
 
     auto size = 3000.0f;
     auto skybox_mesh = generate_centered_cube_mesh({size, size, size});
 
-    Model model;
-    model.load_from_file("assets/models/House/House2.obj");
+    // Textures are decoded in the background and uploaded a few at a time each frame, showing a
+    // placeholder until then
+    TextureLoader texture_loader;
+
+    // Shares textures, models and shaders so files used in many places are only loaded once
+    AssetCache assets(texture_loader);
+
+    auto model = assets.get_model("assets/models/House/House2.obj");
+    if (!model)
+    {
+        return -1;
+    }
 
     GBuffer gbuffer(window.getSize().x, window.getSize().y);
+    if (!gbuffer.is_complete())
+    {
+        return -1;
+    }
 
     // ------------------------------------
     // ==== Create the OpenGL Textures ====
     // ------------------------------------
-    Material person_material("assets/textures/person.png", "assets/textures/person_specular.png");
-    Material crate_material("assets/textures/crate.png", "assets/textures/grass_specular.png");
-
-    Material grass_material("assets/textures/grass_03.png", "assets/textures/grass_specular.png");
-    Material mud_material("assets/textures/mud.png", "assets/textures/mud_s.png");
-    Material snow_material("assets/textures/snow.png", "assets/textures/snow.png");
-
-    Material water("assets/textures/blue.png", "assets/textures/blue.png");
+    Material person_material(assets, "assets/textures/person.png",
+                             "assets/textures/person_specular.png");
+    Material crate_material(assets, "assets/textures/crate.png",
+                            "assets/textures/grass_specular.png");
+
+    // Terrain layers, in the order of TerrainLayer
+    const std::array<std::filesystem::path, TERRAIN_LAYER_COUNT> terrain_diffuse_paths = {
+        "assets/textures/grass_03.png", "assets/textures/mud.png", "assets/textures/snow.png"};
+    const std::array<std::filesystem::path, TERRAIN_LAYER_COUNT> terrain_specular_paths = {
+        "assets/textures/grass_specular.png", "assets/textures/mud_s.png",
+        "assets/textures/snow.png"};
+
+    Texture2DArray terrain_diffuse;
+    Texture2DArray terrain_specular;
+    texture_loader.load(terrain_diffuse, terrain_diffuse_paths, 8, true, false);
+    texture_loader.load(terrain_specular, terrain_specular_paths, 8, true, false);
+
+    // Weights of each terrain layer, generated from the height and slope of the terrain
+    Texture2DArray terrain_splat_map;
+    terrain_splat_map.create(height_map.size, height_map.size, TERRAIN_SPLAT_MAP_LAYERS);
+    terrain_splat_map.set_wrap_s(TextureWrap::ClampToEdge);
+    terrain_splat_map.set_wrap_t(TextureWrap::ClampToEdge);
+    auto update_splat_map = [&]()
+    {
+        auto splat_map = generate_terrain_splat_map(height_map);
+        for (int i = 0; i < TERRAIN_SPLAT_MAP_LAYERS; i++)
+        {
+            terrain_splat_map.upload_layer(i, splat_map[i].data());
+        }
+        terrain_splat_map.generate_mipmaps();
+    };
+    update_splat_map();
 
     CubeMapTexture skybox_texture;
-    skybox_texture.load_from_file("assets/textures/skybox/");
+    texture_loader.load(skybox_texture, "assets/textures/skybox/");
 
     // ---------------------------------------
     // ==== Create the OpenGL Framebuffer ====
@@ -261,6 +353,13 @@ int main()
         return -1;
     }
 
+    // Streamed terrain is not moved down like the island is, so its water stays at the water level
+    Water water(window.getSize().x, window.getSize().y);
+    float island_water_height = world.water_height;
+
+    CascadedShadowMap shadow_map;
+    std::array<ShadowCasters, CascadedShadowMap::MAX_CASCADES> shadow_casters;
+
     // --------------------------------------------------
     // ==== Create empty VBO for rendering to window ====
     // --------------------------------------------------
@@ -269,79 +368,238 @@ int main()
     // ----------------------
     // ==== Load shaders ====
     // ----------------------
-    Shader scene_shader;
-    if (!scene_shader.load_from_file("assets/shaders/SceneVertex.glsl",
-                                     "assets/shaders/SceneFragment.glsl"))
+    // Shaders are linked from the program binaries cached by previous runs when possible
+    sf::Clock shader_load_clock;
+    auto scene_shader = assets.get_shader("assets/shaders/SceneVertex.glsl",
+                                          "assets/shaders/SceneFragment.glsl");
+    if (!scene_shader)
+    {
+        return -1;
+    }
+
+    // Light sources are drawn unlit by a variant with the lighting compiled out
+    auto scene_light_shader = assets.get_shader("assets/shaders/SceneVertex.glsl",
+                                                "assets/shaders/SceneFragment.glsl", {"IS_LIGHT"});
+    if (!scene_light_shader)
+    {
+        return -1;
+    }
+
+    auto terrain_shader = assets.get_shader("assets/shaders/SceneVertex.glsl",
+                                            "assets/shaders/TerrainFragment.glsl");
+    if (!terrain_shader)
+    {
+        return -1;
+    }
+
+    // Deferred rendering shaders
+    auto gbuffer_shader = assets.get_shader("assets/shaders/SceneVertex.glsl",
+                                            "assets/shaders/GBufferFragment.glsl");
+    if (!gbuffer_shader)
+    {
+        return -1;
+    }
+
+    auto gbuffer_light_shader = assets.get_shader(
+        "assets/shaders/SceneVertex.glsl", "assets/shaders/GBufferFragment.glsl", {"IS_LIGHT"});
+    if (!gbuffer_light_shader)
     {
         return -1;
     }
 
-    Shader terrain_shader;
-    if (!terrain_shader.load_from_file("assets/shaders/SceneVertex.glsl",
-                                       "assets/shaders/TerrainFragment.glsl"))
+    auto terrain_gbuffer_shader = assets.get_shader("assets/shaders/SceneVertex.glsl",
+                                                    "assets/shaders/TerrainGBufferFragment.glsl");
+    if (!terrain_gbuffer_shader)
     {
         return -1;
     }
-    terrain_shader.set_uniform("max_height", height_map.max_height());
-
-    // Shader gbuffer_shader;
-    // if (!gbuffer_shader.load_from_file("assets/shaders/GBufferVertex.glsl",
-    //                                    "assets/shaders/GBufferFragment.glsl"))
-    // {
-    //     return -1;
-    // }
-
-    Shader fbo_shader;
-    if (!fbo_shader.load_from_file("assets/shaders/ScreenVertex.glsl",
-                                   "assets/shaders/ScreenFragment.glsl"))
+
+    // Terrain variants that displace a flat grid with the heights from the GPU terrain generator
+    auto gpu_terrain_shader = assets.get_shader(
+        "assets/shaders/SceneVertex.glsl", "assets/shaders/TerrainFragment.glsl", {"GPU_TERRAIN"});
+    auto gpu_terrain_gbuffer_shader =
+        assets.get_shader("assets/shaders/SceneVertex.glsl",
+                          "assets/shaders/TerrainGBufferFragment.glsl", {"GPU_TERRAIN"});
+    if (!gpu_terrain_shader || !gpu_terrain_gbuffer_shader)
     {
         return -1;
     }
 
-    Shader skybox_shader;
-    if (!skybox_shader.load_from_file("assets/shaders/SkyboxVertex.glsl",
-                                      "assets/shaders/SkyboxFragment.glsl"))
+    // Forward variants for the water's reflection and refraction passes, which clip away the other
+    // side of the water
+    auto water_scene_shader = assets.get_shader(
+        "assets/shaders/SceneVertex.glsl", "assets/shaders/SceneFragment.glsl", {"WATER_PASS"});
+    auto water_scene_light_shader =
+        assets.get_shader("assets/shaders/SceneVertex.glsl", "assets/shaders/SceneFragment.glsl",
+                          {"IS_LIGHT", "WATER_PASS"});
+    auto water_terrain_shader = assets.get_shader(
+        "assets/shaders/SceneVertex.glsl", "assets/shaders/TerrainFragment.glsl", {"WATER_PASS"});
+    auto water_gpu_terrain_shader =
+        assets.get_shader("assets/shaders/SceneVertex.glsl", "assets/shaders/TerrainFragment.glsl",
+                          {"GPU_TERRAIN", "WATER_PASS"});
+    if (!water_scene_shader || !water_scene_light_shader || !water_terrain_shader ||
+        !water_gpu_terrain_shader)
+    {
+        return -1;
+    }
+
+    auto water_shader = assets.get_shader("assets/shaders/WaterVertex.glsl",
+                                          "assets/shaders/WaterFragment.glsl");
+    if (!water_shader)
+    {
+        return -1;
+    }
+    water_shader->set_uniform("reflection_tex", 0);
+    water_shader->set_uniform("refraction_tex", 1);
+    water_shader->set_uniform("refraction_depth_tex", 2);
+
+    // Depth only shaders for the shadow maps
+    auto shadow_shader = assets.get_shader("assets/shaders/SceneVertex.glsl",
+                                           "assets/shaders/ShadowFragment.glsl");
+    auto shadow_gpu_terrain_shader = assets.get_shader(
+        "assets/shaders/SceneVertex.glsl", "assets/shaders/ShadowFragment.glsl", {"GPU_TERRAIN"});
+    if (!shadow_shader || !shadow_gpu_terrain_shader)
     {
         return -1;
     }
+    shadow_gpu_terrain_shader->set_uniform("height_map", 3);
+
+    auto deferred_shader = assets.get_shader("assets/shaders/ScreenVertex.glsl",
+                                             "assets/shaders/SceneFragmentDeferred.glsl");
+    if (!deferred_shader)
+    {
+        return -1;
+    }
+    deferred_shader->set_uniform("position_tex", 0);
+    deferred_shader->set_uniform("normal_tex", 1);
+    deferred_shader->set_uniform("albedo_spec_tex", 2);
+
+    auto fbo_shader = assets.get_shader("assets/shaders/ScreenVertex.glsl",
+                                        "assets/shaders/ScreenFragment.glsl");
+    if (!fbo_shader)
+    {
+        return -1;
+    }
+
+    auto skybox_shader = assets.get_shader("assets/shaders/SkyboxVertex.glsl",
+                                           "assets/shaders/SkyboxFragment.glsl");
+    if (!skybox_shader)
+    {
+        return -1;
+    }
+    std::cout << "Loaded shaders in " << shader_load_clock.getElapsedTime().asMilliseconds()
+              << "ms\n";
 
     // -----------------------------------
     // ==== Entity Transform Creation ====
     // -----------------------------------
     Transform terrain_transform;
-    Transform water_transform;
     Transform light_transform;
     Transform model_transform;
     auto middle = height_map.size / 2.0f;
-    model_transform.position = {middle, height_map.get_height(middle, middle) * 1, middle};
+    model_transform.position = {middle, height_map.sample(middle, middle), middle};
     model_transform.scale = {2, 2, 2};
 
-    water_transform.position.y = 0;
-    options.water_level;
-
-    std::array<PointLight, 5> point_lights;
-    for (int i = 0; i < 5; i++)
+    std::vector<PointLight> point_lights;
+    auto resize_point_lights = [&](int count)
     {
-        PointLight p = settings.lights.point_light;
-        float x = static_cast<float>(rand() % (height_map.size - 2)) + 1;
-        float z = static_cast<float>(rand() % (height_map.size - 2)) + 1;
-        p.position = {x, height_map.get_height(x, z), z, 0.0f};
-        point_lights[i] = p;
-    }
+        while (static_cast<int>(point_lights.size()) < count)
+        {
+            PointLight p = settings.lights.point_light;
+            auto index = static_cast<int>(point_lights.size());
+            p.position = {get_point_light_position(world_options, height_map, index), 0.0f};
+            point_lights.push_back(p);
+        }
+        point_lights.resize(count);
+    };
+    resize_point_lights(settings.point_light_count);
 
+    // Billboards rotate around the Y axis to face the camera, so bound them by the full rotation
     std::vector<Transform> people_transforms;
-    for (int i = 0; i < 128; i++)
+    std::vector<AABB> people_bounds;
+    AABBList billboard_bounds;
+    auto place_people = [&]()
     {
-        // float x = height_map.size / 2 + rand() % 25 - 50;
-        // float z = height_map.size / 2 + rand() % 100 - 50;
+        people_transforms.clear();
+        people_bounds.clear();
+        billboard_bounds.clear();
+        billboard_bounds.reserve(world.people_positions.size());
+        for (auto& position : world.people_positions)
+        {
+            people_transforms.push_back({position, {0.0f, 0.0, 0}});
+            auto& p = position;
+            people_bounds.push_back(
+                {{p.x - 1.0f, p.y, p.z - 1.0f}, {p.x + 1.0f, p.y + 2.0f, p.z + 1.0f}});
+            billboard_bounds.add(people_bounds.back());
+        }
+    };
+    place_people();
+    auto& light_bounds = light_vertex_mesh.get_bounds();
+
+    light_transform.position = {20.0f, 5.0f, 20.0f};
+
+    // ----------------------------------
+    // ==== Static Scene Culling BVH ====
+    // ----------------------------------
+    BVH static_scene;
+    std::vector<StaticObject> static_objects;
+    auto add_static_object = [&](StaticObject::Type type, int index, const AABB& bounds)
+    {
+        static_objects.push_back({type, index});
+        return static_scene.insert(bounds, static_cast<int>(static_objects.size()) - 1);
+    };
+
+    // Coarse terrain that is rasterized on the CPU to find what is hidden behind hills
+    OcclusionCuller occlusion_culler(256, 144);
+    occlusion_culler.set_terrain_occluder(height_map, create_model_matrix(terrain_transform));
 
-        float x = static_cast<float>(rand() % (height_map.size - 2)) + 1;
-        float z = static_cast<float>(rand() % (height_map.size - 2)) + 1;
+    // Endless terrain that is drawn instead of the island when streaming is enabled
+    TerrainStreamer terrain_streamer;
+    terrain_streamer.reset(options);
 
-        people_transforms.push_back({{x, height_map.get_height(x, z), z}, {0.0f, 0.0, 0}});
+    // Generates the island's heights on the GPU when enabled. The island is drawn from the GPU's
+    // heights straight away, and the CPU's copy is updated a few frames later once read back.
+    GpuTerrainGenerator gpu_terrain;
+    bool gpu_terrain_supported = gpu_terrain.init();
+    bool gpu_terrain_active = false;
+    bool gpu_terrain_setting = settings.gpu_terrain;
+
+    // Erodes the island's heights over a few frames after it is generated, on the CPU
+    ErosionOptions erosion_options;
+    TerrainEroder terrain_eroder;
+
+    auto get_terrain_height = [&](float x, float z)
+    {
+        return settings.stream_terrain ? terrain_streamer.get_height(x, z)
+                                       : height_map.sample(x, z);
+    };
+
+    // Terrain leaves are kept so they can be updated when the terrain is re-generated
+    std::vector<int> terrain_tile_leaves;
+    for (int i = 0; i < static_cast<int>(terrain_tiles.size()); i++)
+    {
+        terrain_tile_leaves.push_back(
+            add_static_object(StaticObject::Type::TerrainTile, i, terrain_tiles[i].bounds));
     }
 
-    light_transform.position = {20.0f, 5.0f, 20.0f};
+    // Updates everything that is built from the island's heights, apart from the mesh
+    auto update_terrain_users = [&]()
+    {
+        update_splat_map();
+        terrain_tiles = generate_terrain_tiles(height_map);
+        occlusion_culler.set_terrain_occluder(height_map, create_model_matrix(terrain_transform));
+        for (std::size_t i = 0; i < terrain_tiles.size(); i++)
+        {
+            static_scene.update(terrain_tile_leaves[i], terrain_tiles[i].bounds);
+        }
+    };
+
+    auto model_mat = create_model_matrix(model_transform);
+    for (int i = 0; i < static_cast<int>(model->get_meshes().size()); i++)
+    {
+        auto& bounds = model->get_meshes()[i].mesh.get_bounds();
+        add_static_object(StaticObject::Type::ModelMesh, i, bounds.transformed(model_mat));
+    }
 
     // -----------------------------------
     // ==== Camera Creation ====
@@ -361,7 +619,7 @@ int main()
     camera.transform.rotation = {0.0f, 100, 0.0f};
     player_transform.position = {200, 11.5, 118};
     player_transform.position.y =
-        height_map.get_height(player_transform.position.x, player_transform.position.z) + 2;
+        height_map.sample(player_transform.position.x, player_transform.position.z) + 2;
 
     settings.lights.dir_light.direction = {0.9, -1.5, 0.075, -1};
     settings.lights.dir_light.ambient_intensity = 0.03f;
@@ -413,29 +671,48 @@ int main()
     // -------------------------------------------------------
 
     // The triangle mesh must be kept alive so created in the outer scope
-    btTriangleMesh terrain_collision_mesh;
+    auto terrain_collision_mesh = std::make_unique<btTriangleMesh>();
+    int ground_index = 0;
     {
         PhysicsObject& ground = physics.objects.emplace_back();
+        ground_index = physics.objects.size() - 1;
 
-        // Create the collision mesh
-        auto& is = terrain_mesh.indices;
-        auto& vs = terrain_mesh.vertices;
-        for (int i = 0; i < (int)terrain_mesh.indices.size(); i += 3)
-        {
-            auto v1 = to_btvec3(vs[is[i]].position);
-            auto v2 = to_btvec3(vs[is[i + 1]].position);
-            auto v3 = to_btvec3(vs[is[i + 2]].position);
-            terrain_collision_mesh.addTriangle(v1, v2, v3);
-        }
-
-        ground.setup(std::make_unique<btBvhTriangleMeshShape>(&terrain_collision_mesh, true, true),
-                     0, {0, 0, 0});
+        // Create the collision mesh, with the BVH from the world rather than building it again
+        add_terrain_collision_triangles(terrain_mesh.vertices, terrain_mesh.indices,
+                                        *terrain_collision_mesh);
+        ground.setup(create_terrain_collision_shape(world, *terrain_collision_mesh), 0, {0, 0, 0});
         ground.body->setUserPointer(&ground);
         ground.id = 100;
 
         physics.world.addRigidBody(ground.body.get());
     }
 
+    // Loads the world for the current world options from the cache, or generates it, and moves
+    // everything placed from it. The ground's shape uses the old world's BVH in place, so the
+    // ground is taken out of the physics world until its shape has been created again.
+    bool world_modified = false;
+    auto regenerate_world = [&]()
+    {
+        auto& ground = physics.objects[ground_index];
+        physics.world.removeRigidBody(ground.body.get());
+
+        world.replace(load_or_generate_world(world_options));
+        world_modified = false;
+        island_water_height = world.water_height;
+        update_terrain_mesh(terrain_mesh, height_map);
+        terrain_mesh.update();
+
+        terrain_collision_mesh = std::make_unique<btTriangleMesh>();
+        add_terrain_collision_triangles(terrain_mesh.vertices, terrain_mesh.indices,
+                                        *terrain_collision_mesh);
+        ground.setup(create_terrain_collision_shape(world, *terrain_collision_mesh), 0, {0, 0, 0});
+        physics.world.addRigidBody(ground.body.get());
+
+        place_people();
+        point_lights.clear();
+        resize_point_lights(settings.point_light_count);
+    };
+
     // ----------------------------------------------------
     // ==== Bullet3D Experiments: Player ====
     // ----------------------------------------------------
@@ -460,29 +737,48 @@ int main()
     // ----------------------------------------------------
     // ==== Bullet3D Experiments: Create a static mesh ====
     // ----------------------------------------------------
-    std::vector<std::unique_ptr<btTriangleMesh>> model_collision_meshes;
+    std::vector<std::unique_ptr<ModelCollisionMesh>> model_collision_meshes;
 
-    for (auto& model_mesh : model.get_meshes())
+    for (auto& model_mesh : model->get_meshes())
     {
+        // Bullet cannot build a shape from a mesh without any triangles
+        if (model_mesh.cooked_indices.empty() && model_mesh.mesh.indices.empty())
+        {
+            continue;
+        }
 
         auto& collision_mesh =
-            model_collision_meshes.emplace_back(std::make_unique<btTriangleMesh>());
+            model_collision_meshes.emplace_back(std::make_unique<ModelCollisionMesh>());
         PhysicsObject& mesh_object = physics.objects.emplace_back();
 
-        auto& is = model_mesh.mesh.indices;
-        auto& vs = model_mesh.mesh.vertices;
-        for (int i = 0; i < (int)model_mesh.mesh.indices.size(); i += 3)
+        std::span<const BasicVertex> vertices = model_mesh.cooked_vertices;
+        std::span<const GLuint> indices = model_mesh.cooked_indices;
+        collision_mesh->cooked_file = model_mesh.cooked_file;
+        if (!model_mesh.cooked_file)
         {
-            auto v1 = to_btvec3(vs[is[i]].position);
-            auto v2 = to_btvec3(vs[is[i + 1]].position);
-            auto v3 = to_btvec3(vs[is[i + 2]].position);
-            collision_mesh->addTriangle(v1, v2, v3);
+            collision_mesh->vertices = model_mesh.mesh.vertices;
+            collision_mesh->indices = model_mesh.mesh.indices;
+            vertices = collision_mesh->vertices;
+            indices = collision_mesh->indices;
         }
-        collision_mesh->setScaling(to_btvec3(model_transform.scale));
 
-        mesh_object.setup(
-            std::make_unique<btBvhTriangleMeshShape>(collision_mesh.get(), true, true), 0.0f,
-            to_btvec3(model_transform.position));
+        btIndexedMesh indexed_mesh;
+        indexed_mesh.m_numTriangles = static_cast<int>(indices.size() / 3);
+        indexed_mesh.m_triangleIndexBase = reinterpret_cast<const unsigned char*>(indices.data());
+        indexed_mesh.m_triangleIndexStride = 3 * sizeof(GLuint);
+        indexed_mesh.m_numVertices = static_cast<int>(vertices.size());
+        indexed_mesh.m_vertexBase = reinterpret_cast<const unsigned char*>(vertices.data()) +
+                                    offsetof(BasicVertex, position);
+        indexed_mesh.m_vertexStride = sizeof(BasicVertex);
+        indexed_mesh.m_indexType = PHY_INTEGER;
+        indexed_mesh.m_vertexType = PHY_FLOAT;
+
+        auto& triangles = collision_mesh->triangles;
+        triangles.addIndexedMesh(indexed_mesh, PHY_INTEGER);
+        triangles.setScaling(to_btvec3(model_transform.scale));
+
+        mesh_object.setup(std::make_unique<btBvhTriangleMeshShape>(&triangles, true, true), 0.0f,
+                          to_btvec3(model_transform.position));
 
         physics.world.addRigidBody(mesh_object.body.get());
 
@@ -520,30 +816,67 @@ int main()
     light_ubo.bind_buffer_base(BindBufferTarget::UniformBuffer, 1);
     light_ubo.bind_buffer_range(BindBufferTarget::UniformBuffer, 1, SIZE);
 
-    BufferObject pointlights_ubo;
-    pointlights_ubo.create_store(sizeof(PointLight) * 5);
-    pointlights_ubo.bind_buffer_base(BindBufferTarget::UniformBuffer, 2);
-    pointlights_ubo.bind_buffer_range(BindBufferTarget::UniformBuffer, 2, sizeof(PointLight) * 5);
+    // Point lights are stored in SSBOs, and binned into clusters so each fragment only evaluates
+    // the lights that are near to it
+    LightClusters light_clusters;
 
     // Each shader must be bound to the specific index
-    scene_shader.bind_uniform_block_index("matrix_data", 0);
-    scene_shader.bind_uniform_block_index("Light", 1);
-    scene_shader.bind_uniform_block_index("PointLights", 2);
+    for (auto shader : {scene_shader.get(), terrain_shader.get(), gpu_terrain_shader.get(),
+                        deferred_shader.get(), water_scene_shader.get(), water_terrain_shader.get(),
+                        water_gpu_terrain_shader.get()})
+    {
+        shader->bind_uniform_block_index("matrix_data", 0);
+        shader->bind_uniform_block_index("Light", 1);
+        shader->bind_uniform_block_index("ShadowData", CascadedShadowMap::SHADOW_UBO_INDEX);
+    }
 
-    skybox_shader.bind_uniform_block_index("matrix_data", 0);
+    // The water passes go without point lights, so only these shaders use the light clusters
+    for (auto shader : {scene_shader.get(), terrain_shader.get(), gpu_terrain_shader.get(),
+                        deferred_shader.get()})
+    {
+        shader->bind_uniform_block_index("LightClusterInfo", LightClusters::INFO_UBO_INDEX);
+        shader->bind_shader_storage_block_index("PointLights", LightClusters::LIGHTS_SSBO_INDEX);
+        shader->bind_shader_storage_block_index("LightClusters",
+                                                LightClusters::CLUSTERS_SSBO_INDEX);
+        shader->bind_shader_storage_block_index("LightIndices", LightClusters::INDICES_SSBO_INDEX);
+    }
 
-    terrain_shader.bind_uniform_block_index("matrix_data", 0);
-    terrain_shader.bind_uniform_block_index("Light", 1);
-    terrain_shader.bind_uniform_block_index("PointLights", 2);
+    // The water surface only uses the directional light, so the other blocks are inactive
+    water_shader->bind_uniform_block_index("matrix_data", 0);
+    water_shader->bind_uniform_block_index("Light", 1);
 
-    terrain_shader.set_uniform("material.grass_diffuse", 0);
-    terrain_shader.set_uniform("material.grass_specular", 1);
+    // The water surface does its own lighting, so it does not sample the shadow map
+    for (auto shader : {scene_shader.get(), terrain_shader.get(), gpu_terrain_shader.get(),
+                        deferred_shader.get(), water_scene_shader.get(), water_terrain_shader.get(),
+                        water_gpu_terrain_shader.get()})
+    {
+        shader->set_uniform("shadow_map", static_cast<int>(CascadedShadowMap::SHADOW_MAP_UNIT));
+    }
+
+    for (auto shader : {skybox_shader.get(), scene_light_shader.get(), gbuffer_shader.get(),
+                        gbuffer_light_shader.get(), terrain_gbuffer_shader.get(),
+                        gpu_terrain_gbuffer_shader.get(), water_scene_light_shader.get(),
+                        shadow_shader.get(), shadow_gpu_terrain_shader.get()})
+    {
+        shader->bind_uniform_block_index("matrix_data", 0);
+    }
 
-    terrain_shader.set_uniform("material.mud_diffuse", 2);
-    terrain_shader.set_uniform("material.mud_specular", 3);
+    for (auto shader : {terrain_shader.get(), terrain_gbuffer_shader.get(),
+                        gpu_terrain_shader.get(), gpu_terrain_gbuffer_shader.get(),
+                        water_terrain_shader.get(), water_gpu_terrain_shader.get()})
+    {
+        shader->set_uniform("terrain_diffuse", 0);
+        shader->set_uniform("terrain_specular", 1);
+        shader->set_uniform("splat_map", 2);
+        shader->set_uniform("terrain_layer_count", static_cast<int>(TERRAIN_LAYER_COUNT));
+    }
 
-    terrain_shader.set_uniform("material.snow_diffuse", 4);
-    terrain_shader.set_uniform("material.snow_specular", 5);
+    // The height map only exists in the GPU terrain variants
+    for (auto shader : {gpu_terrain_shader.get(), gpu_terrain_gbuffer_shader.get(),
+                        water_gpu_terrain_shader.get()})
+    {
+        shader->set_uniform("height_map", 3);
+    }
 
     //  -------------------
     //  ==== Main Loop ====
@@ -556,6 +889,17 @@ int main()
     bool is_debug = false;
     bool flying = true;
 
+    AABBList box_bounds;
+    std::vector<std::uint8_t> box_visibility;
+    std::vector<std::uint8_t> billboard_visibility;
+    int visible_boxes = 0;
+    int visible_billboards = 0;
+    std::vector<int> visible_static_objects;
+    std::vector<int> visible_terrain_tiles;
+    std::vector<const TerrainStreamer::Page*> visible_terrain_pages;
+    std::vector<int> visible_model_meshes;
+    bool light_visible = true;
+
     Profiler profiler;
     while (window.isOpen())
     {
@@ -601,7 +945,7 @@ int main()
                     // float base_z = camera.transform.position.z;
 
                     // Y Start position
-                    float start = height_map.get_height(base_x, base_z) + 25;
+                    float start = height_map.sample(base_x, base_z) + 25;
 
                     // Height of the box stack
                     float height = 25;
@@ -680,7 +1024,7 @@ int main()
         // ------------------------
         // Walking sound effects
         auto cam_pos = camera.transform.position;
-        auto height = height_map.get_height(cam_pos.x, cam_pos.z);
+        auto height = get_terrain_height(cam_pos.x, cam_pos.z);
         if ((std::abs(translate.x + translate.y + translate.z) > 0) && cam_pos.y < height + 2.0f)
         {
             if (walk_sounds[sound_idx].getStatus() != sf::Sound::Status::Playing)
@@ -726,14 +1070,14 @@ int main()
                     light_transform.position.z +=
                         glm::cos(game_time_now.asSeconds() * 0.55f) * dt.asSeconds() * 3.0f;
                     light_transform.position.y =
-                        height_map.get_height(static_cast<int>(light_transform.position.x),
-                                              static_cast<int>(light_transform.position.z)) +
+                        height_map.sample(light_transform.position.x,
+                                          light_transform.position.z) +
                         1.0f;
                     //   settings.spot_light.cutoff -= 0.01;
                 });
 
             float h =
-                height_map.get_height(player_transform.position.x, player_transform.position.z) + 1;
+                get_terrain_height(player_transform.position.x, player_transform.position.z) + 1;
             if (!flying || player_transform.position.y < h)
             {
                 player_transform.position.y = h + 1;
@@ -796,20 +1140,104 @@ int main()
         // View/ Camera matrix
         camera.update();
 
+        // Pages can be evicted by the update, so it must come before they are culled
+        if (settings.stream_terrain)
+        {
+            auto& terrain_streaming_profiler = profiler.begin_section("TerrainStreaming");
+            terrain_streamer.update(camera.transform.position, sf::milliseconds(2));
+            terrain_streaming_profiler.end_section();
+        }
+
+        // -------------------------
+        // ==== Frustum Culling ====
+        // -------------------------
+        auto& culling_profiler = profiler.begin_section("Culling");
+        auto frustum = Frustum::from_matrix(camera.get_projection() * camera.get_view_matrix());
+
+        box_bounds.clear();
+        box_bounds.reserve(physics.objects.size());
+        for (auto& object : physics.objects)
+        {
+            box_bounds.add(object.get_aabb());
+        }
+        box_bounds.cull(frustum, box_visibility);
+        billboard_bounds.cull(frustum, billboard_visibility);
+
+        visible_static_objects.clear();
+        visible_terrain_tiles.clear();
+        visible_model_meshes.clear();
+        static_scene.query(frustum, visible_static_objects);
+        for (int object_index : visible_static_objects)
+        {
+            auto& object = static_objects[object_index];
+            (object.type == StaticObject::Type::TerrainTile ? visible_terrain_tiles
+                                                            : visible_model_meshes)
+                .push_back(object.index);
+        }
+
+        // The streamed terrain replaces the island
+        visible_terrain_pages.clear();
+        if (settings.stream_terrain)
+        {
+            visible_terrain_tiles.clear();
+            terrain_streamer.cull(frustum, visible_terrain_pages);
+        }
+
+        // ---------------------------
+        // ==== Occlusion Culling ====
+        // ---------------------------
+        // Only objects that passed frustum culling are tested against the terrain
+        auto light_mat = create_model_matrix(light_transform);
+        light_visible = frustum.is_visible(light_bounds.transformed(light_mat));
+        // The occluder is the island, so it would hide things behind hills that are not there
+        if (settings.occlusion_culling && !settings.stream_terrain)
+        {
+            occlusion_culler.render(camera.get_projection() * camera.get_view_matrix());
+            for (std::size_t i = 0; i < physics.objects.size(); i++)
+            {
+                box_visibility[i] =
+                    box_visibility[i] && occlusion_culler.is_visible(physics.objects[i].get_aabb());
+            }
+            for (std::size_t i = 0; i < people_transforms.size(); i++)
+            {
+                billboard_visibility[i] = billboard_visibility[i] &&
+                                          occlusion_culler.is_visible(people_bounds[i]);
+            }
+            std::erase_if(visible_terrain_tiles, [&](int tile)
+                          { return !occlusion_culler.is_visible(terrain_tiles[tile].bounds); });
+            std::erase_if(visible_model_meshes,
+                          [&](int mesh)
+                          {
+                              auto& bounds = model->get_meshes()[mesh].mesh.get_bounds();
+                              return !occlusion_culler.is_visible(bounds.transformed(model_mat));
+                          });
+            light_visible =
+                light_visible && occlusion_culler.is_visible(light_bounds.transformed(light_mat));
+        }
+        visible_boxes =
+            static_cast<int>(std::count(box_visibility.begin(), box_visibility.end(), 1));
+        visible_billboards = static_cast<int>(
+            std::count(billboard_visibility.begin(), billboard_visibility.end(), 1));
+        culling_profiler.end_section();
+
         // ------------------------------
         // ==== Set up shader states ====
         // ------------------------------
         auto& full_render_profiler = profiler.begin_section("FullRender");
 
+        auto& texture_upload_profiler = profiler.begin_section("TextureUpload");
+        if (settings.hot_reload)
+        {
+            assets.hot_reload();
+        }
+        texture_loader.update(sf::milliseconds(2));
+        assets.collect();
+        texture_upload_profiler.end_section();
+
         auto& shader_states_profiler = profiler.begin_section("ShaderUniform");
         matrix_ubo.buffer_sub_data(0, camera.get_projection());
         matrix_ubo.buffer_sub_data(sizeof(camera.get_view_matrix()), camera.get_view_matrix());
 
-        // For deferred shading:
-        // scene_shader.set_uniform("postion_tex", 0);
-        // scene_shader.set_uniform("normal_tex", 1);
-        // scene_shader.set_uniform("albedo_spec_tex", 2);
-
         // ---------------------------
         // ==== UBO shader states ====
         // ---------------------------
@@ -823,124 +1251,337 @@ int main()
         light_ubo.buffer_sub_data(sizeof(DirectionalLight), spotlight);
 
         // Set point lights
+        resize_point_lights(settings.point_light_count);
         for (auto& light : point_lights)
         {
             auto p = light.position;
             light = settings.lights.point_light;
             light.position = p;
         }
-        point_lights[4].position = glm::vec4(light_transform.position, 1.0f);
-        pointlights_ubo.buffer_sub_data(0, point_lights);
+        point_lights[0].position = glm::vec4(light_transform.position, 1.0f);
 
         shader_states_profiler.end_section();
-        // -------------------------------------
-        // ==== Render to GBuffer (fbo now) ====
-        // -------------------------------------
-        auto& rendering_profile = profiler.begin_section("Rendering");
-        //
-        // gbuffer.bind();
-        // gbuffer_shader.bind();
 
-        glPolygonMode(GL_FRONT_AND_BACK, debug_renderer.gl_wireframe() ? GL_LINE : GL_FILL);
+        // ------------------------
+        // ==== Light Clusters ====
+        // ------------------------
+        auto& light_culling_profiler = profiler.begin_section("LightCulling");
+        light_clusters.build(point_lights, camera.get_view_matrix(), camera.get_projection());
+        // Clusters are found from gl_FragCoord, so they are sized to the framebuffer being lit,
+        // which both the forward and deferred passes render into
+        light_clusters.upload(point_lights, glm::vec2(fbo.get_size()));
+        light_culling_profiler.end_section();
 
-        fbo.bind();
-        scene_shader.bind();
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
+        // -------------------------------
+        // ==== Shadow Caster Culling ====
+        // -------------------------------
+        // Each cascade only draws what is inside of its own frustum, so the near cascades which
+        // cover a small area are cheap to render
+        auto& shadow_culling_profiler = profiler.begin_section("ShadowCulling");
+        shadow_map.update(settings.shadows, camera,
+                          glm::vec3(settings.lights.dir_light.direction));
+        for (int i = 0; i < shadow_map.get_cascade_count(); i++)
+        {
+            auto& cascade_frustum = shadow_map.get_cascade(i).frustum;
+            auto& casters = shadow_casters[i];
+
+            casters.static_objects.clear();
+            casters.terrain_tiles.clear();
+            casters.model_meshes.clear();
+            static_scene.query(cascade_frustum, casters.static_objects);
+            for (int object_index : casters.static_objects)
+            {
+                auto& object = static_objects[object_index];
+                (object.type == StaticObject::Type::TerrainTile ? casters.terrain_tiles
+                                                                : casters.model_meshes)
+                    .push_back(object.index);
+            }
 
-        // ==== Render Terrain ====
-        //(settings.grass ? grass_material : crate_material).bind();
-        // mud_material.bind(2, 3);
-        scene_shader.set_uniform("is_light", false);
+            casters.terrain_pages.clear();
+            if (settings.stream_terrain)
+            {
+                casters.terrain_tiles.clear();
+                terrain_streamer.cull(cascade_frustum, casters.terrain_pages);
+            }
+            auto box_casters = box_bounds.cull(cascade_frustum, casters.box_visibility);
+            casters.count = static_cast<int>(casters.terrain_tiles.size() +
+                                             casters.terrain_pages.size() +
+                                             casters.model_meshes.size() + box_casters);
+        }
+        shadow_culling_profiler.end_section();
 
-        auto terrain_mat = create_model_matrix(terrain_transform);
-        terrain_shader.bind();
+        // --------------------------
+        // ==== Render the scene ====
+        // --------------------------
+        // Render the boxes, using the built in getOpenGLMatrix from bullet
+        auto get_box_matrix = [&](std::size_t index)
+        {
+            glm::mat4 m{1.0f};
+            physics.objects[index].body->getWorldTransform().getOpenGLMatrix(glm::value_ptr(m));
+            return glm::translate(m, {-0.5, -0.5, -0.5});
+        };
+
+        // Draws all the opaque geometry. The shaders either light it straight away (forward) or
+        // write it to the GBuffer to be lit afterwards (deferred)
+        auto render_scene = [&](Shader& object_shader, Shader& terrain_object_shader,
+                                Shader& gpu_terrain_object_shader, Shader& light_object_shader)
+        {
+            glEnable(GL_DEPTH_TEST);
+            glEnable(GL_CULL_FACE);
+            glCullFace(GL_BACK);
 
-        grass_material.bind(0, 1);
-        mud_material.bind(2, 3);
-        snow_material.bind(4, 5);
+            // ==== Render Terrain ====
+            terrain_diffuse.bind(0);
+            terrain_specular.bind(1);
+            terrain_splat_map.bind(2);
 
-        terrain_shader.set_uniform("model_matrix", terrain_mat);
-        terrain_shader.set_uniform("eye_position", camera.transform.position);
-        terrain_mesh.bind();
-        terrain_mesh.draw();
+            // GPU terrain only uses the x and z of the mesh, the heights come from the texture
+            auto& island_shader = gpu_terrain_active ? gpu_terrain_object_shader
+                                                     : terrain_object_shader;
+            if (gpu_terrain_active)
+            {
+                gpu_terrain.get_height_texture().bind(3);
+            }
+            island_shader.bind();
 
-        // Render the boxes, using the built in getOpenGLMatrix from bullet
-        scene_shader.bind();
-        scene_shader.set_uniform("eye_position", camera.transform.position);
+            auto terrain_mat = create_model_matrix(terrain_transform);
+            island_shader.set_uniform("model_matrix", terrain_mat);
+            island_shader.set_uniform("terrain_size", static_cast<float>(height_map.size));
+            terrain_mesh.bind();
+            for (int tile_index : visible_terrain_tiles)
+            {
+                auto& tile = terrain_tiles[tile_index];
+                terrain_mesh.draw_elements(tile.first_index, tile.index_count);
+            }
 
-        person_material.bind();
-        box_vertex_mesh.bind();
-        for (auto& box_transform : physics.objects)
-        {
-            glm::mat4 m{1.0f};
-            box_transform.body->getWorldTransform().getOpenGLMatrix(glm::value_ptr(m));
-            m = glm::translate(m, {-0.5, -0.5, -0.5});
+            // Each page has its own splat map covering just that page
+            terrain_object_shader.bind();
+            terrain_object_shader.set_uniform("terrain_size",
+                                              static_cast<float>(TerrainStreamer::PAGE_SIZE + 1));
+            for (auto page : visible_terrain_pages)
+            {
+                terrain_object_shader.set_uniform(
+                    "model_matrix", glm::translate(glm::mat4{1.0f}, page->get_position()));
+                page->splat_map.bind(2);
+                page->mesh.bind();
+                page->mesh.draw();
+            }
 
-            scene_shader.set_uniform("model_matrix", m);
-            box_vertex_mesh.draw();
-        }
+            // ==== Render Boxes ====
+            object_shader.bind();
 
-        // ==== Render Billboards ====
-        person_material.bind();
-        billboard_vertex_array.bind();
-        for (auto& transform : people_transforms)
-        {
-            // Draw billboard
-            auto pi = static_cast<float>(std::numbers::pi);
-            auto xd = transform.position.x - camera.transform.position.x;
-            auto yd = transform.position.z - camera.transform.position.z;
+            person_material.bind();
+            box_vertex_mesh.bind();
+            for (std::size_t i = 0; i < physics.objects.size(); i++)
+            {
+                if (!box_visibility[i])
+                {
+                    continue;
+                }
+                object_shader.set_uniform("model_matrix", get_box_matrix(i));
+                box_vertex_mesh.draw();
+            }
 
-            float r = std::atan2(xd, yd) + pi;
+            // ==== Render Billboards ====
+            person_material.bind();
+            billboard_vertex_array.bind();
+            for (std::size_t i = 0; i < people_transforms.size(); i++)
+            {
+                if (!billboard_visibility[i])
+                {
+                    continue;
+                }
+                auto& transform = people_transforms[i];
 
-            glm::mat4 billboard_mat{1.0f};
-            billboard_mat = glm::translate(billboard_mat, transform.position);
-            billboard_mat = glm::rotate(billboard_mat, r, {0, 1, 0});
+                // Draw billboard
+                auto pi = static_cast<float>(std::numbers::pi);
+                auto xd = transform.position.x - camera.transform.position.x;
+                auto yd = transform.position.z - camera.transform.position.z;
 
-            scene_shader.set_uniform("model_matrix", billboard_mat);
+                float r = std::atan2(xd, yd) + pi;
 
-            billboard_vertex_array.draw();
-        }
+                glm::mat4 billboard_mat{1.0f};
+                billboard_mat = glm::translate(billboard_mat, transform.position);
+                billboard_mat = glm::rotate(billboard_mat, r, {0, 1, 0});
 
-        scene_shader.set_uniform("model_matrix", create_model_matrix(model_transform));
-        model.draw(scene_shader);
+                object_shader.set_uniform("model_matrix", billboard_mat);
 
-        // ==== Render Water ====
+                billboard_vertex_array.draw();
+            }
+
+            object_shader.set_uniform("model_matrix", model_mat);
+            for (int mesh_index : visible_model_meshes)
+            {
+                model->draw_mesh(object_shader, mesh_index);
+            }
+
+            // ==== Render Floating Light ====
+            light_object_shader.bind();
+            light_object_shader.set_uniform("model_matrix", light_mat);
+            light_vertex_mesh.bind();
+            if (light_visible)
+            {
+                light_vertex_mesh.draw();
+            }
+        };
+
+        // Draws the depth of what was culled for a cascade. The billboards and the light do not
+        // cast shadows.
+        auto render_shadow_casters = [&](const ShadowCasters& casters)
         {
-            water.bind();
-            water_mesh.bind();
-            glCullFace(GL_FRONT);
-            scene_shader.set_uniform("model_matrix", create_model_matrix(water_transform));
-            water_mesh.draw();
+            glEnable(GL_DEPTH_TEST);
+            glEnable(GL_CULL_FACE);
             glCullFace(GL_BACK);
+
+            auto& island_shader = gpu_terrain_active ? *shadow_gpu_terrain_shader : *shadow_shader;
+            if (gpu_terrain_active)
+            {
+                gpu_terrain.get_height_texture().bind(3);
+            }
+            island_shader.bind();
+            island_shader.set_uniform("model_matrix", create_model_matrix(terrain_transform));
+            terrain_mesh.bind();
+            for (int tile_index : casters.terrain_tiles)
+            {
+                auto& tile = terrain_tiles[tile_index];
+                terrain_mesh.draw_elements(tile.first_index, tile.index_count);
+            }
+
+            shadow_shader->bind();
+            for (auto page : casters.terrain_pages)
+            {
+                shadow_shader->set_uniform("model_matrix",
+                                           glm::translate(glm::mat4{1.0f}, page->get_position()));
+                page->mesh.bind();
+                page->mesh.draw();
+            }
+
+            box_vertex_mesh.bind();
+            for (std::size_t i = 0; i < physics.objects.size(); i++)
+            {
+                if (casters.box_visibility[i])
+                {
+                    shadow_shader->set_uniform("model_matrix", get_box_matrix(i));
+                    box_vertex_mesh.draw();
+                }
+            }
+
+            shadow_shader->set_uniform("model_matrix", model_mat);
+            for (int mesh_index : casters.model_meshes)
+            {
+                model->draw_mesh_depth(mesh_index);
+            }
+        };
+
+        // ==== Shadow maps ====
+        // Rendered before anything is lit, as every lit pass including the water's samples them
+        auto& shadow_pass_profiler = profiler.begin_section("ShadowPass");
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        for (int i = 0; i < shadow_map.get_cascade_count(); i++)
+        {
+            auto& cascade = shadow_map.get_cascade(i);
+            matrix_ubo.buffer_sub_data(0, cascade.projection);
+            matrix_ubo.buffer_sub_data(sizeof(glm::mat4), cascade.view);
+
+            shadow_map.begin_cascade(i);
+            render_shadow_casters(shadow_casters[i]);
+            shadow_map.end_cascade(i, shadow_casters[i].count);
         }
+        matrix_ubo.buffer_sub_data(0, camera.get_projection());
+        matrix_ubo.buffer_sub_data(sizeof(glm::mat4), camera.get_view_matrix());
+        shadow_map.bind();
+        shadow_pass_profiler.end_section();
 
-        // ==== Render Floating Light ====
-        scene_shader.set_uniform("is_light", true);
-        auto light_mat = create_model_matrix(light_transform);
-        scene_shader.set_uniform("model_matrix", light_mat);
-        light_vertex_mesh.bind();
-        light_vertex_mesh.draw();
-        for (auto& light : point_lights)
+        glPolygonMode(GL_FRONT_AND_BACK, debug_renderer.gl_wireframe() ? GL_LINE : GL_FILL);
+
+        // ==== Water reflection and refraction ====
+        // The scene above the water is rendered mirrored in it, and the scene below it as it is.
+        // Both reuse what was culled for the camera, so anything only seen in the reflection is
+        // missing from it.
+        water.height = settings.stream_terrain ? options.water_level : island_water_height;
+        auto render_water_pass = [&](Water::Pass pass)
         {
-            glm::mat4 m{1.0f};
-            m = glm::translate(m, {light.position.x, light.position.y, light.position.z});
-            scene_shader.set_uniform("model_matrix", m);
-            // light_vertex_mesh.draw();
+            for (auto shader : {water_scene_shader.get(), water_terrain_shader.get(),
+                                water_gpu_terrain_shader.get()})
+            {
+                shader->set_uniform("water_clip_plane", water.get_clip_plane(pass));
+                shader->set_uniform("eye_position", camera.transform.position);
+            }
+            water_scene_light_shader->set_uniform("water_clip_plane", water.get_clip_plane(pass));
+            water.begin_pass(pass);
+            render_scene(*water_scene_shader, *water_terrain_shader, *water_gpu_terrain_shader,
+                         *water_scene_light_shader);
+            water.end_pass(pass);
+        };
+
+        auto& water_reflection_profiler = profiler.begin_section("WaterReflection");
+        matrix_ubo.buffer_sub_data(sizeof(glm::mat4),
+                                   water.get_reflection_view(camera.get_view_matrix()));
+        render_water_pass(Water::Pass::Reflection);
+        matrix_ubo.buffer_sub_data(sizeof(glm::mat4), camera.get_view_matrix());
+        water_reflection_profiler.end_section();
+
+        auto& water_refraction_profiler = profiler.begin_section("WaterRefraction");
+        render_water_pass(Water::Pass::Refraction);
+        water_refraction_profiler.end_section();
+
+        if (settings.deferred_rendering)
+        {
+            // ==== Geometry pass into the GBuffer ====
+            auto& geometry_profile = profiler.begin_section("GeometryPass");
+            gbuffer.bind();
+            render_scene(*gbuffer_shader, *terrain_gbuffer_shader, *gpu_terrain_gbuffer_shader,
+                         *gbuffer_light_shader);
+            geometry_profile.end_section();
+
+            // ==== Light the GBuffer into the FBO ====
+            // Each pixel is only lit once, using the lights from its cluster, so the lighting cost
+            // only depends on the screen size and the number of lights
+            auto& lighting_profile = profiler.begin_section("LightingPass");
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            fbo.bind();
+            glDisable(GL_DEPTH_TEST);
+            gbuffer.bind_textures();
+            deferred_shader->bind();
+            deferred_shader->set_uniform("eye_position", camera.transform.position);
+            fbo_vbo.bind();
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glEnable(GL_DEPTH_TEST);
+
+            // Anything rendered after (eg debug lines) must be depth tested against the scene
+            gbuffer.blit_depth(fbo);
+            lighting_profile.end_section();
         }
+        else
+        {
+            auto& rendering_profile = profiler.begin_section("ForwardPass");
+            fbo.bind();
+            terrain_shader->set_uniform("eye_position", camera.transform.position);
+            gpu_terrain_shader->set_uniform("eye_position", camera.transform.position);
+            scene_shader->set_uniform("eye_position", camera.transform.position);
+            render_scene(*scene_shader, *terrain_shader, *gpu_terrain_shader,
+                         *scene_light_shader);
+            rendering_profile.end_section();
+        }
+
+        // ==== Render Water ====
+        // Drawn over the lit scene, which it is blended with where it is shallow
+        auto& water_surface_profiler = profiler.begin_section("WaterSurface");
+        glPolygonMode(GL_FRONT_AND_BACK, debug_renderer.gl_wireframe() ? GL_LINE : GL_FILL);
+        water.render(*water_shader, camera.get_view_matrix(), camera.get_projection(),
+                     camera.transform.position, game_time_now.asSeconds());
+        water_surface_profiler.end_section();
 
         // ==== Render Player ====
         // glm::mat4 m{1.0f};
         // box_transform.body->getWorldTransform().getOpenGLMatrix(glm::value_ptr(m));
         // auto m = create_model_matrix(player_transform);
         // m = glm::translate(m, {-0.5, -0.5, -0.5});
-        // scene_shader.set_uniform("model_matrix", m);
+        // scene_shader->set_uniform("model_matrix", m);
         // box_vertex_mesh.bind();
         // person_material.bind();
         // box_vertex_mesh.draw();
 
-        rendering_profile.end_section();
 
         // Render debug stuff
         if (debug_renderer.getDebugMode() > 0)
@@ -957,22 +1598,10 @@ int main()
         // glCullFace(GL_FRONT);
         // skybox_mesh.bind();
         // skybox_texture.bind(0);
-        // skybox_shader.bind();
+        // skybox_shader->bind();
         // skybox_mesh.draw();
         // glCullFace(GL_BACK);
 
-        // -----------------------
-        // ==== Render to FBO ====
-        // -----------------------
-        /*
-        fbo.bind();
-        scene_shader.bind();
-        gbuffer.bind_position_buffer_texture(0);
-        gbuffer.bind_normal_buffer_texture(1);
-        gbuffer.bind_albedo_specular_buffer_texture(2);
-
-        */
-
         // --------------------------
         // ==== Render to window ====
         // --------------------------
@@ -986,7 +1615,7 @@ int main()
 
         // Bind the FBOs texture which will texture the screen quad
         fbo.bind_colour_attachment(0, 0);
-        fbo_shader.bind();
+        fbo_shader->bind();
 
         // Render
         fbo_vbo.bind();
@@ -994,6 +1623,11 @@ int main()
 
         full_render_profiler.end_section();
 
+        // The water's passes and the shadow cascades are timed on the GPU, their times arrive a
+        // few frames later
+        water.update(profiler);
+        shadow_map.update_timings(profiler);
+
         // --------------------------
         // ==== End Frame ====
         // --------------------------
@@ -1006,30 +1640,195 @@ int main()
             camera.gui();
             GUI::debug_window(camera.transform.position, camera.transform.rotation, settings);
             debug_renderer.gui();
+            water.gui();
+            shadow_map.gui();
 
             if (ImGui::Begin("Stats"))
             {
                 ImGui::Text("B o x e s: %d", physics.objects.size());
+                // Heights imported, eroded or generated on the GPU after the world was loaded are
+                // not part of it, so its hashes no longer describe the island
+                auto world_state = world.loaded_from_cache ? "cached" : "generated";
+                ImGui::Text("World: %016llx (%s), content %016llx",
+                            static_cast<unsigned long long>(world.key),
+                            world_modified ? "modified" : world_state,
+                            static_cast<unsigned long long>(world.content_hash));
+                ImGui::Text("Visible boxes: %d", visible_boxes);
+                ImGui::Text("Visible billboards: %d / %d", visible_billboards,
+                            static_cast<int>(people_transforms.size()));
+                ImGui::Text("Visible terrain tiles: %d / %d",
+                            static_cast<int>(visible_terrain_tiles.size()),
+                            static_cast<int>(terrain_tiles.size()));
+                auto& terrain_stats = terrain_streamer.get_stats();
+                ImGui::Text("Terrain pages: %d visible, %d resident, %d pending",
+                            static_cast<int>(visible_terrain_pages.size()),
+                            terrain_stats.resident, terrain_stats.pending);
+                ImGui::Text("Terrain pages: %d generated, %d evicted, %d discarded (%.1f MB)",
+                            terrain_stats.generated, terrain_stats.evicted,
+                            terrain_stats.discarded, terrain_stats.memory / (1024.0f * 1024.0f));
+                ImGui::Text("Visible model meshes: %d / %d",
+                            static_cast<int>(visible_model_meshes.size()),
+                            static_cast<int>(model->get_meshes().size()));
+                ImGui::Text("Static BVH: %d objects, height %d", static_scene.size(),
+                            static_scene.height());
+                auto& asset_stats = assets.get_stats();
+                ImGui::Text("Assets: %d textures, %d models, %d shaders", asset_stats.textures,
+                            asset_stats.models, asset_stats.shaders);
+                ImGui::Text("Shader variants: at most %d of one shader (limit %d)",
+                            asset_stats.max_shader_variants, AssetCache::MAX_SHADER_VARIANTS);
+                ImGui::Text("Asset cache: %d hits, %d misses, %d evicted", asset_stats.hits,
+                            asset_stats.misses, asset_stats.evictions);
+                ImGui::Text("Hot reloads: %d (%d failed)", asset_stats.reloads,
+                            asset_stats.failed_reloads);
+                ImGui::Text("Texture memory: %.1f MB (%.1f MB saved)",
+                            asset_stats.texture_memory / (1024.0f * 1024.0f),
+                            asset_stats.saved_memory / (1024.0f * 1024.0f));
+                auto& light_stats = light_clusters.get_stats();
+                ImGui::Text("Point lights: %d visible / %d", light_stats.visible_lights,
+                            light_stats.lights);
+                ImGui::Text("Light indices: %d (max %d per cluster)", light_stats.light_indices,
+                            light_stats.max_lights_per_cluster);
+                if (settings.occlusion_culling)
+                {
+                    auto& occlusion_stats = occlusion_culler.get_stats();
+                    ImGui::Text("Occlusion culled: %d / %d (%d occluder triangles)",
+                                occlusion_stats.occluded, occlusion_stats.tested,
+                                occlusion_culler.get_triangle_count());
+                }
+
+                // What the camera is looking at, according to the static scene bounds
+                auto hit = static_scene.raycast({camera.transform.position, camera.get_forwards()},
+                                                1000.0f);
+                if (hit.hit)
+                {
+                    auto& object = static_objects[hit.user_data];
+                    ImGui::Text("Looking at: %s %d (%.1f)",
+                                object.type == StaticObject::Type::TerrainTile ? "Terrain Tile"
+                                                                               : "Model Mesh",
+                                object.index, hit.distance);
+                }
+
+                // Exact point on the terrain surface, found by walking the min/max pyramid
+                if (!settings.stream_terrain)
+                {
+                    if (auto distance = height_map.raycast(camera.transform.position,
+                                                           camera.get_forwards(), 1000.0f))
+                    {
+                        auto point =
+                            camera.transform.position + camera.get_forwards() * *distance;
+                        ImGui::Text("Terrain hit: (%.1f, %.1f, %.1f)", point.x, point.y, point.z);
+                    }
+                }
             }
             ImGui::End();
 
-            if (options.gui(height_map))
+            Benchmarks::gui();
+
+            bool regenerate_terrain = options.gui(height_map);
+            bool imported_terrain = false;
+            if (ImGui::Begin("Height Generation"))
             {
-                auto& time = profiler.begin_section("Terrain Re-Gen");
-                height_map.generate_terrain(options);
-                water_transform.position.y = 0;
-                options.water_level - height_map.set_base_height();
+                ImGui::Separator();
+                imported_terrain = height_map.file_gui();
+            }
+            ImGui::End();
 
-                update_terrain_mesh(terrain_mesh, height_map);
+            bool erode_terrain = erosion_options.gui();
+            if (ImGui::Begin("Erosion") && terrain_eroder.is_running())
+            {
+                ImGui::ProgressBar(terrain_eroder.get_progress());
+            }
+            ImGui::End();
 
-                terrain_mesh.update();
+            // Switching between CPU and GPU generation regenerates the terrain with the other
+            if (settings.gpu_terrain != gpu_terrain_setting)
+            {
+                gpu_terrain_setting = settings.gpu_terrain;
+                regenerate_terrain = true;
+            }
 
+            // The GPU only has the default noise, other noise is always generated on the CPU.
+            // Eroded terrain is also generated on the CPU, as erosion needs the heights at once.
+            if (regenerate_terrain || imported_terrain)
+            {
+                terrain_eroder.stop();
+            }
+            if (regenerate_terrain && settings.gpu_terrain && gpu_terrain_supported &&
+                height_map.uses_default_noise() && !erosion_options.erode_generated)
+            {
+                auto& time = profiler.begin_section("Terrain Re-Gen");
+                gpu_terrain.generate(options, height_map.size);
+                gpu_terrain_active = true;
+                world_modified = true;
+                island_water_height = options.water_level;
+                terrain_streamer.reset(options);
                 time.end_section();
             }
+            else if (regenerate_terrain || imported_terrain)
+            {
+                auto& time = profiler.begin_section("Terrain Re-Gen");
+                if (regenerate_terrain)
+                {
+                    // Generated terrain is eroded as part of the world, so the eroded world is
+                    // cached too
+                    world_options.terrain = options;
+                    world_options.erosion = std::nullopt;
+                    if (erosion_options.erode_generated)
+                    {
+                        world_options.erosion = erosion_options;
+                    }
+                    regenerate_world();
+                    terrain_streamer.reset(options);
+                }
+                else
+                {
+                    update_terrain_mesh(terrain_mesh, height_map);
+                    terrain_mesh.update();
+                    world_modified = true;
+                }
+                gpu_terrain_active = false;
+                update_terrain_users();
+
+                time.end_section();
+            }
+
+            if (erode_terrain)
+            {
+                // Heights still on their way back from the GPU are needed first, and the island is
+                // drawn from the eroded mesh from now on
+                if (gpu_terrain_active)
+                {
+                    gpu_terrain.poll_readback(height_map, true);
+                    gpu_terrain_active = false;
+                }
+                terrain_eroder.start(height_map.size, erosion_options);
+                world_modified = true;
+            }
 
             profiler.gui();
         }
 
+        // Heights generated on the GPU are copied back for physics and culling once they are ready.
+        // The base height is not moved, as the GPU's heights are drawn as they are.
+        if (gpu_terrain_active && gpu_terrain.poll_readback(height_map))
+        {
+            update_terrain_users();
+        }
+
+        // The mesh shows the erosion as it goes, everything else is updated once it is done
+        if (terrain_eroder.is_running())
+        {
+            auto& erosion_profiler = profiler.begin_section("Erosion");
+            bool eroded = terrain_eroder.update(height_map, sf::milliseconds(8));
+            update_terrain_mesh(terrain_mesh, height_map);
+            terrain_mesh.update();
+            if (eroded)
+            {
+                update_terrain_users();
+            }
+            erosion_profiler.end_section();
+        }
+
         GUI::end_frame();
 
         window.display();